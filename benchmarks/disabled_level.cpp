@@ -0,0 +1,61 @@
+/*
+ * The cost of a call whose level is disabled, at compile time (Config's min_level) and at runtime (set_level).
+ * Build: clang++ --std=c++1z -O3 -I../include disabled_level.cpp -o disabled_level
+ */
+#include <chrono>
+#include <cstdio>
+#include <tuple>
+
+#include "llcpp/llcpp.hpp"
+
+namespace {
+    constexpr std::size_t iterations = 10000000;
+
+    volatile int g_sink = 0;
+
+    int expensive_argument() {
+        int sum = 0;
+        for (int i = 0; i < 100; i++) {
+            sum += g_sink + i;
+        }
+        return sum;
+    }
+
+    template<typename F>
+    void measure(const char *name, F&& f) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            f(static_cast<int>(i));
+        }
+        auto end = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::printf("%-40s %8.3f ns/call\n", name, static_cast<double>(ns) / iterations);
+    }
+}
+
+int main() {
+    using prefix_tuple_t = std::tuple<llcpp::log_level_prefix, llcpp::nanosec_time_prefix>;
+    using info_config_t = llcpp::default_config::config_with_min_level<llcpp::level::info>;
+
+    auto runtime_logger = llcpp::file_logger<prefix_tuple_t>("/dev/null");
+    runtime_logger.set_level(llcpp::level::info);
+    auto compile_time_logger = llcpp::file_logger<prefix_tuple_t, info_config_t>("/dev/null");
+
+    measure("empty loop", [](int i) { g_sink = i; });
+    measure("compile time disabled debug()", [&](int i) {
+        compile_time_logger.debug("debug line %d"_log, i);
+    });
+    measure("runtime disabled debug()", [&](int i) {
+        runtime_logger.debug("debug line %d"_log, i);
+    });
+    measure("runtime disabled debug(), eager argument", [&](int) {
+        runtime_logger.debug("debug line %d"_log, expensive_argument());
+    });
+    measure("runtime disabled LLCPP_DEBUG", [&](int) {
+        LLCPP_DEBUG(runtime_logger, "debug line %d"_log, expensive_argument());
+    });
+    measure("enabled info()", [&](int i) {
+        runtime_logger.info("info line %d"_log, i);
+    });
+    return 0;
+}
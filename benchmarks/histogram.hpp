@@ -0,0 +1,77 @@
+#pragma once
+/*
+ * A log-linear latency histogram, in the spirit of HdrHistogram: values below 128 are counted exactly, above that
+ *  each power of 2 is split in 64 buckets, so any value is recorded within 1/64 (~1.6%) of itself, over the whole
+ *  64bit range, in a fixed ~58KB.
+ * Recording is a couple of bit operations and an increment, cheap enough to do around every call.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+    struct histogram {
+        histogram() : m_counts((64 - sub_bucket_bits + 1) << sub_bucket_bits, 0) {}
+
+        void record(std::uint64_t value) {
+            m_counts[index_of(value)]++;
+            m_count++;
+            m_sum += value;
+            m_max = std::max(m_max, value);
+        }
+        void merge(const histogram& other) {
+            for (std::size_t i = 0; i < m_counts.size(); i++) {
+                m_counts[i] += other.m_counts[i];
+            }
+            m_count += other.m_count;
+            m_sum += other.m_sum;
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        std::uint64_t count() const {
+            return m_count;
+        }
+        std::uint64_t max() const {
+            return m_max;
+        }
+        double mean() const {
+            return (m_count > 0) ? (static_cast<double>(m_sum) / m_count) : (0);
+        }
+        // The value `percentile` percent of the recorded values are at or below (the top of its bucket)
+        std::uint64_t percentile(double percentile) const {
+            auto rank = static_cast<std::uint64_t>(percentile / 100 * m_count + 0.5);
+            rank = std::max<std::uint64_t>(rank, 1);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < m_counts.size(); i++) {
+                seen += m_counts[i];
+                if (seen >= rank) {
+                    return std::min(highest_in(i), m_max);
+                }
+            }
+            return m_max;
+        }
+
+    private:
+        // The value shifted right until it fits in sub_bucket_bits keeps its top bit set, so only the upper half of
+        //  each shift's slots is used: 64 buckets per power of 2.
+        static constexpr unsigned sub_bucket_bits = 7;
+
+        static std::size_t index_of(std::uint64_t value) {
+            unsigned shift = 0;
+            if ((value >> sub_bucket_bits) != 0) {
+                shift = 64 - __builtin_clzll(value) - sub_bucket_bits;
+            }
+            return (static_cast<std::size_t>(shift) << sub_bucket_bits) + static_cast<std::size_t>(value >> shift);
+        }
+        static std::uint64_t highest_in(std::size_t index) {
+            auto shift = index >> sub_bucket_bits;
+            auto low = static_cast<std::uint64_t>(index - (shift << sub_bucket_bits)) << shift;
+            return low + ((std::uint64_t(1) << shift) - 1);
+        }
+
+        std::vector<std::uint64_t> m_counts;
+        std::uint64_t m_count = 0;
+        std::uint64_t m_sum = 0;
+        std::uint64_t m_max = 0;
+    };
+}
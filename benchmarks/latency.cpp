@@ -0,0 +1,336 @@
+/*
+ * Call site latency of file_logger, stdout_logger and vector_logger with each prefix combination, at 1 and 4
+ *  threads, reproducing the tables in the README.
+ * Every call is timed with steady_clock (the clock's own overhead is reported as the "clock" row) into a log-linear
+ *  histogram, reporting the 50th..99.99th percentiles, worst case and average in nanoseconds, and the total time in
+ *  seconds from the first line until the logger is destroyed (i.e. everything reached the kernel).
+ * stdout_logger writes to /dev/null (or --stdout PATH), the report goes to the original stdout, as a table or with
+ *  --csv / --json in a machine-readable form, to compare runs before upgrading.
+ * Usage: latency [--lines N] [--threads 1,4] [--logger file,stdout,vector] [--prefix none,level,...] [--dir /tmp]
+ *  [--stdout PATH] [--csv | --json]
+ * Build: clang++ --std=c++1z -O3 -I../include latency.cpp -o latency -lpthread (or cmake -DLLCPP_BUILD_BENCHMARKS=ON)
+ */
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "llcpp/llcpp.hpp"
+#include "histogram.hpp"
+
+namespace {
+    enum class output_format {
+        table,
+        csv,
+        json,
+    };
+
+    struct options {
+        std::size_t lines = 1000000;
+        std::vector<std::size_t> threads = {1, 4};
+        std::vector<std::string> loggers = {"file", "stdout", "vector"};
+        std::vector<std::string> prefixes = {"none", "level", "level+timestamp", "level+date/time",
+            "level+coarse", "level+tsc"};
+        std::string dir = "/tmp";
+        std::string stdout_path = "/dev/null";
+        output_format format = output_format::table;
+    };
+
+    struct result {
+        std::string logger;
+        std::string prefix;
+        std::size_t threads;
+        bench::histogram latencies;
+        double total_seconds;
+    };
+
+    constexpr double percentiles[] = {50, 75, 90, 99, 99.9, 99.99};
+    constexpr const char *percentile_names[] = {"50th", "75th", "90th", "99th", "99.9th", "99.99th"};
+
+    std::uint64_t now_ns() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    template<typename Logger>
+    void log_lines(Logger& logger, std::size_t lines, bench::histogram& latencies) {
+        for (std::size_t i = 0; i < lines; i++) {
+            auto start = now_ns();
+            logger.info("Logging line %d of %d and a string %s"_log, static_cast<int>(i), static_cast<int>(lines), "payload");
+            latencies.record(now_ns() - start);
+        }
+    }
+
+    // Runs `threads` threads over `make_logger`'s loggers (shared by all threads, or one per thread for loggers that
+    //  are not thread safe), from a common start
+    template<typename MakeLogger>
+    result run(const options& opts, const char *logger_name, const char *prefix_name, std::size_t num_threads,
+        bool per_thread, MakeLogger make_logger) {
+        result res{logger_name, prefix_name, num_threads, {}, 0};
+        std::vector<bench::histogram> latencies(num_threads);
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t ready = 0;
+        bool release = false;
+        std::uint64_t start = 0;
+        {
+            auto shared = (per_thread) ? (nullptr) : (make_logger(0));
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < num_threads; t++) {
+                threads.emplace_back([&, t] {
+                    auto own = (per_thread) ? (make_logger(t)) : (nullptr);
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        ready++;
+                        cv.notify_all();
+                        cv.wait(lock, [&] { return release; });
+                    }
+                    log_lines((per_thread) ? (*own) : (*shared), opts.lines, latencies[t]);
+                });
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return ready == num_threads; });
+                start = now_ns();
+                release = true;
+                cv.notify_all();
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        res.total_seconds = static_cast<double>(now_ns() - start) / 1e9;
+        for (auto& histogram : latencies) {
+            res.latencies.merge(histogram);
+        }
+        return res;
+    }
+
+    template<typename PrefixTuple>
+    void run_prefix(const options& opts, const char *prefix_name, std::vector<result>& results) {
+        for (auto num_threads : opts.threads) {
+            for (auto& logger_name : opts.loggers) {
+                if (logger_name == "file") {
+                    auto path = opts.dir + "/llcpp_latency.log";
+                    results.push_back(run(opts, "file", prefix_name, num_threads, false, [&](std::size_t) {
+                        return std::make_unique<llcpp::file_logger<PrefixTuple>>(path);
+                    }));
+                    ::unlink(path.c_str());
+                } else if (logger_name == "stdout") {
+                    results.push_back(run(opts, "stdout", prefix_name, num_threads, false, [&](std::size_t) {
+                        return std::make_unique<llcpp::stdout_logger<PrefixTuple>>();
+                    }));
+                } else if (logger_name == "vector") {
+                    // Not thread safe, one per thread, reserved up front so growing the vector isn't measured
+                    std::vector<std::vector<std::uint8_t>> vecs(num_threads);
+                    results.push_back(run(opts, "vector", prefix_name, num_threads, true, [&](std::size_t t) {
+                        vecs[t].reserve(opts.lines * 64);
+                        return std::make_unique<llcpp::vector_logger<PrefixTuple>>(vecs[t]);
+                    }));
+                }
+            }
+        }
+    }
+
+    // The cost of the two steady_clock reads around each call, included in every other row
+    result clock_overhead(const options& opts) {
+        result res{"clock", "-", 1, {}, 0};
+        auto start = now_ns();
+        for (std::size_t i = 0; i < opts.lines; i++) {
+            auto before = now_ns();
+            res.latencies.record(now_ns() - before);
+        }
+        res.total_seconds = static_cast<double>(now_ns() - start) / 1e9;
+        return res;
+    }
+
+    void print_table(std::FILE *out, const std::vector<result>& results) {
+        std::size_t threads = 0;
+        for (auto& res : results) {
+            if (res.threads != threads) {
+                threads = res.threads;
+                std::fprintf(out, "\n%zu Thread%s (time in nanoseconds unless stated otherwise)\n\n", threads,
+                    (threads == 1) ? ("") : ("s"));
+                std::fprintf(out, "|%-24s|", "Logger");
+                for (auto name : percentile_names) {
+                    std::fprintf(out, "%9s|", name);
+                }
+                std::fprintf(out, "%9s|%10s|%21s|\n", "Worst", "Average", "Total Time (seconds)");
+                std::fprintf(out, "|:%s:|", std::string(22, '-').c_str());
+                for (std::size_t i = 0; i < std::size(percentile_names) + 1; i++) {
+                    std::fprintf(out, ":-------:|");
+                }
+                std::fprintf(out, ":--------:|:-------------------:|\n");
+            }
+            auto name = res.logger + " (" + res.prefix + ")";
+            std::fprintf(out, "|%-24s|", name.c_str());
+            for (auto percentile : percentiles) {
+                std::fprintf(out, "%9llu|", static_cast<unsigned long long>(res.latencies.percentile(percentile)));
+            }
+            std::fprintf(out, "%9llu|%10.2f|%21.3f|\n", static_cast<unsigned long long>(res.latencies.max()),
+                res.latencies.mean(), res.total_seconds);
+        }
+    }
+
+    void print_csv(std::FILE *out, const std::vector<result>& results) {
+        std::fprintf(out, "logger,prefix,threads,lines");
+        for (auto name : percentile_names) {
+            std::fprintf(out, ",%s", name);
+        }
+        std::fprintf(out, ",worst,average,total_seconds\n");
+        for (auto& res : results) {
+            std::fprintf(out, "%s,%s,%zu,%llu", res.logger.c_str(), res.prefix.c_str(), res.threads,
+                static_cast<unsigned long long>(res.latencies.count()));
+            for (auto percentile : percentiles) {
+                std::fprintf(out, ",%llu", static_cast<unsigned long long>(res.latencies.percentile(percentile)));
+            }
+            std::fprintf(out, ",%llu,%.2f,%.6f\n", static_cast<unsigned long long>(res.latencies.max()),
+                res.latencies.mean(), res.total_seconds);
+        }
+    }
+
+    void print_json(std::FILE *out, const std::vector<result>& results) {
+        std::fprintf(out, "[\n");
+        for (std::size_t r = 0; r < results.size(); r++) {
+            auto& res = results[r];
+            std::fprintf(out, "  {\"logger\": \"%s\", \"prefix\": \"%s\", \"threads\": %zu, \"lines\": %llu, "
+                "\"percentiles_ns\": {", res.logger.c_str(), res.prefix.c_str(), res.threads,
+                static_cast<unsigned long long>(res.latencies.count()));
+            for (std::size_t i = 0; i < std::size(percentiles); i++) {
+                std::fprintf(out, "%s\"%s\": %llu", (i == 0) ? ("") : (", "), percentile_names[i],
+                    static_cast<unsigned long long>(res.latencies.percentile(percentiles[i])));
+            }
+            std::fprintf(out, "}, \"worst_ns\": %llu, \"average_ns\": %.2f, \"total_seconds\": %.6f}%s\n",
+                static_cast<unsigned long long>(res.latencies.max()), res.latencies.mean(),
+                res.total_seconds, (r + 1 == results.size()) ? ("") : (","));
+        }
+        std::fprintf(out, "]\n");
+    }
+
+    template<typename T>
+    std::vector<T> split(const char *list, T (*convert)(const std::string&)) {
+        std::vector<T> items;
+        std::string rest = list;
+        std::size_t pos;
+        while ((pos = rest.find(',')) != std::string::npos) {
+            items.push_back(convert(rest.substr(0, pos)));
+            rest = rest.substr(pos + 1);
+        }
+        items.push_back(convert(rest));
+        return items;
+    }
+
+    void usage(const char *name) {
+        std::fprintf(stderr, "Usage: %s [--lines N] [--threads 1,4] [--logger file,stdout,vector] "
+            "[--prefix none,level,level+timestamp,level+date/time,level+coarse,level+tsc] [--dir /tmp] "
+            "[--stdout PATH] [--csv | --json]\n", name);
+        std::exit(1);
+    }
+
+    options parse(int argc, char **argv) {
+        options opts;
+        for (int i = 1; i < argc; i++) {
+            auto arg = std::string(argv[i]);
+            bool has_value = (i + 1 < argc);
+            if (arg == "--csv") {
+                opts.format = output_format::csv;
+            } else if (arg == "--json") {
+                opts.format = output_format::json;
+            } else if (arg == "--lines" && has_value) {
+                opts.lines = std::strtoull(argv[++i], nullptr, 10);
+            } else if (arg == "--threads" && has_value) {
+                opts.threads = split<std::size_t>(argv[++i], [](const std::string& s) {
+                    return static_cast<std::size_t>(std::strtoull(s.c_str(), nullptr, 10));
+                });
+            } else if (arg == "--logger" && has_value) {
+                opts.loggers = split<std::string>(argv[++i], [](const std::string& s) { return s; });
+            } else if (arg == "--prefix" && has_value) {
+                opts.prefixes = split<std::string>(argv[++i], [](const std::string& s) { return s; });
+            } else if (arg == "--dir" && has_value) {
+                opts.dir = argv[++i];
+            } else if (arg == "--stdout" && has_value) {
+                opts.stdout_path = argv[++i];
+            } else {
+                usage(argv[0]);
+            }
+        }
+        if (opts.lines == 0 || std::count(opts.threads.begin(), opts.threads.end(), 0) != 0) {
+            usage(argv[0]);
+        }
+        for (auto& logger : opts.loggers) {
+            if (logger != "file" && logger != "stdout" && logger != "vector") {
+                usage(argv[0]);
+            }
+        }
+        return opts;
+    }
+}
+
+int main(int argc, char **argv) {
+    auto opts = parse(argc, argv);
+
+    // Keep the report apart from stdout_logger's output
+    std::FILE *report = ::fdopen(::dup(STDOUT_FILENO), "w");
+    int sink = ::open(opts.stdout_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (report == nullptr || sink < 0 || ::dup2(sink, STDOUT_FILENO) < 0) {
+        std::perror("redirecting stdout");
+        return 1;
+    }
+    ::close(sink);
+
+    // Sorted by thread count, as the tables are
+    std::sort(opts.threads.begin(), opts.threads.end());
+    std::vector<result> results;
+    results.push_back(clock_overhead(opts));
+    for (auto num_threads : opts.threads) {
+        auto single = opts;
+        single.threads = {num_threads};
+        for (auto& prefix : opts.prefixes) {
+            if (prefix == "none") {
+                run_prefix<std::tuple<>>(single, "none", results);
+            } else if (prefix == "level") {
+                run_prefix<std::tuple<llcpp::log_level_prefix>>(single, "level", results);
+            } else if (prefix == "level+timestamp") {
+                run_prefix<std::tuple<llcpp::log_level_prefix, llcpp::nanosec_time_prefix>>(
+                    single, "level+timestamp", results);
+            } else if (prefix == "level+date/time") {
+                run_prefix<std::tuple<llcpp::log_level_prefix, llcpp::localtime_prefix>>(
+                    single, "level+date/time", results);
+            } else if (prefix == "level+coarse") {
+                run_prefix<std::tuple<llcpp::log_level_prefix, llcpp::coarse_time_prefix>>(
+                    single, "level+coarse", results);
+            } else if (prefix == "level+tsc") {
+                run_prefix<std::tuple<llcpp::log_level_prefix, llcpp::tsc_time_prefix>>(
+                    single, "level+tsc", results);
+            } else {
+                std::fprintf(stderr, "Unknown prefix combination: %s\n", prefix.c_str());
+                return 1;
+            }
+        }
+    }
+
+    switch (opts.format) {
+        case output_format::table:
+            print_table(report, results);
+            break;
+        case output_format::csv:
+            print_csv(report, results);
+            break;
+        case output_format::json:
+            print_json(report, results);
+            break;
+    }
+    std::fclose(report);
+    return 0;
+}
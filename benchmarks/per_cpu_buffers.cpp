@@ -0,0 +1,88 @@
+/*
+ * Per-thread vs per-CPU file_logger buffers with 4, 64 and 1024 threads, all alive at once.
+ * Reports the time to log a fixed total number of lines, and the memory resident while every thread is alive
+ *  (after logging, before exiting, so per-thread buffers are all still allocated).
+ * Build: clang++ --std=c++1z -O3 -I../include per_cpu_buffers.cpp -o per_cpu_buffers -lpthread
+ */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include "llcpp/llcpp.hpp"
+
+namespace {
+    constexpr std::size_t total_lines = 8000000;
+    // Large enough that per-thread buffers dominate the threads' own memory
+    constexpr std::size_t buffer_size = 64 * 1024;
+
+    std::size_t resident_bytes() {
+        long pages = 0;
+        long resident = 0;
+        if (std::FILE *statm = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            std::fclose(statm);
+        }
+        return static_cast<std::size_t>(resident) * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    template<typename Config>
+    void measure(const char *name, std::size_t num_threads) {
+        using prefix_tuple_t = std::tuple<llcpp::log_level_prefix, llcpp::coarse_time_prefix>;
+        auto logger = llcpp::file_logger<prefix_tuple_t, Config>("/dev/null");
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t done = 0;
+        bool release = false;
+        auto baseline = resident_bytes();
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                for (std::size_t i = 0; i < total_lines / num_threads; i++) {
+                    logger.info("thread %d line %d %s"_log, static_cast<int>(t), static_cast<int>(i), "payload");
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                done++;
+                cv.notify_all();
+                cv.wait(lock, [&] { return release; });
+            });
+        }
+        std::size_t resident;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return done == num_threads; });
+            resident = resident_bytes();
+            release = true;
+            cv.notify_all();
+        }
+        auto end = std::chrono::steady_clock::now();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        std::printf("%-12s %5zu threads %8.2f ns/line %10.1f MB resident\n", name, num_threads,
+            static_cast<double>(ns) / total_lines, static_cast<double>(resident - baseline) / (1024 * 1024));
+    }
+}
+
+int main() {
+    using per_thread_config_t = llcpp::default_config::config_with_buffer_size<buffer_size>;
+    using per_cpu_config_t = per_thread_config_t::config_with_per_cpu_buffers<>;
+
+    for (std::size_t num_threads : {4, 64, 1024}) {
+        measure<per_thread_config_t>("per-thread", num_threads);
+        measure<per_cpu_config_t>("per-cpu", num_threads);
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "detail/decoding.hpp"
+
+namespace llcpp {
+    using mapped_file = detail::decoding::mapped_file;
+    using format_layout = detail::decoding::format_layout;
+    using record = detail::decoding::record;
+    using value_kind = detail::terminators::value_kind;
+    namespace framing = detail::framing;
+
+    // Decodes logs written by loggers using `Config`'s terminators
+    template<typename Config = detail::config::default_config>
+    using decoder = detail::decoding::decoder<Config>;
+
+    using detail::decoding::append_text;
+    using detail::decoding::append_json;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logging.hpp"
+#include "per_thread.hpp"
+#include "spsc_ring.hpp"
+
+namespace llcpp::detail::logging {
+    using full_ring_policy = spsc_ring::full_ring_policy;
+
+    /*
+     * Each logging thread serializes its records into its own lock-free ring.
+     * A single background thread drains all rings and does the I/O, so the call site never makes a syscall.
+     * When a ring is full, the `Policy` decides whether the call site waits, drops the record or drops the oldest records.
+     * If the file can't be opened (see `is_open`), the writer still drains the rings but discards what it reads.
+     */
+    template<typename PrefixTuple, typename Config = config::default_config,
+        full_ring_policy Policy = full_ring_policy::block, std::size_t RingSize = 64 * 1024>
+    struct async_file_logger : public logger_base<PrefixTuple, async_file_logger<PrefixTuple, Config, Policy, RingSize>, Config> {
+        using base_t = logger_base<PrefixTuple, async_file_logger<PrefixTuple, Config, Policy, RingSize>, Config>;
+        friend base_t;
+        static_assert(RingSize > 0 && (RingSize & (RingSize - 1)) == 0, "RingSize must be a power of 2");
+        static_assert(!Config::use_framing, "async_file_logger writes plain logs, framing isn't supported");
+        static_assert(std::is_same_v<typename Config::compressor, compression::none>,
+            "async_file_logger writes plain logs, compression isn't supported");
+        static_assert(!Config::use_crash_buffer, "async_file_logger's rings aren't recoverable, the crash buffer isn't supported");
+
+        // Opening the file doesn't throw: check `is_open()`, lines logged to a logger that failed to open are discarded
+        async_file_logger(std::string_view path, PrefixTuple&& prefix_tuple = {},
+                std::chrono::microseconds poll_interval = std::chrono::microseconds(100)) :
+            base_t(std::forward<PrefixTuple>(prefix_tuple)),
+            m_fp(std::fopen(path.data(), "w"), std::fclose),
+            m_poll_interval(poll_interval),
+            m_writer([this] { writer_loop(); })
+        {
+        }
+        ~async_file_logger() {
+            m_stop.store(true, std::memory_order_release);
+            m_writer.join();
+        }
+
+        bool is_open() const {
+            return m_fp != nullptr;
+        }
+        // Records dropped (or overwritten) because a ring was full
+        std::uint64_t dropped() {
+            std::uint64_t total = 0;
+            m_rings.for_each([&](ring_t& ring) { total += ring.dropped(); });
+            return total;
+        }
+
+        void line_hint_impl() {
+            m_rings.local(RingSize).commit();
+        }
+    protected:
+        using ring_t = spsc_ring::record_ring<Policy>;
+
+        void write_impl(const std::uint8_t *data, const std::size_t len) {
+            m_rings.local(RingSize).write(data, len);
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            return m_rings.local(RingSize).reserve(len);
+        }
+        void commit_impl(const std::size_t len) {
+            m_rings.local(RingSize).advance(len);
+        }
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            std::lock_guard<std::mutex> lock(m_meta_mutex);
+            m_meta.insert(m_meta.end(), data, data + len);
+        }
+
+        void writer_loop() {
+            bool pending_flush = false;
+            while (true) {
+                bool stopping = m_stop.load(std::memory_order_acquire);
+                auto written = drain();
+                if (written > 0) {
+                    pending_flush = true;
+                    continue;
+                }
+                if (stopping) {
+                    break;
+                }
+                if (pending_flush && m_fp) {
+                    std::fflush(m_fp.get());
+                    pending_flush = false;
+                }
+                std::this_thread::sleep_for(m_poll_interval);
+            }
+        }
+
+        std::size_t drain() {
+            /*
+             * Meta records (i.e. dictionary entries) are written before the records that reference them:
+             *  a record committed before we snapshot the rings' heads was written after the meta records it depends on
+             *  were queued, so draining the meta queue after the snapshot is enough.
+             */
+            m_heads.clear();
+            m_rings.for_each([&](ring_t& ring) { m_heads.emplace_back(&ring, ring.committed()); });
+            {
+                std::lock_guard<std::mutex> lock(m_meta_mutex);
+                m_out.swap(m_meta);
+            }
+            for (auto& [ring, head] : m_heads) {
+                ring->drain(m_out, head);
+            }
+            auto written = m_out.size();
+            if (written > 0) {
+                if (m_fp) {
+                    std::fwrite(m_out.data(), written, 1, m_fp.get());
+                }
+                m_out.clear();
+            }
+            return written;
+        }
+
+        // Before the writer thread, which uses it
+        std::unique_ptr<std::FILE, std::function<int(std::FILE*)>> m_fp;
+        per_thread::registry<ring_t> m_rings;
+        std::mutex m_meta_mutex;
+        std::vector<std::uint8_t> m_meta;
+
+        // Writer thread only
+        std::vector<std::pair<ring_t *, std::uint64_t>> m_heads;
+        std::vector<std::uint8_t> m_out;
+
+        const std::chrono::microseconds m_poll_interval;
+        std::atomic<bool> m_stop{false};
+        std::thread m_writer;
+    };
+}
\ No newline at end of file
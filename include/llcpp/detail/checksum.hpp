@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace llcpp::detail::checksum {
+    // CRC-32C (Castagnoli), the polynomial the SSE4.2 crc32 instruction implements
+    constexpr std::uint32_t crc32c_polynomial = 0x82f63b78;
+
+    constexpr std::array<std::uint32_t, 256> make_crc32c_table() {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? ((crc >> 1) ^ crc32c_polynomial) : (crc >> 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+    inline constexpr std::array<std::uint32_t, 256> crc32c_table = make_crc32c_table();
+
+    inline std::uint32_t crc32c_portable(std::uint32_t crc, const std::uint8_t *data, std::size_t len) {
+        for (std::size_t i = 0; i < len; i++) {
+            crc = crc32c_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    inline std::uint32_t crc32c_sse42(std::uint32_t crc, const std::uint8_t *data, std::size_t len) {
+        std::uint64_t crc64 = crc;
+        for (; len >= sizeof(std::uint64_t); data += sizeof(std::uint64_t), len -= sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+        }
+        crc = static_cast<std::uint32_t>(crc64);
+        for (; len > 0; data++, len--) {
+            crc = _mm_crc32_u8(crc, *data);
+        }
+        return crc;
+    }
+#endif
+
+    /*
+     * Continue a CRC-32C over `data`. Start with `crc32c(0, ...)` and chain the result to checksum several spans.
+     */
+    inline std::uint32_t crc32c(std::uint32_t crc, const std::uint8_t *data, std::size_t len) {
+        crc = ~crc;
+#if defined(__x86_64__)
+        static const bool s_has_sse42 = __builtin_cpu_supports("sse4.2");
+        if (s_has_sse42) {
+            return ~crc32c_sse42(crc, data, len);
+        }
+#endif
+        return ~crc32c_portable(crc, data, len);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace llcpp::detail::clock {
+    inline std::uint64_t realtime_ns() {
+        auto now = std::chrono::system_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    }
+
+    /*
+     * Wall clock with the resolution of the kernel's tick (a few ms), but much cheaper to read.
+     */
+    inline std::uint64_t coarse_realtime_ns() {
+#if defined(CLOCK_REALTIME_COARSE)
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#else
+        return realtime_ns();
+#endif
+    }
+
+    // Like coarse_realtime_ns, but never jumps (for measuring intervals)
+    inline std::uint64_t coarse_monotonic_ns() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#else
+        auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+#endif
+    }
+
+    /*
+     * Raw cycle counter. Where there's no TSC, falls back to a monotonic clock in nanoseconds.
+     */
+    inline std::uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+#endif
+    }
+
+    /*
+     * A (cycles, wall clock) pair taken at the same moment.
+     */
+    struct cycles_anchor {
+        std::uint64_t cycles;
+        std::uint64_t realtime_ns;
+
+        static cycles_anchor now() {
+            return {clock::cycles(), clock::realtime_ns()};
+        }
+    };
+
+    // Cycles per second between two anchors
+    inline std::uint64_t cycles_frequency(const cycles_anchor& from, const cycles_anchor& to) {
+        if (to.realtime_ns <= from.realtime_ns) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>(
+            static_cast<long double>(to.cycles - from.cycles) * 1e9L / (to.realtime_ns - from.realtime_ns));
+    }
+
+    /*
+     * The process wide anchor used to estimate the cycle counter's frequency.
+     * Taken once, the first estimate is measured over a short sleep.
+     */
+    inline const cycles_anchor& reference_anchor() {
+        static const cycles_anchor s_anchor = [] {
+            auto anchor = cycles_anchor::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return anchor;
+        }();
+        return s_anchor;
+    }
+}
\ No newline at end of file
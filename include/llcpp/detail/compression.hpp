@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(LLCPP_USE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace llcpp::detail::compression {
+    /*
+     * Codecs compress a whole flushed block at once (see `config_with_compression`), never a single record.
+     * They implement:
+     * - `id`, recorded in each block header so the decoder knows how to decompress it. 0 means stored as is.
+     * - `max_compressed_size(len)`, the capacity `compress` may need.
+     * - `compress(src, len, dst, capacity)`, returns the compressed size, 0 if it didn't fit.
+     * `decompress` below must know each codec's id.
+     */
+    enum codec_id : std::uint16_t {
+        stored_id = 0,
+        lz_id = 1,
+        zstd_id = 2,
+    };
+
+    struct none {
+        static constexpr std::uint16_t id = stored_id;
+    };
+
+    /*
+     * A fast, greedy LZ77 codec in the LZ4 block format: sequences of a token (literal and match length nibbles),
+     *  literals, a 2 byte little endian match offset and length extension bytes. The last 5 bytes are always literals.
+     * Repeated formats and small integers in a block compress well even with a single probe per position.
+     */
+    struct lz {
+        static constexpr std::uint16_t id = lz_id;
+
+        static constexpr std::size_t hash_log = 12;
+        static constexpr std::size_t min_match = 4;
+        static constexpr std::size_t max_offset = 65535;
+        // The last match must start this far from the end, and the last `last_literals` bytes are literals
+        static constexpr std::size_t match_limit = 12;
+        static constexpr std::size_t last_literals = 5;
+
+        static constexpr std::size_t max_compressed_size(std::size_t len) {
+            return len + len / 255 + 16;
+        }
+
+        static std::size_t compress(const std::uint8_t *src, std::size_t len, std::uint8_t *dst, std::size_t capacity) {
+            std::uint32_t table[1 << hash_log] = {};
+            std::size_t anchor = 0;
+            std::size_t ip = 0;
+            std::size_t op = 0;
+            if (len > match_limit) {
+                const std::size_t match_end = len - last_literals;
+                while (ip < len - match_limit) {
+                    auto sequence = load<std::uint32_t>(src + ip);
+                    auto& slot = table[hash(sequence)];
+                    std::size_t ref = slot;
+                    slot = static_cast<std::uint32_t>(ip);
+                    if (ref >= ip || ip - ref > max_offset || load<std::uint32_t>(src + ref) != sequence) {
+                        // Skip faster through data that doesn't compress
+                        ip += 1 + ((ip - anchor) >> 6);
+                        continue;
+                    }
+                    auto match_len = min_match + common_length(src + ref + min_match, src + ip + min_match, match_end - ip - min_match);
+                    if (!write_sequence(dst, capacity, op, src + anchor, ip - anchor, ip - ref, match_len)) {
+                        return 0;
+                    }
+                    ip += match_len;
+                    anchor = ip;
+                }
+            }
+            if (!write_sequence(dst, capacity, op, src + anchor, len - anchor, 0, 0)) {
+                return 0;
+            }
+            return op;
+        }
+
+        static bool decompress(const std::uint8_t *src, std::size_t len, std::uint8_t *dst, std::size_t dst_len) {
+            std::size_t ip = 0;
+            std::size_t op = 0;
+            while (ip < len) {
+                auto token = src[ip++];
+                std::size_t literals = token >> 4;
+                if (literals == 15 && !read_length(src, len, ip, literals)) {
+                    return false;
+                }
+                if (len - ip < literals || dst_len - op < literals) {
+                    return false;
+                }
+                std::memcpy(dst + op, src + ip, literals);
+                ip += literals;
+                op += literals;
+                if (ip == len) {
+                    break;
+                }
+
+                if (len - ip < 2) {
+                    return false;
+                }
+                std::size_t offset = src[ip] | (static_cast<std::size_t>(src[ip + 1]) << 8);
+                ip += 2;
+                std::size_t match_len = token & 15;
+                if (match_len == 15 && !read_length(src, len, ip, match_len)) {
+                    return false;
+                }
+                match_len += min_match;
+                if (offset == 0 || offset > op || dst_len - op < match_len) {
+                    return false;
+                }
+                if (offset >= match_len) {
+                    std::memcpy(dst + op, dst + op - offset, match_len);
+                } else {
+                    // Overlapping, i.e. a run
+                    for (std::size_t i = 0; i < match_len; i++) {
+                        dst[op + i] = dst[op - offset + i];
+                    }
+                }
+                op += match_len;
+            }
+            return op == dst_len;
+        }
+
+    private:
+        template<typename T>
+        static T load(const std::uint8_t *src) {
+            T value;
+            std::memcpy(&value, src, sizeof(value));
+            return value;
+        }
+        static std::size_t hash(std::uint32_t sequence) {
+            return (sequence * 2654435761u) >> (32 - hash_log);
+        }
+        // The number of equal bytes at `a` and `b`, up to `max`
+        static std::size_t common_length(const std::uint8_t *a, const std::uint8_t *b, std::size_t max) {
+            std::size_t len = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            for (; len + sizeof(std::uint64_t) <= max; len += sizeof(std::uint64_t)) {
+                auto diff = load<std::uint64_t>(a + len) ^ load<std::uint64_t>(b + len);
+                if (diff) {
+                    return len + __builtin_ctzll(diff) / 8;
+                }
+            }
+#endif
+            while (len < max && a[len] == b[len]) {
+                len++;
+            }
+            return len;
+        }
+        static bool write_length(std::uint8_t *dst, std::size_t capacity, std::size_t& op, std::size_t len) {
+            for (; len >= 255; len -= 255) {
+                if (op == capacity) {
+                    return false;
+                }
+                dst[op++] = 255;
+            }
+            if (op == capacity) {
+                return false;
+            }
+            dst[op++] = static_cast<std::uint8_t>(len);
+            return true;
+        }
+        static bool read_length(const std::uint8_t *src, std::size_t len, std::size_t& ip, std::size_t& value) {
+            std::uint8_t byte;
+            do {
+                if (ip == len) {
+                    return false;
+                }
+                byte = src[ip++];
+                value += byte;
+            } while (byte == 255);
+            return true;
+        }
+        // A match length of 0 ends the block: only literals are written
+        static bool write_sequence(std::uint8_t *dst, std::size_t capacity, std::size_t& op, const std::uint8_t *literals,
+                std::size_t literal_len, std::size_t offset, std::size_t match_len) {
+            if (op == capacity) {
+                return false;
+            }
+            auto& token = dst[op++];
+            token = static_cast<std::uint8_t>(std::min<std::size_t>(literal_len, 15) << 4);
+            if (literal_len >= 15 && !write_length(dst, capacity, op, literal_len - 15)) {
+                return false;
+            }
+            if (capacity - op < literal_len) {
+                return false;
+            }
+            std::memcpy(dst + op, literals, literal_len);
+            op += literal_len;
+            if (match_len == 0) {
+                return true;
+            }
+            if (capacity - op < 2) {
+                return false;
+            }
+            dst[op++] = static_cast<std::uint8_t>(offset);
+            dst[op++] = static_cast<std::uint8_t>(offset >> 8);
+            auto extra = match_len - min_match;
+            token |= static_cast<std::uint8_t>(std::min<std::size_t>(extra, 15));
+            return extra < 15 || write_length(dst, capacity, op, extra - 15);
+        }
+    };
+
+#if defined(LLCPP_USE_ZSTD)
+    // Smaller output than `lz` for more CPU on the flushing path, link with libzstd
+    template<int Level = 1>
+    struct zstd {
+        static constexpr std::uint16_t id = zstd_id;
+
+        static std::size_t max_compressed_size(std::size_t len) {
+            return ZSTD_compressBound(len);
+        }
+        static std::size_t compress(const std::uint8_t *src, std::size_t len, std::uint8_t *dst, std::size_t capacity) {
+            auto size = ZSTD_compress(dst, capacity, src, len, Level);
+            return (ZSTD_isError(size)) ? (0) : (size);
+        }
+        static bool decompress(const std::uint8_t *src, std::size_t len, std::uint8_t *dst, std::size_t dst_len) {
+            auto size = ZSTD_decompress(dst, dst_len, src, len);
+            return !ZSTD_isError(size) && size == dst_len;
+        }
+    };
+#endif
+
+    inline bool is_supported(std::uint16_t codec) {
+        switch (codec) {
+            case stored_id:
+            case lz_id:
+                return true;
+#if defined(LLCPP_USE_ZSTD)
+            case zstd_id:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+    // Decompress `len` bytes compressed by `codec` into exactly `dst_len` bytes
+    inline bool decompress(std::uint16_t codec, const std::uint8_t *src, std::size_t len, std::uint8_t *dst, std::size_t dst_len) {
+        switch (codec) {
+            case stored_id:
+                if (len != dst_len) {
+                    return false;
+                }
+                std::memcpy(dst, src, len);
+                return true;
+            case lz_id:
+                return lz::decompress(src, len, dst, dst_len);
+#if defined(LLCPP_USE_ZSTD)
+            case zstd_id:
+                return zstd<>::decompress(src, len, dst, dst_len);
+#endif
+            default:
+                return false;
+        }
+    }
+}
@@ -3,6 +3,9 @@
 #include "utils.hpp"
 #include "terminators.hpp"
 #include "log_line.hpp"
+#include "level.hpp"
+#include "file_writer.hpp"
+#include "compression.hpp"
 
 namespace llcpp::detail::config {
     struct base_config {
@@ -19,7 +22,53 @@ namespace llcpp::detail::config {
          */
         using terminator_tuple = terminators::builtin_terminator_tuple;
         using additional_terminators = std::tuple<>;
-
+        /*
+         * Write a format's id instead of the format itself on each record. The format is written once per logger,
+         *  in a dictionary entry, the first time the id is used. See format_dictionary.hpp.
+         */
+        static constexpr bool use_format_dictionary = false;
+        // Lines below this level are compiled out. The logger's runtime level can only filter further.
+        static constexpr logging::level::level_enum min_level = logging::level::trace;
+        /*
+         * Write file_logger's output in the framed container: a file header, checksummed blocks of up to `block_size`
+         *  bytes of records and a trailing block index. See framing.hpp.
+         */
+        static constexpr bool use_framing = false;
+        static constexpr std::size_t block_size = 64 * 1024;
+        // Size of file_logger's per-thread buffers (when not framing, blocks are buffered whole)
+        static constexpr std::size_t buffer_size = 4 * 1024;
+        /*
+         * When file_logger flushes a buffer before it's full: lines at or above `flush_level` are flushed (along with
+         *  the file writer) before the call returns, and a buffer holding lines older than `flush_interval_ms` is
+         *  flushed by the next line to end in it (0 never does).
+         */
+        static constexpr logging::level::level_enum flush_level = logging::level::off;
+        static constexpr std::size_t flush_interval_ms = 0;
+        // Shard file_logger's buffers by CPU instead of by thread
+        static constexpr bool use_per_cpu_buffers = false;
+        // How file_logger writes its flushed buffers to the file. See file_writer.hpp.
+        using file_writer = file_writer::stdio_writer;
+        /*
+         * Write integers as varints and timestamps as varint deltas from the previous one, see terminators::compact.
+         * Set along with the terminator tuple by `config_with_compact_encoding`.
+         */
+        static constexpr bool use_compact_encoding = false;
+        // Compress file_logger's data blocks when they're flushed (requires framing). See compression.hpp.
+        using compressor = compression::none;
+        /*
+         * Keep file_logger's buffers in a file backed shared mapping (`<log path>.crash`, up to `crash_buffer_slots`
+         *  buffers), so the lines they hold can be recovered after a crash. See crash_buffer.hpp.
+         */
+        static constexpr bool use_crash_buffer = false;
+        static constexpr std::size_t crash_buffer_slots = 64;
+        /*
+         * Count lines, bytes and logging call latency per format, and flush and rotation stalls, in per-thread
+         *  counters (see stats.hpp and `logger_base::stats_snapshot`). With `stats_report_interval_ms`, file_logger
+         *  and socket_logger also log the busiest formats' statistics, as info lines, from the first flush (or batch
+         *  sent) of each interval (0 never does).
+         */
+        static constexpr bool use_stats = false;
+        static constexpr std::size_t stats_report_interval_ms = 0;
     };
 
     template<typename FormatParser, typename Base>
@@ -39,6 +88,59 @@ namespace llcpp::detail::config {
         using additional_terminators = AdditionalTerminators;
     };
 
+    template<bool UseFormatDictionary, typename Base>
+    struct _config_with_format_dictionary : public Base {
+        static constexpr bool use_format_dictionary = UseFormatDictionary;
+    };
+    template<logging::level::level_enum MinLevel, typename Base>
+    struct _config_with_min_level : public Base {
+        static constexpr logging::level::level_enum min_level = MinLevel;
+    };
+
+    template<bool UseFraming, std::size_t BlockSize, typename Base>
+    struct _config_with_framing : public Base {
+        static constexpr bool use_framing = UseFraming;
+        static constexpr std::size_t block_size = BlockSize;
+    };
+
+    template<std::size_t BufferSize, typename Base>
+    struct _config_with_buffer_size : public Base {
+        static constexpr std::size_t buffer_size = BufferSize;
+    };
+    template<logging::level::level_enum FlushLevel, std::size_t FlushIntervalMs, typename Base>
+    struct _config_with_flush_policy : public Base {
+        static constexpr logging::level::level_enum flush_level = FlushLevel;
+        static constexpr std::size_t flush_interval_ms = FlushIntervalMs;
+    };
+    template<bool UsePerCpuBuffers, typename Base>
+    struct _config_with_per_cpu_buffers : public Base {
+        static constexpr bool use_per_cpu_buffers = UsePerCpuBuffers;
+    };
+    template<typename FileWriter, typename Base>
+    struct _config_with_file_writer : public Base {
+        using file_writer = FileWriter;
+    };
+    template<typename Compressor, typename Base>
+    struct _config_with_compression : public Base {
+        using compressor = Compressor;
+    };
+    template<bool UseCrashBuffer, std::size_t SlotCount, typename Base>
+    struct _config_with_crash_buffer : public Base {
+        static constexpr bool use_crash_buffer = UseCrashBuffer;
+        static constexpr std::size_t crash_buffer_slots = SlotCount;
+    };
+    template<bool UseStats, std::size_t ReportIntervalMs, typename Base>
+    struct _config_with_stats : public Base {
+        static constexpr bool use_stats = UseStats;
+        static constexpr std::size_t stats_report_interval_ms = ReportIntervalMs;
+    };
+    template<bool UseCompactEncoding, typename Base>
+    struct _config_with_compact_encoding : public Base {
+        static constexpr bool use_compact_encoding = UseCompactEncoding;
+        using terminator_tuple = std::conditional_t<UseCompactEncoding,
+            terminators::compact_terminator_tuple, typename Base::terminator_tuple>;
+    };
+
     template<typename Base = base_config>
     struct config : public Base {
         template<typename FormatParser>
@@ -49,6 +151,28 @@ namespace llcpp::detail::config {
         using config_with_terminator_tuple = config<_config_with_terminator_tuple<TerminatorTuple, config>>;
         template<typename AdditionalTerminators>
         using config_with_additional_terminators = config<_config_with_additional_terminators<AdditionalTerminators, config>>;
+        template<bool UseFormatDictionary = true>
+        using config_with_format_dictionary = config<_config_with_format_dictionary<UseFormatDictionary, config>>;
+        template<logging::level::level_enum MinLevel>
+        using config_with_min_level = config<_config_with_min_level<MinLevel, config>>;
+        template<bool UseFraming = true, std::size_t BlockSize = 64 * 1024>
+        using config_with_framing = config<_config_with_framing<UseFraming, BlockSize, config>>;
+        template<std::size_t BufferSize>
+        using config_with_buffer_size = config<_config_with_buffer_size<BufferSize, config>>;
+        template<logging::level::level_enum FlushLevel = logging::level::err, std::size_t FlushIntervalMs = 0>
+        using config_with_flush_policy = config<_config_with_flush_policy<FlushLevel, FlushIntervalMs, config>>;
+        template<bool UsePerCpuBuffers = true>
+        using config_with_per_cpu_buffers = config<_config_with_per_cpu_buffers<UsePerCpuBuffers, config>>;
+        template<typename FileWriter>
+        using config_with_file_writer = config<_config_with_file_writer<FileWriter, config>>;
+        template<typename Compressor = compression::lz>
+        using config_with_compression = config<_config_with_compression<Compressor, config>>;
+        template<bool UseCrashBuffer = true, std::size_t SlotCount = 64>
+        using config_with_crash_buffer = config<_config_with_crash_buffer<UseCrashBuffer, SlotCount, config>>;
+        template<bool UseStats = true, std::size_t ReportIntervalMs = 0>
+        using config_with_stats = config<_config_with_stats<UseStats, ReportIntervalMs, config>>;
+        template<bool UseCompactEncoding = true>
+        using config_with_compact_encoding = config<_config_with_compact_encoding<UseCompactEncoding, config>>;
     };
 
     using default_config = config<base_config>;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+#include <sched.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define LLCPP_HAS_RSEQ 1
+#else
+#define LLCPP_HAS_RSEQ 0
+#endif
+
+namespace llcpp::detail::cpu {
+    // Number of configured CPUs, an upper bound of `current()`
+    inline std::size_t count() {
+        static const std::size_t s_count = [] {
+            auto n = ::sysconf(_SC_NPROCESSORS_CONF);
+            return (n > 0) ? (static_cast<std::size_t>(n)) : (std::size_t(1));
+        }();
+        return s_count;
+    }
+
+    /*
+     * The CPU the calling thread is running on, which may be stale as soon as it's returned.
+     * Read from the thread's rseq area when glibc registered one (a plain load), sched_getcpu otherwise.
+     */
+    inline std::size_t current() {
+#if LLCPP_HAS_RSEQ
+        if (__rseq_size > 0) {
+            auto area = reinterpret_cast<const volatile struct rseq *>(
+                static_cast<const char *>(__builtin_thread_pointer()) + __rseq_offset);
+            auto cpu = static_cast<int>(area->cpu_id);
+            if (cpu >= 0) {
+                return static_cast<std::size_t>(cpu);
+            }
+        }
+#endif
+        auto cpu = ::sched_getcpu();
+        return (cpu >= 0) ? (static_cast<std::size_t>(cpu)) : (0);
+    }
+}
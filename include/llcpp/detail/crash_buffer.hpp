@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "framing.hpp"
+#include "rotation.hpp"
+
+namespace llcpp::detail::crash_buffer {
+    /*
+     * With `config_with_crash_buffer<>`, file_logger's buffers live in the slots of a file backed shared mapping
+     *  (`<log path>.crash`) instead of the heap, so their complete lines survive the process dying:
+     *  [region_header][slot]... with each slot a slot_header followed by a buffer.
+     * A slot's header says how much of its buffer is complete lines not yet written to the log, it's updated as
+     *  lines end and as the buffer is flushed. After a crash, `recover` appends those lines to the log.
+     * The mapping is removed when the logger is destroyed.
+     */
+    inline constexpr std::array<char, 8> region_magic = {{'L', 'L', 'C', 'P', 'P', 'C', 'R', 'B'}};
+    constexpr std::uint32_t region_version = 1;
+
+    enum region_flags : std::uint32_t {
+        // Buffers hold a block header followed by the block's payload
+        framed_flag = 1,
+    };
+    enum slot_state : std::uint32_t {
+        free_slot = 0,
+        used_slot = 1,
+        // Being written to the log from `flush_offset`, its lines may be there already, in part or in full
+        flushing_slot = 2,
+    };
+
+    struct alignas(64) region_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t flags;
+        std::uint32_t slot_count;
+        // Buffer bytes per slot
+        std::uint32_t buffer_size;
+        std::int64_t pid;
+        // Rotation index of the file being written (see rotation::file_name)
+        std::atomic<std::uint64_t> file_index;
+    };
+    struct alignas(64) slot_header {
+        std::atomic<std::uint32_t> state;
+        // Bytes of complete lines at the start of the buffer's payload
+        std::atomic<std::uint64_t> committed;
+        // Framing only, the block the lines are recovered as
+        std::atomic<std::uint64_t> line_count;
+        std::atomic<std::uint64_t> block_timestamp;
+        std::atomic<std::uint64_t> flush_offset;
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared atomics must be lock free");
+
+    // Around a slot's write to the log, nullptr (no slot) is ignored
+    inline void begin_flush(slot_header *slot, std::uint64_t offset) {
+        if (slot) {
+            slot->flush_offset.store(offset, std::memory_order_relaxed);
+            slot->state.store(flushing_slot, std::memory_order_release);
+        }
+    }
+    inline void end_flush(slot_header *slot) {
+        if (slot) {
+            slot->committed.store(0, std::memory_order_relaxed);
+            slot->state.store(used_slot, std::memory_order_release);
+        }
+    }
+
+    inline std::string region_path(std::string_view log_path) {
+        return std::string(log_path) + ".crash";
+    }
+
+    struct region {
+        region(std::string_view log_path, std::uint32_t slot_count, std::uint32_t buffer_size, std::uint32_t flags) :
+            m_path(region_path(log_path)), m_slot_count(slot_count), m_slot_size(sizeof(slot_header) + align(buffer_size)),
+            m_size(sizeof(region_header) + m_slot_count * m_slot_size)
+        {
+            int fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                return;
+            }
+            if (::ftruncate(fd, static_cast<off_t>(m_size)) == 0) {
+                void *base = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                m_base = (base == MAP_FAILED) ? (nullptr) : (static_cast<std::uint8_t *>(base));
+            }
+            ::close(fd);
+            if (!m_base) {
+                ::unlink(m_path.c_str());
+                return;
+            }
+            auto header = new (m_base) region_header;
+            header->version = region_version;
+            header->flags = flags;
+            header->slot_count = slot_count;
+            header->buffer_size = buffer_size;
+            header->pid = ::getpid();
+            header->file_index.store(0, std::memory_order_relaxed);
+            for (std::uint32_t i = 0; i < m_slot_count; i++) {
+                auto slot = new (slot_at(i)) slot_header;
+                slot->state.store(free_slot, std::memory_order_relaxed);
+                slot->committed.store(0, std::memory_order_relaxed);
+            }
+            // Last, recover ignores a region without its magic
+            std::memcpy(header->magic, region_magic.data(), sizeof(header->magic));
+        }
+        region(const region&) = delete;
+        region& operator=(const region&) = delete;
+        ~region() {
+            if (m_base) {
+                ::munmap(m_base, m_size);
+                ::unlink(m_path.c_str());
+            }
+        }
+
+        bool is_open() const {
+            return m_base != nullptr;
+        }
+        // A free slot, nullptr if they're all taken
+        slot_header *acquire() {
+            for (std::uint32_t i = 0; m_base && i < m_slot_count; i++) {
+                auto slot = slot_at(i);
+                std::uint32_t expected = free_slot;
+                if (slot->state.compare_exchange_strong(expected, used_slot, std::memory_order_acq_rel)) {
+                    return slot;
+                }
+            }
+            return nullptr;
+        }
+        static void release(slot_header *slot) {
+            slot->committed.store(0, std::memory_order_relaxed);
+            slot->state.store(free_slot, std::memory_order_release);
+        }
+        static std::uint8_t *buffer(slot_header *slot) {
+            return reinterpret_cast<std::uint8_t *>(slot) + sizeof(slot_header);
+        }
+        void set_file_index(std::uint64_t idx) {
+            reinterpret_cast<region_header *>(m_base)->file_index.store(idx, std::memory_order_relaxed);
+        }
+
+        static constexpr std::size_t align(std::size_t size) {
+            return (size + alignof(slot_header) - 1) / alignof(slot_header) * alignof(slot_header);
+        }
+
+    private:
+        slot_header *slot_at(std::uint32_t i) const {
+            return reinterpret_cast<slot_header *>(m_base + sizeof(region_header) + i * m_slot_size);
+        }
+
+        const std::string m_path;
+        const std::size_t m_slot_count;
+        const std::size_t m_slot_size;
+        const std::size_t m_size;
+        std::uint8_t *m_base = nullptr;
+    };
+
+    struct recovery {
+        // The log the lines were appended to
+        std::string log_path;
+        std::size_t buffers = 0;
+        std::uint64_t bytes = 0;
+        // Bytes of an interrupted write dropped from the end of the log, their lines are appended again
+        std::uint64_t truncated = 0;
+        const char *error = nullptr;
+    };
+
+    /*
+     * Append the complete lines left in a dead logger's buffers to its log (the file it was writing when rotating),
+     *  as blocks when it was framed, and remove the region. The lines are in the order of the buffers, not of time.
+     * Refuses to touch the region of a live process unless `force`.
+     */
+    inline recovery recover(std::string_view log_path, bool force = false) {
+        recovery result;
+        auto path = region_path(log_path);
+        int region_fd = ::open(path.c_str(), O_RDWR);
+        struct stat st;
+        if (region_fd < 0 || ::fstat(region_fd, &st) != 0) {
+            result.error = "can't open the crash buffer";
+            if (region_fd >= 0) {
+                ::close(region_fd);
+            }
+            return result;
+        }
+        auto size = static_cast<std::size_t>(st.st_size);
+        void *mapping = (size >= sizeof(region_header)) ?
+            (::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, region_fd, 0)) : (MAP_FAILED);
+        ::close(region_fd);
+        if (mapping == MAP_FAILED) {
+            result.error = "can't map the crash buffer";
+            return result;
+        }
+        auto base = static_cast<std::uint8_t *>(mapping);
+        auto header = reinterpret_cast<region_header *>(base);
+        bool framed = header->flags & framed_flag;
+        auto slot_size = sizeof(slot_header) + region::align(header->buffer_size);
+        auto payload_offset = (framed) ? (sizeof(framing::block_header)) : (0);
+        auto finish = [&](const char *error) {
+            result.error = error;
+            ::munmap(mapping, size);
+            return result;
+        };
+        if (std::memcmp(header->magic, region_magic.data(), sizeof(header->magic)) != 0 ||
+                header->version != region_version || sizeof(region_header) + header->slot_count * slot_size > size) {
+            return finish("not a crash buffer");
+        }
+        if (!force && header->pid > 0 && (::kill(static_cast<pid_t>(header->pid), 0) == 0 || errno == EPERM)) {
+            return finish("the logging process is still running");
+        }
+
+        std::vector<slot_header *> slots;
+        for (std::uint32_t i = 0; i < header->slot_count; i++) {
+            auto slot = reinterpret_cast<slot_header *>(base + sizeof(region_header) + i * slot_size);
+            auto committed = slot->committed.load(std::memory_order_acquire);
+            if (slot->state.load(std::memory_order_acquire) != free_slot && committed > 0 &&
+                    payload_offset + committed <= header->buffer_size) {
+                slots.push_back(slot);
+            }
+        }
+        if (framed) {
+            std::sort(slots.begin(), slots.end(), [](slot_header *a, slot_header *b) {
+                return a->block_timestamp.load(std::memory_order_relaxed) < b->block_timestamp.load(std::memory_order_relaxed);
+            });
+        }
+
+        result.log_path = rotation::file_name(log_path, header->file_index.load(std::memory_order_relaxed));
+        int log_fd = ::open(result.log_path.c_str(), O_RDWR | O_APPEND);
+        if (log_fd < 0) {
+            return finish("can't open the log");
+        }
+        std::uint64_t log_size = (::fstat(log_fd, &st) == 0) ? (st.st_size) : (0);
+        if (framed && log_size >= sizeof(framing::trailer)) {
+            std::array<char, sizeof(framing::index_magic)> magic;
+            if (::pread(log_fd, magic.data(), magic.size(), log_size - magic.size()) == static_cast<ssize_t>(magic.size()) &&
+                    std::memcmp(magic.data(), framing::index_magic.data(), magic.size()) == 0) {
+                ::close(log_fd);
+                return finish("the log was closed, its index is written");
+            }
+        }
+        // Writes are serialized, a flush interrupted by the crash is the end of the log: drop it, it's written again below
+        for (auto slot : slots) {
+            auto offset = slot->flush_offset.load(std::memory_order_relaxed);
+            if (slot->state.load(std::memory_order_relaxed) == flushing_slot && offset < log_size) {
+                if (::ftruncate(log_fd, static_cast<off_t>(offset)) != 0) {
+                    ::close(log_fd);
+                    return finish("can't truncate the log");
+                }
+                result.truncated += log_size - offset;
+                log_size = offset;
+            }
+        }
+
+        for (auto slot : slots) {
+            auto buffer = region::buffer(slot);
+            auto payload = buffer + payload_offset;
+            auto committed = slot->committed.load(std::memory_order_relaxed);
+            bool written;
+            if (framed) {
+                framing::block_header block;
+                framing::seal_block(block, static_cast<std::uint32_t>(committed), static_cast<std::uint32_t>(slot->line_count.load(std::memory_order_relaxed)),
+                    slot->block_timestamp.load(std::memory_order_relaxed), framing::data_block, payload);
+                std::memcpy(buffer, &block, sizeof(block));
+                written = ::write(log_fd, buffer, sizeof(block) + committed) == static_cast<ssize_t>(sizeof(block) + committed);
+            } else {
+                written = ::write(log_fd, payload, committed) == static_cast<ssize_t>(committed);
+            }
+            if (!written) {
+                ::close(log_fd);
+                return finish("can't write to the log");
+            }
+            region::release(slot);
+            result.buffers++;
+            result.bytes += committed;
+        }
+        ::close(log_fd);
+        ::munmap(mapping, size);
+        ::unlink(path.c_str());
+        return result;
+    }
+}
@@ -0,0 +1,1177 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.hpp"
+#include "terminators.hpp"
+#include "format_dictionary.hpp"
+#include "framing.hpp"
+#include "varint.hpp"
+#include "compression.hpp"
+
+namespace llcpp::detail::decoding {
+    using terminators::argument_layout;
+    using terminators::value_kind;
+    using terminators::value_encoding;
+
+    // A read only mapping of a whole file
+    struct mapped_file {
+        explicit mapped_file(std::string_view path) {
+            int fd = ::open(path.data(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED) {
+                    m_data = static_cast<const std::uint8_t *>(addr);
+                    m_size = st.st_size;
+                    ::madvise(addr, m_size, MADV_SEQUENTIAL);
+                }
+            }
+            m_is_open = (st.st_size == 0) || (m_data != nullptr);
+            ::close(fd);
+        }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file() {
+            if (m_data) {
+                ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+            }
+        }
+
+        bool is_open() const {
+            return m_is_open;
+        }
+        const std::uint8_t *data() const {
+            return m_data;
+        }
+        std::size_t size() const {
+            return m_size;
+        }
+
+    private:
+        const std::uint8_t *m_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_is_open = false;
+    };
+
+    /*
+     * The layout of a format's records, parsed once per distinct format.
+     * Formats are parsed exactly like format_parser does at compile time, and each argument's size is taken from
+     *  the terminator's `layout()`.
+     */
+    struct format_layout {
+        struct argument {
+            argument_layout layout;
+            // The characters between the '%' and the terminator
+            std::string_view spec;
+            // The terminator
+            char conversion;
+            // Offset in the record's fixed size part
+            std::size_t offset;
+        };
+        // Literal text followed by an argument (-1 for none)
+        struct piece {
+            std::string_view literal;
+            int argument;
+        };
+
+        std::string_view format;
+        std::vector<argument> arguments;
+        std::vector<piece> pieces;
+        std::size_t fixed_size = 0;
+        std::size_t variable_arguments = 0;
+        // Meta records (formats starting with '\x01') are consumed by the decoder, not shown
+        bool is_meta = false;
+        std::string_view meta_name;
+        // The terminator a format uses but which doesn't describe its layout, 0 if none
+        char unknown_terminator = 0;
+    };
+
+    template<typename... Terminators>
+    bool find_terminator(std::tuple<Terminators...> *, char ch, std::string_view spec, argument_layout& layout) {
+        return ((ch == Terminators::terminator_value && (layout = Terminators::layout(spec), true)) || ...);
+    }
+
+    template<typename Config>
+    format_layout parse_format(std::string_view format) {
+        using terminator_tuple = terminators::terminator_tuple_from_config<Config>;
+        format_layout result;
+        result.format = format;
+
+        bool is_escaped = false;
+        std::size_t escape_idx = 0;
+        std::size_t literal_begin = 0;
+        for (std::size_t i = 0; i < format.size(); i++) {
+            auto ch = format[i];
+            if (!is_escaped) {
+                if (ch == '%') {
+                    is_escaped = true;
+                    escape_idx = i;
+                }
+                continue;
+            }
+            argument_layout layout;
+            if (!find_terminator((terminator_tuple *)nullptr, ch, format.substr(escape_idx + 1, i - escape_idx - 1), layout)) {
+                continue;
+            }
+            is_escaped = false;
+            auto literal = format.substr(literal_begin, escape_idx - literal_begin);
+            if (layout.kind == value_kind::percent) {
+                // The second '%' starts the next literal
+                result.pieces.push_back({literal, -1});
+                literal_begin = i;
+                continue;
+            }
+            if (layout.kind == value_kind::none) {
+                result.unknown_terminator = ch;
+                continue;
+            }
+            result.pieces.push_back({literal, static_cast<int>(result.arguments.size())});
+            result.arguments.push_back({layout, format.substr(escape_idx + 1, i - escape_idx - 1), ch, result.fixed_size});
+            result.fixed_size += layout.size;
+            result.variable_arguments += (layout.is_variable) ? (1) : (0);
+            literal_begin = i + 1;
+        }
+        result.pieces.push_back({format.substr(literal_begin), -1});
+
+        if (!format.empty() && format[0] == '\x01') {
+            result.is_meta = true;
+            result.meta_name = format.substr(1, format.find(' ') - 1);
+        }
+        return result;
+    }
+
+    // Written by tsc_time_prefix, converts its cycle counts to wall time
+    struct tsc_calibration {
+        std::uint64_t cycles;
+        std::uint64_t realtime_ns;
+        std::uint64_t frequency;
+
+        std::uint64_t to_ns(std::uint64_t cycles_value) const {
+            auto delta = static_cast<std::int64_t>(cycles_value - cycles);
+#if defined(__SIZEOF_INT128__)
+            // A GNU extension, marked so the header stays clean under -Wpedantic
+            __extension__ typedef __int128 int128_t;
+            int128_t scaled = static_cast<int128_t>(delta) * 1000000000;
+            // Round towards negative infinity, like the cycle counter does
+            int128_t ns = scaled / frequency - ((scaled % frequency < 0) ? (1) : (0));
+            return realtime_ns + static_cast<std::int64_t>(ns);
+#else
+            return realtime_ns + static_cast<std::int64_t>(static_cast<long double>(delta) * 1e9L / frequency);
+#endif
+        }
+    };
+
+    // Written by the logger for each type logged with "%T", see objects.hpp
+    struct object_schema {
+        struct field {
+            std::string name;
+            char kind;
+            std::size_t offset;
+            std::size_t size;
+        };
+        std::string name;
+        std::vector<field> fields;
+
+        // From the "name:kind:offset:size,..." list of the schema record
+        static object_schema parse(std::string_view name, std::string_view fields) {
+            object_schema result;
+            result.name = std::string(name);
+            while (!fields.empty()) {
+                auto end = std::min(fields.find(','), fields.size());
+                auto description = fields.substr(0, end);
+                fields.remove_prefix(std::min(end + 1, fields.size()));
+                auto name_end = description.find(':');
+                if (name_end == std::string_view::npos || name_end + 3 > description.size()) {
+                    continue;
+                }
+                field f{std::string(description.substr(0, name_end)), description[name_end + 1], 0, 0};
+                auto numbers = description.substr(name_end + 3);
+                auto offset_end = numbers.find(':');
+                if (offset_end == std::string_view::npos ||
+                        std::from_chars(numbers.data(), numbers.data() + offset_end, f.offset).ec != std::errc() ||
+                        std::from_chars(numbers.data() + offset_end + 1, numbers.data() + numbers.size(), f.size).ec != std::errc()) {
+                    continue;
+                }
+                result.fields.push_back(std::move(f));
+            }
+            return result;
+        }
+    };
+    using schema_map = std::unordered_map<std::uint64_t, object_schema>;
+
+    /*
+     * Before format version 2, fixed size integers were 4 bytes per 'l' (so "%ld" was 4 bytes), and 'h' was ignored.
+     * Only framed logs record their version, plain logs are decoded with the current sizes.
+     */
+    inline void use_legacy_integer_sizes(format_layout& layout) {
+        std::size_t offset = 0;
+        for (auto& arg : layout.arguments) {
+            bool is_integer = arg.layout.kind == value_kind::signed_integer || arg.layout.kind == value_kind::unsigned_integer ||
+                arg.layout.kind == value_kind::hex_integer;
+            if (is_integer && arg.layout.encoding == value_encoding::fixed) {
+                auto num_of_l = std::count(arg.spec.begin(), arg.spec.end(), 'l');
+                arg.layout.size = (num_of_l == 2) ? (sizeof(std::uint64_t)) : (sizeof(std::uint32_t));
+            }
+            arg.offset = offset;
+            offset += arg.layout.size;
+        }
+        layout.fixed_size = offset;
+    }
+
+    /*
+     * A decoded record. Points into the decoded buffer (or the decoder's copy of a decompressed block, see
+     *  `decoder::discard_decompressed`) and the decoder's layouts, so it is valid as long as both are.
+     */
+    struct record {
+        const format_layout *layout = nullptr;
+        // The record's fixed size part and the variable size data following it
+        const std::uint8_t *fixed = nullptr;
+        const std::uint8_t *variable = nullptr;
+        // Offset of the record in the decoded buffer, or in its block's payload when the block was compressed
+        std::uint64_t offset = 0;
+        // The calibration in effect when the record was decoded, nullptr if none
+        const tsc_calibration *calibration = nullptr;
+        // What the record's compact timestamps are deltas from
+        std::uint64_t timestamp_base = 0;
+        // The object schemas read so far, nullptr if none
+        const schema_map *schemas = nullptr;
+
+        std::string_view format() const {
+            return layout->format;
+        }
+        std::size_t argument_count() const {
+            return layout->arguments.size();
+        }
+        const format_layout::argument& argument(std::size_t idx) const {
+            return layout->arguments[idx];
+        }
+        std::int64_t signed_value(std::size_t idx) const {
+            auto& arg = argument(idx);
+            if (arg.layout.encoding != value_encoding::fixed) {
+                return static_cast<std::int64_t>(varint_value(idx));
+            }
+            switch (arg.layout.size) {
+                case sizeof(std::int8_t):
+                    return load<std::int8_t>(arg.offset);
+                case sizeof(std::int16_t):
+                    return load<std::int16_t>(arg.offset);
+                case sizeof(std::int32_t):
+                    return load<std::int32_t>(arg.offset);
+                default:
+                    return load<std::int64_t>(arg.offset);
+            }
+        }
+        std::uint64_t unsigned_value(std::size_t idx) const {
+            auto& arg = argument(idx);
+            if (arg.layout.encoding != value_encoding::fixed) {
+                return varint_value(idx);
+            }
+            switch (arg.layout.size) {
+                case sizeof(std::uint8_t):
+                    return fixed[arg.offset];
+                case sizeof(std::uint16_t):
+                    return load<std::uint16_t>(arg.offset);
+                case sizeof(std::uint32_t):
+                    return load<std::uint32_t>(arg.offset);
+                default:
+                    return load<std::uint64_t>(arg.offset);
+            }
+        }
+        // A %f (double) or %hf (float) argument
+        double floating_value(std::size_t idx) const {
+            auto& arg = argument(idx);
+            if (arg.layout.size == sizeof(float)) {
+                return load<float>(arg.offset);
+            }
+            return load<double>(arg.offset);
+        }
+        std::string_view string_value(std::size_t idx) const {
+            auto& arg = argument(idx);
+            if (!arg.layout.is_variable) {
+                auto data = reinterpret_cast<const char *>(fixed + arg.offset);
+                auto end = static_cast<const char *>(std::memchr(data, '\0', arg.layout.size));
+                return std::string_view(data, (end) ? (end - data) : (arg.layout.size));
+            }
+            auto offset = variable_offset(idx);
+            return std::string_view(reinterpret_cast<const char *>(variable + offset), variable_length(idx, offset));
+        }
+        // Nanoseconds since the epoch of a %t or %#t argument, false if cycles can't be converted (no calibration yet)
+        bool timestamp_value(std::size_t idx, std::uint64_t& ns) const {
+            ns = unsigned_value(idx);
+            if (argument(idx).layout.kind == value_kind::cycles) {
+                if (!calibration || calibration->frequency == 0) {
+                    return false;
+                }
+                ns = calibration->to_ns(ns);
+            }
+            return true;
+        }
+        // The bytes of a %T argument, and its schema (nullptr if the log doesn't have it)
+        const object_schema *object_value(std::size_t idx, std::string_view& bytes) const {
+            auto& arg = argument(idx);
+            auto offset = variable_offset(idx);
+            bytes = std::string_view(reinterpret_cast<const char *>(variable + offset), variable_length(idx, offset));
+            auto id = load<std::uint64_t>(arg.offset + sizeof(terminators::T::object_size_type));
+            if (!schemas) {
+                return nullptr;
+            }
+            auto it = schemas->find(id);
+            return (it != schemas->end()) ? (&it->second) : (nullptr);
+        }
+
+    private:
+        template<typename T>
+        T load(std::size_t offset) const {
+            T value;
+            std::memcpy(&value, fixed + offset, sizeof(value));
+            return value;
+        }
+        // Variable size data (strings and varints) is laid out in the order of the arguments
+        std::size_t variable_offset(std::size_t idx) const {
+            std::size_t offset = 0;
+            for (std::size_t i = 0; i < idx; i++) {
+                if (layout->arguments[i].layout.is_variable) {
+                    offset += variable_length(i, offset);
+                }
+            }
+            return offset;
+        }
+        std::size_t variable_length(std::size_t idx, std::size_t offset) const {
+            if (argument(idx).layout.encoding == value_encoding::fixed) {
+                return load<terminators::s::variable_string_length_type>(argument(idx).offset);
+            }
+            std::uint64_t value;
+            return varint::decode(variable + offset, varint::max_size, value);
+        }
+        // The decoder checked that the varints are complete
+        std::uint64_t varint_value(std::size_t idx) const {
+            auto& arg = argument(idx);
+            std::uint64_t value;
+            varint::decode(variable + variable_offset(idx), varint::max_size, value);
+            if (arg.layout.encoding == value_encoding::timestamp_delta) {
+                return timestamp_base + static_cast<std::uint64_t>(varint::unzigzag(value));
+            }
+            return (arg.layout.kind == value_kind::signed_integer) ? (static_cast<std::uint64_t>(varint::unzigzag(value))) : (value);
+        }
+    };
+
+    /*
+     * Iterates the records of a log, plain or framed (see framing.hpp), with or without a format dictionary.
+     * Dictionary entries and meta records are consumed, `next` returns the records to be shown.
+     * In a framed log, blocks that fail their checksum are skipped and decoding resumes on the next sync marker.
+     * Compact encoding is recorded in a framed log's header, plain logs need `Config::use_compact_encoding`
+     *  or `set_compact_encoding`. Compressed blocks are decompressed as they're entered.
+     */
+    template<typename Config = config::default_config>
+    struct decoder {
+        decoder(const std::uint8_t *data, std::size_t size) : m_data(data), m_size(size), m_data_end(size), m_buf(data), m_end(size) {
+            if (size >= sizeof(framing::file_header) && std::memcmp(data, framing::file_magic.data(), framing::file_magic.size()) == 0) {
+                read_file_header();
+                return;
+            }
+            format_dictionary::format_id_type first;
+            m_use_format_dictionary = (size >= sizeof(first)) &&
+                (std::memcpy(&first, data, sizeof(first)), first == format_dictionary::dictionary_marker);
+        }
+        decoder(const decoder&) = delete;
+        decoder& operator=(const decoder&) = delete;
+
+        // Returns false at the end of the data, or on error (see `error()`)
+        bool next(record& out) {
+            while (!m_error) {
+                if (m_pos >= m_end) {
+                    if (!next_block() || !load_block()) {
+                        return false;
+                    }
+                    continue;
+                }
+                switch (decode_one(out)) {
+                    case step::record:
+                        return true;
+                    case step::consumed:
+                        continue;
+                    case step::failed:
+                        return false;
+                }
+            }
+            return false;
+        }
+
+        // Why decoding stopped before the end of the data, nullptr if it didn't
+        const char *error() const {
+            return m_error;
+        }
+        // Where decoding stopped: the record's offset in the log, or its block's when the block was compressed
+        std::uint64_t position() const {
+            return (m_buf == m_data) ? (m_pos) : (m_block.offset);
+        }
+        bool uses_format_dictionary() const {
+            return m_use_format_dictionary;
+        }
+        bool uses_compact_encoding() const {
+            return m_use_compact_encoding;
+        }
+        // Must be called before the first `next`
+        void set_compact_encoding(bool use_compact_encoding) {
+            m_use_compact_encoding = use_compact_encoding;
+        }
+
+        // Framed logs only
+        bool is_framed() const {
+            return m_framed;
+        }
+        // The trailing block index, empty if the log has none (i.e. the logger wasn't destroyed)
+        const std::vector<framing::index_entry>& block_index() const {
+            return m_index;
+        }
+        // The block the last record was read from
+        const framing::index_entry& current_block() const {
+            return m_block;
+        }
+        // Bytes skipped while resyncing after corrupted blocks, and the rest of blocks with a format id never defined
+        std::uint64_t skipped_bytes() const {
+            return m_skipped_bytes;
+        }
+        /*
+         * Free the decompressed copies of the blocks before the current one. Records read from them are invalidated,
+         *  so call it once they're consumed (i.e. between batches).
+         */
+        void discard_decompressed() {
+            while (m_decompressed.size() > 1) {
+                m_decompressed.pop_front();
+            }
+        }
+        /*
+         * Continue decoding from the block at `offset` (i.e. from `block_index()`). Meta blocks before it are still
+         *  applied, so that a log can be split across several decoders.
+         */
+        bool seek(std::uint64_t offset) {
+            if (!m_framed) {
+                return false;
+            }
+            m_next_block = m_first_block;
+            m_calibration = nullptr;
+            record rec;
+            while (next_block()) {
+                if (m_block.offset >= offset) {
+                    return load_block();
+                }
+                if (m_block.flags == framing::meta_block) {
+                    if (!load_block()) {
+                        return false;
+                    }
+                    while (m_pos < m_end) {
+                        if (decode_one(rec) == step::failed) {
+                            return false;
+                        }
+                    }
+                }
+                m_pos = m_end;
+            }
+            return false;
+        }
+        // Continue decoding from the first data block whose first record was written at or after `ns`
+        bool seek_time(std::uint64_t ns) {
+            for (auto& entry : m_index) {
+                if (entry.flags == framing::data_block && entry.first_timestamp >= ns) {
+                    return seek(entry.offset);
+                }
+            }
+            if (!m_index.empty()) {
+                return false;
+            }
+            // No index, find the block by its header
+            return seek_if([ns](const framing::index_entry& block) {
+                return block.flags == framing::data_block && block.first_timestamp >= ns;
+            });
+        }
+        // Stop decoding at `offset` (a block's offset)
+        void set_end(std::uint64_t offset) {
+            m_data_end = std::min<std::uint64_t>(m_data_end, offset);
+        }
+
+    private:
+        enum class step {
+            record,
+            consumed,
+            failed,
+        };
+
+        bool fail(const char *error) {
+            m_error = error;
+            return false;
+        }
+
+        void read_file_header() {
+            framing::file_header header;
+            std::memcpy(&header, m_data, sizeof(header));
+            m_framed = true;
+            if (header.endianness != framing::native_endianness) {
+                fail("log written with a different endianness");
+                return;
+            }
+            if (header.version > framing::format_version) {
+                fail("log written with a newer format version");
+                return;
+            }
+            // Logs written before a terminator was added (i.e. "%T") still decode, logs using one we don't know don't
+            auto& terminator_set = framing::terminator_set<Config>;
+            if (m_size < sizeof(header) + header.terminator_count) {
+                fail("log written with a different terminator set");
+                return;
+            }
+            auto log_terminators = m_data + sizeof(header);
+            if (!std::all_of(log_terminators, log_terminators + header.terminator_count, [&](std::uint8_t ch) {
+                    return std::find(terminator_set.begin(), terminator_set.end(), static_cast<char>(ch)) != terminator_set.end();
+                })) {
+                fail("log written with a different terminator set");
+                return;
+            }
+            m_use_legacy_integer_sizes = header.version < 2;
+            m_use_format_dictionary = (header.flags & framing::format_dictionary_flag) != 0;
+            m_use_compact_encoding = (header.flags & framing::compact_encoding_flag) != 0;
+            m_first_block = m_next_block = sizeof(header) + header.terminator_count;
+            m_pos = m_end = 0;
+            read_index();
+        }
+        void read_index() {
+            framing::trailer trailer;
+            if (m_size < m_first_block + sizeof(trailer)) {
+                return;
+            }
+            std::memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+            if (std::memcmp(trailer.magic, framing::index_magic.data(), sizeof(trailer.magic)) != 0 ||
+                    trailer.index_offset < m_first_block || trailer.index_offset > m_size - sizeof(trailer)) {
+                return;
+            }
+            framing::block_header header;
+            if (!valid_block(trailer.index_offset, m_size - sizeof(trailer), header) || header.flags != framing::index_block) {
+                return;
+            }
+            m_index.resize(header.payload_size / sizeof(framing::index_entry));
+            std::memcpy(m_index.data(), m_data + trailer.index_offset + sizeof(header), m_index.size() * sizeof(framing::index_entry));
+            m_data_end = trailer.index_offset;
+        }
+        bool valid_block(std::uint64_t offset, std::uint64_t end, framing::block_header& header) const {
+            if (end < offset || end - offset < sizeof(header)) {
+                return false;
+            }
+            std::memcpy(&header, m_data + offset, sizeof(header));
+            return header.sync == framing::sync_marker && header.payload_size <= end - offset - sizeof(header) &&
+                header.checksum == framing::block_checksum(header, m_data + offset + sizeof(header));
+        }
+        // Find the next valid block, `load_block` enters it
+        bool next_block() {
+            if (!m_framed) {
+                return false;
+            }
+            m_pos = m_end;
+            while (m_next_block < m_data_end) {
+                framing::block_header header;
+                if (valid_block(m_next_block, m_data_end, header)) {
+                    m_block = {m_next_block, header.first_timestamp, header.record_count, header.flags, 0};
+                    m_timestamp_base = (header.flags == framing::data_block) ? (header.first_timestamp) : (0);
+                    m_payload = m_next_block + sizeof(header);
+                    m_payload_size = header.payload_size;
+                    m_codec = header.codec;
+                    m_next_block = m_payload + m_payload_size;
+                    m_pos = m_end = m_payload;
+                    if (header.flags == framing::index_block) {
+                        continue;
+                    }
+                    return true;
+                }
+                resync();
+            }
+            return false;
+        }
+        // Read the records of the current block from its payload, or from a decompressed copy of it
+        bool load_block() {
+            if (m_codec == compression::stored_id) {
+                m_buf = m_data;
+                m_pos = m_payload;
+                m_end = m_payload + m_payload_size;
+                return true;
+            }
+            if (!compression::is_supported(m_codec)) {
+                return fail("block compressed with an unsupported codec");
+            }
+            std::uint32_t size;
+            if (m_payload_size < sizeof(size)) {
+                return fail("corrupted compressed block");
+            }
+            std::memcpy(&size, m_data + m_payload, sizeof(size));
+            m_decompressed.emplace_back(size);
+            if (!compression::decompress(m_codec, m_data + m_payload + sizeof(size), m_payload_size - sizeof(size),
+                    m_decompressed.back().data(), size)) {
+                return fail("corrupted compressed block");
+            }
+            m_buf = m_decompressed.back().data();
+            m_pos = 0;
+            m_end = size;
+            return true;
+        }
+        void resync() {
+            auto from = m_next_block;
+            std::uint64_t pos = m_next_block + 1;
+            while (pos + sizeof(framing::sync_marker) <= m_data_end) {
+                auto found = static_cast<const std::uint8_t *>(std::memchr(m_data + pos, framing::sync_marker & 0xff, m_data_end - pos));
+                if (!found) {
+                    break;
+                }
+                pos = found - m_data;
+                std::uint64_t marker;
+                if (pos + sizeof(marker) <= m_data_end && (std::memcpy(&marker, found, sizeof(marker)), marker == framing::sync_marker)) {
+                    break;
+                }
+                pos++;
+            }
+            m_next_block = std::min<std::uint64_t>(pos, m_data_end);
+            m_skipped_bytes += m_next_block - from;
+        }
+        template<typename Predicate>
+        bool seek_if(Predicate&& predicate) {
+            std::uint64_t target = 0;
+            m_next_block = m_first_block;
+            while (next_block()) {
+                if (predicate(m_block)) {
+                    target = m_block.offset;
+                    break;
+                }
+            }
+            return target != 0 && seek(target);
+        }
+
+        step decode_one(record& out) {
+            out.offset = m_pos;
+            out.timestamp_base = m_timestamp_base;
+            if (!read_layout(out.layout)) {
+                return step::failed;
+            }
+            if (!out.layout) {
+                return step::consumed;
+            }
+            if (!read_arguments(out)) {
+                return step::failed;
+            }
+            if (out.layout->is_meta) {
+                apply_meta(out);
+                return step::consumed;
+            }
+            out.calibration = m_calibration;
+            out.schemas = &m_schemas;
+            return step::record;
+        }
+
+        bool read_format(std::string_view& format) {
+            auto begin = m_buf + m_pos;
+            auto end = static_cast<const std::uint8_t *>(std::memchr(begin, '\0', m_end - m_pos));
+            if (!end) {
+                return fail("truncated format");
+            }
+            format = std::string_view(reinterpret_cast<const char *>(begin), end - begin);
+            m_pos += format.size() + 1;
+            return true;
+        }
+        bool read_id(format_dictionary::format_id_type& id) {
+            if (m_end - m_pos < sizeof(id)) {
+                return fail("truncated format id");
+            }
+            std::memcpy(&id, m_buf + m_pos, sizeof(id));
+            m_pos += sizeof(id);
+            return true;
+        }
+        // Sets `layout` to nullptr when a dictionary entry was read (or a block skipped) instead of a record
+        bool read_layout(const format_layout *& layout) {
+            if (!m_framed && m_buf[m_pos] == 0 && is_zero_padding()) {
+                // The rest of a preallocated file (i.e. mmap_file_logger's last chunk, when the process died)
+                m_pos = m_end;
+                layout = nullptr;
+                return true;
+            }
+            if (!m_use_format_dictionary) {
+                std::string_view format;
+                if (!read_format(format)) {
+                    return false;
+                }
+                layout = &layout_of(format);
+                return check_layout(*layout);
+            }
+            format_dictionary::format_id_type id;
+            if (!read_id(id)) {
+                return false;
+            }
+            if (id == format_dictionary::dictionary_marker) {
+                std::string_view format;
+                if (!read_id(id) || !read_format(format)) {
+                    return false;
+                }
+                m_ids[id] = &layout_of(format);
+                layout = nullptr;
+                return true;
+            }
+            auto it = m_ids.find(id);
+            if (it == m_ids.end()) {
+                if (!m_framed) {
+                    return fail("unknown format id");
+                }
+                // Its dictionary entry was lost (i.e. a datagram), the rest of the block can't be parsed but the next one can
+                m_skipped_bytes += m_end - (m_pos - sizeof(id));
+                m_pos = m_end;
+                layout = nullptr;
+                return true;
+            }
+            layout = it->second;
+            return check_layout(*layout);
+        }
+        bool is_zero_padding() const {
+            return std::all_of(m_buf + m_pos, m_buf + m_end, [](std::uint8_t byte) { return byte == 0; });
+        }
+        bool check_layout(const format_layout& layout) {
+            if (layout.unknown_terminator) {
+                return fail("format uses a terminator without a layout");
+            }
+            return true;
+        }
+        bool read_arguments(record& out) {
+            auto& layout = *out.layout;
+            if (m_end - m_pos < layout.fixed_size) {
+                return fail("truncated record");
+            }
+            out.fixed = m_buf + m_pos;
+            m_pos += layout.fixed_size;
+            out.variable = m_buf + m_pos;
+            if (layout.variable_arguments > 0) {
+                std::size_t variable_size = 0;
+                for (auto& arg : layout.arguments) {
+                    if (!arg.layout.is_variable) {
+                        continue;
+                    }
+                    if (arg.layout.encoding == value_encoding::fixed) {
+                        terminators::s::variable_string_length_type len;
+                        std::memcpy(&len, out.fixed + arg.offset, sizeof(len));
+                        variable_size += len;
+                        continue;
+                    }
+                    std::uint64_t value;
+                    auto len = (m_end - m_pos < variable_size) ? (0) :
+                        (varint::decode(out.variable + variable_size, m_end - m_pos - variable_size, value));
+                    if (len == 0) {
+                        return fail("truncated record");
+                    }
+                    variable_size += len;
+                    // Like the logger, only framed data blocks keep a timestamp base (see file_logger)
+                    if (arg.layout.encoding == value_encoding::timestamp_delta && m_framed && m_block.flags == framing::data_block) {
+                        m_timestamp_base = out.timestamp_base + static_cast<std::uint64_t>(varint::unzigzag(value));
+                    }
+                }
+                if (m_end - m_pos < variable_size) {
+                    return fail("truncated record");
+                }
+                m_pos += variable_size;
+            }
+            return true;
+        }
+
+        const format_layout& layout_of(std::string_view format) {
+            auto it = m_layouts.find(format);
+            if (it == m_layouts.end()) {
+                if (m_buf != m_data) {
+                    // Decompressed blocks are discarded, layouts must outlive them
+                    format = m_owned_formats.emplace_back(format);
+                }
+                auto layout = (m_use_compact_encoding) ?
+                    (parse_format<typename Config::template config_with_compact_encoding<>>(format)) : (parse_format<Config>(format));
+                if (m_use_legacy_integer_sizes) {
+                    use_legacy_integer_sizes(layout);
+                }
+                it = m_layouts.emplace(format, std::move(layout)).first;
+            }
+            return it->second;
+        }
+
+        void apply_meta(const record& rec) {
+            if (rec.layout->meta_name == "tsc_calibration" && rec.argument_count() == 3) {
+                // Records keep pointing at the calibration they were decoded with, so never modify one in place
+                m_calibrations.push_back({rec.unsigned_value(0), rec.unsigned_value(1), rec.unsigned_value(2)});
+                m_calibration = &m_calibrations.back();
+            } else if (rec.layout->meta_name == "schema" && rec.argument_count() == 3) {
+                auto hex_id = rec.string_value(0);
+                std::uint64_t id;
+                if (std::from_chars(hex_id.data(), hex_id.data() + hex_id.size(), id, 16).ec == std::errc()) {
+                    m_schemas[id] = object_schema::parse(rec.string_value(1), rec.string_value(2));
+                }
+            }
+        }
+
+        const std::uint8_t *m_data;
+        const std::size_t m_size;
+        // Where the records end (i.e. the index block)
+        std::uint64_t m_data_end;
+        std::uint64_t m_pos = 0;
+        // Records are read from m_buf, the data or a decompressed block
+        const std::uint8_t *m_buf;
+        // The end of the current block, or of the data when not framed
+        std::uint64_t m_end;
+        bool m_use_format_dictionary = false;
+        bool m_use_compact_encoding = Config::use_compact_encoding;
+        // Format version 1 logs, see use_legacy_integer_sizes
+        bool m_use_legacy_integer_sizes = false;
+        const char *m_error = nullptr;
+        // See record::timestamp_base
+        std::uint64_t m_timestamp_base = 0;
+
+        bool m_framed = false;
+        std::uint64_t m_first_block = 0;
+        // Where to look for the block after the current one
+        std::uint64_t m_next_block = 0;
+        std::uint64_t m_payload = 0;
+        std::uint32_t m_payload_size = 0;
+        std::uint16_t m_codec = compression::stored_id;
+        std::deque<std::vector<std::uint8_t>> m_decompressed;
+        framing::index_entry m_block = {};
+        std::vector<framing::index_entry> m_index;
+        std::uint64_t m_skipped_bytes = 0;
+
+        // Formats point into the decoded buffer, which outlives the decoder
+        std::unordered_map<std::string_view, format_layout> m_layouts;
+        std::deque<std::string> m_owned_formats;
+        std::unordered_map<format_dictionary::format_id_type, const format_layout *> m_ids;
+        std::deque<tsc_calibration> m_calibrations;
+        const tsc_calibration *m_calibration = nullptr;
+        // Node based, records point at it
+        schema_map m_schemas;
+    };
+
+    // UTC ISO-8601 with nanoseconds, i.e. 2018-01-21T13:37:00.123456789Z
+    inline void append_timestamp(std::string& out, std::uint64_t ns) {
+        // The date/time breakdown only changes once a second
+        thread_local std::uint64_t cached_sec = ~0ULL;
+        thread_local char cached[32];
+        thread_local std::size_t cached_len = 0;
+        std::uint64_t sec = ns / 1000000000ULL;
+        if (sec != cached_sec) {
+            std::time_t t = static_cast<std::time_t>(sec);
+            std::tm tm;
+            gmtime_r(&t, &tm);
+            cached_len = std::strftime(cached, sizeof(cached), "%Y-%m-%dT%H:%M:%S.", &tm);
+            cached_sec = sec;
+        }
+        out.append(cached, cached_len);
+        char frac[16];
+        std::snprintf(frac, sizeof(frac), "%09llu", static_cast<unsigned long long>(ns % 1000000000ULL));
+        out.append(frac, 9);
+        out.push_back('Z');
+    }
+
+    // Integers honour the printf flags and width of their specification, length modifiers only tell their size
+    inline void append_integer(std::string& out, std::string_view spec, const char *conversion, std::uint64_t bits, bool is_signed) {
+        char buf[64];
+        if (spec.find_first_not_of("lh") == std::string_view::npos) {
+            int base = (conversion[0] == 'x') ? (16) : (10);
+            auto res = (is_signed) ?
+                (std::to_chars(buf, buf + sizeof(buf), static_cast<std::int64_t>(bits), base)) :
+                (std::to_chars(buf, buf + sizeof(buf), bits, base));
+            out.append(buf, res.ptr - buf);
+            return;
+        }
+        char fmt[32] = {'%'};
+        std::size_t len = 1;
+        for (auto ch : spec) {
+            if (ch != 'l' && ch != 'h' && len < sizeof(fmt) - 4) {
+                fmt[len++] = ch;
+            }
+        }
+        fmt[len++] = 'l';
+        fmt[len++] = 'l';
+        fmt[len++] = conversion[0];
+        fmt[len] = '\0';
+        auto written = std::snprintf(buf, sizeof(buf), fmt, bits);
+        out.append(buf, std::min<std::size_t>(std::max(written, 0), sizeof(buf) - 1));
+    }
+
+    // Floats and doubles are formatted alike, with the flags, width and precision of their specification
+    inline void append_floating(std::string& out, std::string_view spec, char conversion, double value) {
+        char fmt[32] = {'%'};
+        std::size_t len = 1;
+        for (auto ch : spec) {
+            if (ch != 'l' && ch != 'h' && len < sizeof(fmt) - 2) {
+                fmt[len++] = ch;
+            }
+        }
+        fmt[len++] = conversion;
+        fmt[len] = '\0';
+        char buf[64];
+        auto written = std::snprintf(buf, sizeof(buf), fmt, value);
+        if (written >= static_cast<int>(sizeof(buf))) {
+            // i.e. "%f" of a large double
+            std::string large(written, '\0');
+            std::snprintf(large.data(), large.size() + 1, fmt, value);
+            out.append(large);
+            return;
+        }
+        out.append(buf, std::max(written, 0));
+    }
+
+    inline void append_json_string(std::string& out, std::string_view str) {
+        out.push_back('"');
+        for (auto ch : str) {
+            switch (ch) {
+                case '"': out.append("\\\""); break;
+                case '\\': out.append("\\\\"); break;
+                case '\n': out.append("\\n"); break;
+                case '\r': out.append("\\r"); break;
+                case '\t': out.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20) {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                        out.append(buf);
+                    } else {
+                        out.push_back(ch);
+                    }
+            }
+        }
+        out.push_back('"');
+    }
+
+    inline void append_string(std::string& out, std::string_view str, bool json) {
+        if (json) {
+            append_json_string(out, str);
+        } else {
+            out.append(str);
+        }
+    }
+
+    /*
+     * A field of a %T object, per its kind in the schema. Fields that don't fit the object (a schema that doesn't
+     *  match the data) are shown as "?".
+     */
+    inline void append_field(std::string& out, const object_schema::field& field, std::string_view bytes, bool json) {
+        if (field.offset > bytes.size() || field.size > bytes.size() - field.offset || field.size == 0) {
+            out.append((json) ? ("null") : ("?"));
+            return;
+        }
+        auto data = reinterpret_cast<const std::uint8_t *>(bytes.data() + field.offset);
+        std::uint64_t bits = 0;
+        if (field.size <= sizeof(bits)) {
+            std::memcpy(&bits, data, field.size);
+        }
+        // Wider than 8 bytes, only strings aren't shown as hex
+        auto kind = (field.size <= sizeof(bits) || field.kind == 's') ? (field.kind) : ('x');
+        switch (kind) {
+            case 'i': {
+                auto shift = 64 - 8 * field.size;
+                append_integer(out, "", "d", static_cast<std::uint64_t>(static_cast<std::int64_t>(bits << shift) >> shift), true);
+                break;
+            }
+            case 'u':
+                append_integer(out, "", "u", bits, false);
+                break;
+            case 'b':
+                out.append((bits != 0) ? ("true") : ("false"));
+                break;
+            case 'f': {
+                double value;
+                if (field.size == sizeof(float)) {
+                    float f;
+                    std::memcpy(&f, data, sizeof(f));
+                    value = f;
+                } else if (field.size == sizeof(double)) {
+                    std::memcpy(&value, data, sizeof(value));
+                } else {
+                    out.append((json) ? ("null") : ("?"));
+                    break;
+                }
+                if (json && !std::isfinite(value)) {
+                    // NaN and infinities aren't JSON
+                    out.append("null");
+                    break;
+                }
+                char buf[32];
+                auto written = std::snprintf(buf, sizeof(buf), "%.17g", value);
+                out.append(buf, std::min<std::size_t>(std::max(written, 0), sizeof(buf) - 1));
+                break;
+            }
+            case 'c':
+            case 's': {
+                auto chars = reinterpret_cast<const char *>(data);
+                auto end = static_cast<const char *>(std::memchr(chars, '\0', field.size));
+                std::string_view str(chars, (end) ? (end - chars) : (field.size));
+                append_string(out, str, json);
+                break;
+            }
+            default: {
+                static constexpr char digits[] = "0123456789abcdef";
+                std::string hex;
+                for (std::size_t i = 0; i < field.size; i++) {
+                    hex.push_back(digits[data[i] >> 4]);
+                    hex.push_back(digits[data[i] & 0xf]);
+                }
+                append_string(out, hex, json);
+                break;
+            }
+        }
+    }
+
+    // name{field=value, ...}, or a JSON object of the fields
+    inline void append_object(std::string& out, const record& rec, std::size_t idx, bool json) {
+        std::string_view bytes;
+        auto schema = rec.object_value(idx, bytes);
+        if (!schema) {
+            char buf[64];
+            auto written = std::snprintf(buf, sizeof(buf), "<%zu byte object, unknown schema>", bytes.size());
+            std::string_view text(buf, std::min<std::size_t>(std::max(written, 0), sizeof(buf) - 1));
+            append_string(out, text, json);
+            return;
+        }
+        if (!json) {
+            out.append(schema->name);
+        }
+        out.push_back('{');
+        for (std::size_t i = 0; i < schema->fields.size(); i++) {
+            auto& field = schema->fields[i];
+            if (i > 0) {
+                out.append((json) ? (",") : (", "));
+            }
+            if (json) {
+                append_json_string(out, field.name);
+                out.push_back(':');
+            } else {
+                out.append(field.name);
+                out.push_back('=');
+            }
+            append_field(out, field, bytes, json);
+        }
+        out.push_back('}');
+    }
+
+    inline void append_argument(std::string& out, const record& rec, std::size_t idx) {
+        auto& arg = rec.argument(idx);
+        switch (arg.layout.kind) {
+            case value_kind::signed_integer:
+                append_integer(out, arg.spec, "d", static_cast<std::uint64_t>(rec.signed_value(idx)), true);
+                break;
+            case value_kind::unsigned_integer:
+                append_integer(out, arg.spec, "u", rec.unsigned_value(idx), false);
+                break;
+            case value_kind::hex_integer:
+                append_integer(out, arg.spec, "x", rec.unsigned_value(idx), false);
+                break;
+            case value_kind::character:
+                out.push_back(static_cast<char>(rec.unsigned_value(idx)));
+                break;
+            case value_kind::string:
+                out.append(rec.string_value(idx));
+                break;
+            case value_kind::level: {
+                auto value = rec.unsigned_value(idx);
+                if (auto name = logging::level::name(static_cast<unsigned int>(value))) {
+                    out.append(name);
+                } else {
+                    append_integer(out, "", "u", value, false);
+                }
+                break;
+            }
+            case value_kind::timestamp:
+            case value_kind::cycles: {
+                std::uint64_t ns;
+                if (rec.timestamp_value(idx, ns)) {
+                    append_timestamp(out, ns);
+                } else {
+                    append_integer(out, "", "u", ns, false);
+                    out.append(" cycles");
+                }
+                break;
+            }
+            case value_kind::object:
+                append_object(out, rec, idx, false);
+                break;
+            case value_kind::floating:
+                append_floating(out, arg.spec, arg.conversion, rec.floating_value(idx));
+                break;
+            case value_kind::pointer: {
+                // Like glibc's printf
+                auto value = rec.unsigned_value(idx);
+                if (value == 0) {
+                    out.append("(nil)");
+                } else {
+                    out.append("0x");
+                    append_integer(out, "", "x", value, false);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // The record as text, the way printf would have formatted it
+    inline void append_text(std::string& out, const record& rec) {
+        for (auto& piece : rec.layout->pieces) {
+            out.append(piece.literal);
+            if (piece.argument >= 0) {
+                append_argument(out, rec, piece.argument);
+            }
+        }
+    }
+
+    // The record as a single line JSON object: {"format": "...", "args": [...], "text": "..."}
+    inline void append_json(std::string& out, const record& rec, std::string& scratch) {
+        out.append("{\"format\":");
+        append_json_string(out, rec.format());
+        out.append(",\"args\":[");
+        for (std::size_t i = 0; i < rec.argument_count(); i++) {
+            if (i > 0) {
+                out.push_back(',');
+            }
+            auto kind = rec.argument(i).layout.kind;
+            if (kind == value_kind::signed_integer) {
+                append_integer(out, "", "d", static_cast<std::uint64_t>(rec.signed_value(i)), true);
+            } else if (kind == value_kind::unsigned_integer) {
+                append_integer(out, "", "u", rec.unsigned_value(i), false);
+            } else if (kind == value_kind::object) {
+                append_object(out, rec, i, true);
+            } else if (kind == value_kind::floating && std::isfinite(rec.floating_value(i))) {
+                // Enough digits to round trip
+                append_floating(out, (rec.argument(i).layout.size == sizeof(float)) ? (".9") : (".17"), 'g', rec.floating_value(i));
+            } else if (kind == value_kind::floating) {
+                // NaN and infinities aren't JSON
+                out.append("null");
+            } else {
+                scratch.clear();
+                append_argument(scratch, rec, i);
+                append_json_string(out, scratch);
+            }
+        }
+        out.append("],\"text\":");
+        scratch.clear();
+        append_text(scratch, rec);
+        if (!scratch.empty() && scratch.back() == '\n') {
+            scratch.pop_back();
+        }
+        append_json_string(out, scratch);
+        out.append("}\n");
+    }
+}
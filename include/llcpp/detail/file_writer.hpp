@@ -0,0 +1,387 @@
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define LLCPP_HAS_IO_URING 1
+#else
+#define LLCPP_HAS_IO_URING 0
+#endif
+
+namespace llcpp::detail::file_writer {
+    /*
+     * A file_writer is how file_logger hands its flushed buffers to the file (see `config_with_file_writer`):
+     *  - Constructed with the logger's FILE* (which it doesn't own).
+     *  - `void write(const std::uint8_t *data, std::size_t len)` - Called concurrently by the logging threads,
+     *    each call must reach the file as a contiguous span.
+     *  - `void flush()` - Everything written so far must reach the file. Also done by its destructor.
+     */
+    struct stdio_writer {
+        explicit stdio_writer(std::FILE *fp) : m_fp(fp) {}
+
+        void write(const std::uint8_t *data, const std::size_t len) {
+            std::fwrite(data, len, 1, m_fp);
+        }
+        void flush() {
+            std::fflush(m_fp);
+        }
+
+    private:
+        std::FILE *m_fp;
+    };
+
+    inline bool write_all(int fd, const std::uint8_t *data, std::size_t len) {
+        while (len > 0) {
+            auto written = ::write(fd, data, len);
+            if (written < 0) {
+                return false;
+            }
+            data += written;
+            len -= written;
+        }
+        return true;
+    }
+    inline bool pwrite_all(int fd, const std::uint8_t *data, std::size_t len, std::uint64_t offset) {
+        while (len > 0) {
+            auto written = ::pwrite(fd, data, len, offset);
+            if (written < 0) {
+                return false;
+            }
+            data += written;
+            len -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    /*
+     * Copies writes into `BufferCount` buffers of `BufferSize` bytes, and writes them all with a single writev
+     *  once they are full.
+     */
+    template<std::size_t BufferSize = 64 * 1024, std::size_t BufferCount = 8>
+    struct writev_writer {
+        static_assert(BufferCount > 0 && BufferCount <= IOV_MAX, "BufferCount must be in [1, IOV_MAX]");
+
+        explicit writev_writer(std::FILE *fp) : m_fd((fp) ? (fileno(fp)) : (-1)), m_buffers(new std::uint8_t[BufferSize * BufferCount]) {
+            // Anything written through the FILE* must come first
+            std::fflush(fp);
+        }
+        writev_writer(const writev_writer&) = delete;
+        writev_writer& operator=(const writev_writer&) = delete;
+        ~writev_writer() {
+            flush();
+        }
+
+        void write(const std::uint8_t *data, std::size_t len) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (len > 0) {
+                auto chunk = std::min(len, BufferSize * BufferCount - m_size);
+                std::memcpy(m_buffers.get() + m_size, data, chunk);
+                m_size += chunk;
+                data += chunk;
+                len -= chunk;
+                if (m_size == BufferSize * BufferCount) {
+                    write_buffers();
+                }
+            }
+        }
+        void flush() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            write_buffers();
+        }
+
+    private:
+        void write_buffers() {
+            struct iovec iov[BufferCount];
+            std::size_t count = 0;
+            for (std::size_t offset = 0; offset < m_size; offset += BufferSize) {
+                iov[count].iov_base = m_buffers.get() + offset;
+                iov[count].iov_len = std::min(BufferSize, m_size - offset);
+                count++;
+            }
+            auto written = (count > 0) ? (::writev(m_fd, iov, static_cast<int>(count))) : (0);
+            if (written >= 0 && static_cast<std::size_t>(written) < m_size) {
+                // Short write, finish it synchronously
+                write_all(m_fd, m_buffers.get() + written, m_size - written);
+            }
+            m_size = 0;
+        }
+
+        const int m_fd;
+        std::unique_ptr<std::uint8_t[]> m_buffers;
+        std::size_t m_size = 0;
+        std::mutex m_mutex;
+    };
+
+#if LLCPP_HAS_IO_URING
+    // The bare minimum of io_uring used by uring_writer, on top of the raw syscalls
+    struct uring {
+        uring() = default;
+        uring(const uring&) = delete;
+        uring& operator=(const uring&) = delete;
+        ~uring() {
+            if (m_sqes) {
+                ::munmap(m_sqes, m_sqes_len);
+            }
+            if (m_cq_ptr && m_cq_ptr != m_sq_ptr) {
+                ::munmap(m_cq_ptr, m_cq_len);
+            }
+            if (m_sq_ptr) {
+                ::munmap(m_sq_ptr, m_sq_len);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        // False if io_uring (with IORING_OP_WRITE) isn't available
+        bool setup(unsigned entries) {
+            struct io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (m_fd < 0) {
+                return false;
+            }
+            // IORING_OP_WRITE came along with IORING_FEAT_RW_CUR_POS (5.6)
+            if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+                return false;
+            }
+            m_sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) {
+                m_sq_len = m_cq_len = std::max(m_sq_len, m_cq_len);
+            }
+            m_sq_ptr = map(m_sq_len, IORING_OFF_SQ_RING);
+            m_cq_ptr = (single_mmap) ? (m_sq_ptr) : (map(m_cq_len, IORING_OFF_CQ_RING));
+            m_sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+            m_sqes = static_cast<struct io_uring_sqe *>(map(m_sqes_len, IORING_OFF_SQES));
+            if (!m_sq_ptr || !m_cq_ptr || !m_sqes) {
+                return false;
+            }
+            auto sq = static_cast<std::uint8_t *>(m_sq_ptr);
+            auto cq = static_cast<std::uint8_t *>(m_cq_ptr);
+            m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            m_sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            m_cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        /*
+         * Queues a write and submits everything queued. Once queued, the write belongs to the ring until its completion
+         *  is reaped: if it can't be submitted now, it is by the next `submit_write` or `reap`.
+         * The caller makes sure there are never more writes in flight than entries.
+         */
+        void submit_write(int fd, const std::uint8_t *data, std::size_t len, std::uint64_t offset, std::uint64_t user_data) {
+            unsigned tail = *m_sq_tail;
+            unsigned idx = tail & m_sq_mask;
+            auto sqe = &m_sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(data);
+            sqe->len = static_cast<std::uint32_t>(len);
+            sqe->off = offset;
+            sqe->user_data = user_data;
+            m_sq_array[idx] = idx;
+            __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+            m_unsubmitted++;
+            submit(0);
+        }
+        // Call `f(user_data, result)` for every completion, waiting for at least `min_complete`
+        template<typename F>
+        void reap(unsigned min_complete, F&& f) {
+            if (min_complete > 0 || m_unsubmitted > 0) {
+                submit(min_complete);
+            }
+            unsigned head = *m_cq_head;
+            while (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+                auto& cqe = m_cqes[head & m_cq_mask];
+                f(cqe.user_data, cqe.res);
+                head++;
+            }
+            __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        void *map(std::size_t len, off_t offset) {
+            void *ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+            return (ptr == MAP_FAILED) ? (nullptr) : (ptr);
+        }
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+        // Submits the queued writes and waits for `min_complete` completions, a failure (i.e. EINTR) leaves them queued
+        void submit(unsigned min_complete) {
+            auto submitted = enter(m_unsubmitted, min_complete, (min_complete > 0) ? (IORING_ENTER_GETEVENTS) : (0));
+            if (submitted > 0) {
+                m_unsubmitted -= static_cast<unsigned>(submitted);
+            }
+        }
+
+        int m_fd = -1;
+        void *m_sq_ptr = nullptr;
+        void *m_cq_ptr = nullptr;
+        std::size_t m_sq_len = 0;
+        std::size_t m_cq_len = 0;
+        struct io_uring_sqe *m_sqes = nullptr;
+        std::size_t m_sqes_len = 0;
+        unsigned *m_sq_tail = nullptr;
+        unsigned m_sq_mask = 0;
+        unsigned *m_sq_array = nullptr;
+        unsigned *m_cq_head = nullptr;
+        unsigned *m_cq_tail = nullptr;
+        unsigned m_cq_mask = 0;
+        struct io_uring_cqe *m_cqes = nullptr;
+        // Queued past the kernel's view of the submission queue
+        unsigned m_unsubmitted = 0;
+    };
+#endif
+
+    /*
+     * Copies writes into buffers of `BufferSize` bytes and submits each full buffer as an io_uring write, at an
+     *  explicit file offset. Up to `BufferCount` buffers are in flight, a buffer is reused once its completion arrives,
+     *  so the writing thread only waits when all of them are in flight.
+     * Falls back to writev_writer when io_uring isn't available, or when the file isn't seekable (i.e. a pipe).
+     */
+    template<std::size_t BufferSize = 64 * 1024, std::size_t BufferCount = 8>
+    struct uring_writer {
+        explicit uring_writer(std::FILE *fp) : m_fd((fp) ? (fileno(fp)) : (-1)) {
+            std::fflush(fp);
+#if LLCPP_HAS_IO_URING
+            auto offset = ::lseek(m_fd, 0, SEEK_CUR);
+            auto ring = std::make_unique<uring>();
+            if (offset >= 0 && ring->setup(BufferCount)) {
+                m_ring = std::move(ring);
+                m_offset = offset;
+                m_buffers.reset(new std::uint8_t[BufferSize * BufferCount]);
+                for (std::size_t i = 0; i < BufferCount; i++) {
+                    m_free.push_back(BufferCount - 1 - i);
+                }
+                return;
+            }
+#endif
+            m_fallback = std::make_unique<writev_writer<BufferSize, BufferCount>>(fp);
+        }
+        uring_writer(const uring_writer&) = delete;
+        uring_writer& operator=(const uring_writer&) = delete;
+        ~uring_writer() {
+            flush();
+        }
+
+        void write(const std::uint8_t *data, std::size_t len) {
+            if (m_fallback) {
+                m_fallback->write(data, len);
+                return;
+            }
+#if LLCPP_HAS_IO_URING
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (len > 0) {
+                if (m_current == no_buffer) {
+                    acquire_buffer();
+                }
+                auto chunk = std::min(len, BufferSize - m_fill);
+                std::memcpy(buffer(m_current) + m_fill, data, chunk);
+                m_fill += chunk;
+                data += chunk;
+                len -= chunk;
+                if (m_fill == BufferSize) {
+                    submit_current();
+                }
+            }
+#endif
+        }
+        void flush() {
+            if (m_fallback) {
+                m_fallback->flush();
+                return;
+            }
+#if LLCPP_HAS_IO_URING
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_current != no_buffer && m_fill > 0) {
+                submit_current();
+            }
+            while (m_free.size() + ((m_current != no_buffer) ? (1) : (0)) < BufferCount) {
+                reap(1);
+            }
+#endif
+        }
+
+        // Whether writes go through io_uring
+        bool uses_io_uring() const {
+            return !m_fallback;
+        }
+
+    private:
+        static constexpr std::size_t no_buffer = ~std::size_t(0);
+
+        std::uint8_t *buffer(std::size_t idx) {
+            return m_buffers.get() + idx * BufferSize;
+        }
+#if LLCPP_HAS_IO_URING
+        void acquire_buffer() {
+            reap(0);
+            while (m_free.empty()) {
+                reap(1);
+            }
+            m_current = m_free.back();
+            m_free.pop_back();
+            m_fill = 0;
+        }
+        void submit_current() {
+            // The buffer is back in m_free once `reap` sees its completion, even if it couldn't be submitted right away
+            m_in_flight[m_current] = {m_offset, m_fill};
+            m_ring->submit_write(m_fd, buffer(m_current), m_fill, m_offset, m_current);
+            m_offset += m_fill;
+            m_current = no_buffer;
+            m_fill = 0;
+        }
+        void reap(unsigned min_complete) {
+            m_ring->reap(min_complete, [this](std::uint64_t idx, std::int32_t result) {
+                auto& write = m_in_flight[idx];
+                /*
+                 * Short or failed write, finish it synchronously. Writes are canceled (ECANCELED) when the thread that
+                 *  submitted them exits before the kernel's worker gets to them.
+                 */
+                auto done = (result > 0) ? (static_cast<std::size_t>(result)) : (0);
+                if (done < write.len) {
+                    pwrite_all(m_fd, buffer(idx) + done, write.len - done, write.offset + done);
+                }
+                m_free.push_back(idx);
+            });
+        }
+
+        struct in_flight_write {
+            std::uint64_t offset;
+            std::size_t len;
+        };
+
+        std::unique_ptr<uring> m_ring;
+        in_flight_write m_in_flight[BufferCount];
+#endif
+        const int m_fd;
+        std::unique_ptr<writev_writer<BufferSize, BufferCount>> m_fallback;
+        std::unique_ptr<std::uint8_t[]> m_buffers;
+        std::vector<std::size_t> m_free;
+        std::size_t m_current = no_buffer;
+        std::size_t m_fill = 0;
+        std::uint64_t m_offset = 0;
+        std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace llcpp::detail::format_dictionary {
+    /*
+     * When the format dictionary is enabled, each record starts with its format's id instead of the format itself.
+     * The first time an id is used by a logger, a dictionary entry is written before the record:
+     *  [dictionary_marker (8 bytes)][id (8 bytes)][null terminated format]
+     */
+    using format_id_type = std::uint64_t;
+    static constexpr format_id_type dictionary_marker = 0;
+
+    /*
+     * A fixed size, lock-free set of the format ids already written by a logger.
+     * Entries are only ever added. When the set is full, `contains` keeps returning false for new ids,
+     *  which means their dictionary entries are re-written - wasteful, but still a valid log.
+     */
+    template<std::size_t Capacity = 4096>
+    struct format_id_set {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+        format_id_set() {
+            for (auto& slot : m_slots) {
+                slot.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        bool contains(format_id_type id) const {
+            for (std::size_t i = 0, idx = slot_of(id); i < Capacity; i++, idx = (idx + 1) & (Capacity - 1)) {
+                auto cur = m_slots[idx].load(std::memory_order_acquire);
+                if (cur == id) {
+                    return true;
+                }
+                if (cur == 0) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        void insert(format_id_type id) {
+            for (std::size_t i = 0, idx = slot_of(id); i < Capacity; i++, idx = (idx + 1) & (Capacity - 1)) {
+                format_id_type expected = 0;
+                if (m_slots[idx].compare_exchange_strong(expected, id, std::memory_order_acq_rel) || expected == id) {
+                    return;
+                }
+            }
+        }
+
+    private:
+        static constexpr std::size_t slot_of(format_id_type id) {
+            return static_cast<std::size_t>(id ^ (id >> 32)) & (Capacity - 1);
+        }
+
+        std::array<std::atomic<format_id_type>, Capacity> m_slots;
+    };
+
+    struct empty_format_id_set {};
+}
\ No newline at end of file
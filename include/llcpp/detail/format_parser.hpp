@@ -40,8 +40,9 @@ namespace llcpp::detail::format_parser {
             typename escape_termination_t::empty_parser
         >::type;
 
+        // Varints (see terminators::compact) take no room in the fixed size part but are still arguments
         using current_argument_tuple = typename std::conditional_t<
-            (current_argument_parser::argument_size > 0),
+            (current_argument_parser::argument_size > 0 || !current_argument_parser::is_fixed_size),
             std::tuple<current_argument_parser>,
             typename std::tuple<>
         >;
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "checksum.hpp"
+#include "terminators.hpp"
+
+namespace llcpp::detail::framing {
+    /*
+     * The framed container, enabled with `config_with_framing<>`:
+     *  [file_header][terminator characters][block]...[index block][trailer]
+     * - Each block is a block_header followed by `payload_size` bytes of whole records (records never span blocks).
+     *   Blocks start with a sync marker and are checksummed, so a reader can skip a corrupted block and resync on the next one.
+     * - Meta records (dictionary entries, calibrations) are written in blocks of their own, flagged `meta`.
+     * - With `config_with_compression`, a data block's payload may be compressed, per the `codec` in its header:
+     *   a 4 byte uncompressed size followed by the codec's output (see compression.hpp).
+     * - The index block lists every block's offset, first timestamp and record count. It is written when the logger
+     *   is destroyed, the trailer at the very end of the file points at it. Without it, blocks are found by their headers.
+     * All integers are in the writer's endianness, recorded in the file header.
+     */
+    inline constexpr std::array<char, 8> file_magic = {{'L', 'L', 'C', 'P', 'P', 'L', 'O', 'G'}};
+    inline constexpr std::array<char, 8> index_magic = {{'L', 'L', 'C', 'P', 'P', 'I', 'D', 'X'}};
+    // 2: "%ld" is the size of a long and "%hd"/"%hhd" of a short/char, they were 4 bytes (see decoding's legacy sizes)
+    constexpr std::uint16_t format_version = 2;
+    // "\xffLLBLK\xfe\0" when little endian
+    constexpr std::uint64_t sync_marker = 0x00fe4b4c424c4cffULL;
+
+    enum endianness : std::uint8_t {
+        little_endian = 1,
+        big_endian = 2,
+    };
+    constexpr std::uint8_t native_endianness = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? (little_endian) : (big_endian);
+
+    enum file_flags : std::uint8_t {
+        format_dictionary_flag = 1,
+        // Integers and timestamps use terminators::compact's encodings
+        compact_encoding_flag = 2,
+    };
+    enum block_flags : std::uint16_t {
+        data_block = 0,
+        meta_block = 1,
+        index_block = 2,
+    };
+
+    // Followed by `terminator_count` characters, the terminators the log was written with
+    struct file_header {
+        char magic[8];
+        std::uint16_t version;
+        std::uint8_t endianness;
+        std::uint8_t flags;
+        std::uint32_t max_block_size;
+        std::uint32_t terminator_count;
+    };
+    static_assert(sizeof(file_header) == 20, "file_header must not be padded");
+
+    struct block_header {
+        std::uint64_t sync;
+        std::uint32_t payload_size;
+        // Number of lines (i.e. log calls) in the block
+        std::uint32_t record_count;
+        // Nanoseconds since the epoch when the block's first record was written
+        //  (with compact encoding, the timestamp base of its first record: the timestamp its deltas start from)
+        std::uint64_t first_timestamp;
+        // CRC-32C of the header (with a zero checksum) and the payload
+        std::uint32_t checksum;
+        std::uint16_t flags;
+        // compression::codec_id of the payload, 0 (stored) when not compressed
+        std::uint16_t codec;
+    };
+    static_assert(sizeof(block_header) == 32, "block_header must not be padded");
+
+    struct index_entry {
+        std::uint64_t offset;
+        std::uint64_t first_timestamp;
+        std::uint32_t record_count;
+        std::uint16_t flags;
+        std::uint16_t reserved;
+    };
+    static_assert(sizeof(index_entry) == 24, "index_entry must not be padded");
+
+    struct trailer {
+        std::uint64_t index_offset;
+        char magic[8];
+    };
+    static_assert(sizeof(trailer) == 16, "trailer must not be padded");
+
+    template<typename TerminatorTuple>
+    struct terminator_set_impl;
+    template<typename... Terminators>
+    struct terminator_set_impl<std::tuple<Terminators...>> {
+        static constexpr std::array<char, sizeof...(Terminators)> value = {{Terminators::terminator_value...}};
+    };
+    template<typename Config>
+    inline constexpr auto terminator_set = terminator_set_impl<terminators::terminator_tuple_from_config<Config>>::value;
+
+    template<typename Config>
+    std::array<std::uint8_t, sizeof(file_header) + terminator_set<Config>.size()> make_file_header(std::uint32_t max_block_size) {
+        file_header header;
+        std::memcpy(header.magic, file_magic.data(), sizeof(header.magic));
+        header.version = format_version;
+        header.endianness = native_endianness;
+        header.flags = ((Config::use_format_dictionary) ? (format_dictionary_flag) : (0)) |
+            ((Config::use_compact_encoding) ? (compact_encoding_flag) : (0));
+        header.max_block_size = max_block_size;
+        header.terminator_count = static_cast<std::uint32_t>(terminator_set<Config>.size());
+
+        std::array<std::uint8_t, sizeof(file_header) + terminator_set<Config>.size()> result;
+        std::memcpy(result.data(), &header, sizeof(header));
+        std::memcpy(result.data() + sizeof(header), terminator_set<Config>.data(), terminator_set<Config>.size());
+        return result;
+    }
+
+    inline std::uint32_t block_checksum(block_header header, const std::uint8_t *payload) {
+        header.checksum = 0;
+        auto crc = checksum::crc32c(0, reinterpret_cast<const std::uint8_t *>(&header), sizeof(header));
+        return checksum::crc32c(crc, payload, header.payload_size);
+    }
+    // Fill in a block header, `payload` must follow it
+    inline void seal_block(block_header& header, std::uint32_t payload_size, std::uint32_t record_count,
+            std::uint64_t first_timestamp, std::uint16_t flags, const std::uint8_t *payload, std::uint16_t codec = 0) {
+        header.sync = sync_marker;
+        header.payload_size = payload_size;
+        header.record_count = record_count;
+        header.first_timestamp = first_timestamp;
+        header.flags = flags;
+        header.codec = codec;
+        header.checksum = block_checksum(header, payload);
+    }
+
+    /*
+     * Writes a framed log block by block, and its index once it's done. For the tools that assemble a log out of
+     *  blocks they receive (llcpp_collect, llcpp_receive), loggers write their own files.
+     */
+    struct log_writer {
+        explicit log_writer(std::string_view path) : m_fp(std::fopen(std::string(path).c_str(), "w"), std::fclose) {}
+
+        bool is_open() const {
+            return m_fp != nullptr;
+        }
+        std::uint64_t offset() const {
+            return m_offset;
+        }
+
+        void write(const std::uint8_t *data, std::size_t len) {
+            std::fwrite(data, 1, len, m_fp.get());
+            m_offset += len;
+        }
+        // `block` is a block header (filled in here) followed by `payload_size` bytes of payload
+        void append_block(std::uint8_t *block, std::size_t payload_size, std::uint32_t record_count, std::uint64_t first_timestamp,
+                std::uint16_t flags) {
+            block_header header;
+            seal_block(header, static_cast<std::uint32_t>(payload_size), record_count, first_timestamp, flags, block + sizeof(header));
+            std::memcpy(block, &header, sizeof(header));
+            append_sealed(block);
+        }
+        void write_block(const std::uint8_t *payload, std::size_t len, std::uint32_t record_count, std::uint64_t first_timestamp,
+                std::uint16_t flags) {
+            std::vector<std::uint8_t> block(sizeof(block_header) + len);
+            std::memcpy(block.data() + sizeof(block_header), payload, len);
+            append_block(block.data(), len, record_count, first_timestamp, flags);
+        }
+        // A block that is already sealed, written as is
+        void append_sealed(const std::uint8_t *block) {
+            block_header header;
+            std::memcpy(&header, block, sizeof(header));
+            m_index.push_back({m_offset, header.first_timestamp, header.record_count, header.flags, 0});
+            write(block, sizeof(header) + header.payload_size);
+        }
+        void write_index(std::uint64_t timestamp) {
+            auto index_offset = m_offset;
+            write_block(reinterpret_cast<const std::uint8_t *>(m_index.data()), m_index.size() * sizeof(index_entry), 0,
+                timestamp, index_block);
+            trailer end;
+            end.index_offset = index_offset;
+            std::memcpy(end.magic, index_magic.data(), sizeof(end.magic));
+            write(reinterpret_cast<const std::uint8_t *>(&end), sizeof(end));
+        }
+        void flush() {
+            std::fflush(m_fp.get());
+        }
+
+    private:
+        std::unique_ptr<std::FILE, std::function<int(std::FILE*)>> m_fp;
+        std::uint64_t m_offset = 0;
+        std::vector<index_entry> m_index;
+    };
+}
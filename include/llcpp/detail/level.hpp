@@ -0,0 +1,22 @@
+#pragma once
+
+namespace llcpp::detail::logging {
+    struct level {
+        enum level_enum : unsigned int {
+            trace = 0,
+            debug = 1,
+            info = 2,
+            warn = 3,
+            err = 4,
+            critical = 5,
+            // Above every level: as a runtime level, nothing is logged
+            off = 6,
+        };
+
+        // The decoder's names for "%v" arguments
+        static constexpr const char *name(unsigned int value) {
+            constexpr const char *names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERR", "CRITICAL"};
+            return (value < sizeof(names) / sizeof(names[0])) ? (names[value]) : (nullptr);
+        }
+    };
+}
@@ -34,7 +34,13 @@ namespace llcpp::detail::log_line {
             using fmt_argument_tuple_size = std::tuple_size<typename string_format::format_parser::argument_tuple>;
             static_assert(sizeof...(Args) == fmt_argument_tuple_size::value,
                             "Discrepency between number of arguments in format and number of arguments in call");
-            logger.write((std::uint8_t *)string_format::_chars, fmt_size());
+            prepare_args(logger, std::forward_as_tuple(args...), std::index_sequence_for<Args...>{});
+            if constexpr(is_storable<Logger, std::tuple<Args...>>(std::index_sequence_for<Args...>{})) {
+                if (store_args(logger, std::forward_as_tuple(args...), std::index_sequence_for<Args...>{})) {
+                    return;
+                }
+            }
+            logger.template write_format<string_format>();
             apply_args(logger, std::forward_as_tuple(args...));
         }
 
@@ -42,8 +48,8 @@ namespace llcpp::detail::log_line {
         using argument_tuple = typename string_format::format_parser::argument_tuple;
         using num_variable_args = format_parser::count_variable_arguments<argument_tuple>;
 
-        template<typename Logger, typename ArgTuple, std::size_t Idx, typename Arg = typename std::tuple_element<Idx, ArgTuple>::type>
-        void apply_arg(Logger& logger, const Arg arg) {
+        template<typename ArgTuple, std::size_t Idx, typename Arg = typename std::tuple_element<Idx, ArgTuple>::type>
+        static constexpr void check_arg() {
             using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
             using _expected_arg_type_from_format = typename argument_parser::argument_type;
             //Add const to allow const arguments to be passed
@@ -62,22 +68,137 @@ namespace llcpp::detail::log_line {
 
             static_assert(std::is_convertible<Arg, expected_arg_type_from_format>::value,
                 "Discrepency between argument type deduced from format and the given argument's type");
+        }
 
-            argument_parser::apply(logger, arg);
-        };
+        // Parsers which need the logger to write meta records before the record (i.e. object schemas) provide `prepare`
+        template<typename Parser, typename Logger, typename Arg, typename = void>
+        struct has_prepare : std::false_type {};
+        template<typename Parser, typename Logger, typename Arg>
+        struct has_prepare<Parser, Logger, Arg, std::void_t<decltype(
+            Parser::prepare(std::declval<Logger&>(), std::declval<const Arg&>()))>> : std::true_type {};
+
+        template<std::size_t Idx, typename Logger, typename Arg>
+        static void prepare_arg(Logger& logger, const Arg& arg) {
+            using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
+            if constexpr(has_prepare<argument_parser, Logger, Arg>::value) {
+                argument_parser::prepare(logger, arg);
+            }
+        }
+        template<typename Logger, typename ArgTuple, std::size_t... I>
+        static void prepare_args(Logger& logger, ArgTuple args, std::index_sequence<I...>) {
+            (prepare_arg<I>(logger, std::get<I>(args)), ...);
+        }
+
+        /*
+         * Single-shot serialization: Reserve the whole record from the logger and store the format and all
+         *  the fixed size arguments at their compile-time offsets, followed by the variable size arguments.
+         * Used when the argument_parsers provide `store` (or `variable_size`/`store_variable`, optionally taking the
+         *  logger as their first argument), falls back to the `write` path when the logger can't reserve the span.
+         */
+        template<typename Parser, typename Arg, typename = void>
+        struct has_store : std::false_type {};
+        template<typename Parser, typename Arg>
+        struct has_store<Parser, Arg, std::void_t<decltype(
+            Parser::store(std::declval<std::uint8_t *>(), std::declval<const Arg>()))>> : std::true_type {};
+        template<typename Parser, typename Arg, typename = void>
+        struct has_store_variable : std::false_type {};
+        template<typename Parser, typename Arg>
+        struct has_store_variable<Parser, Arg, std::void_t<decltype(
+            Parser::variable_size(std::declval<const Arg>())),
+            decltype(Parser::store_variable(std::declval<std::uint8_t *>(), std::declval<std::uint8_t *>(),
+                std::declval<const Arg>(), std::declval<std::size_t>()))>> : std::true_type {};
+        // Parsers whose encoding depends on the logger's state (i.e. timestamp deltas)
+        template<typename Parser, typename Logger, typename Arg, typename = void>
+        struct has_logger_store_variable : std::false_type {};
+        template<typename Parser, typename Logger, typename Arg>
+        struct has_logger_store_variable<Parser, Logger, Arg, std::void_t<decltype(
+            Parser::variable_size(std::declval<Logger&>(), std::declval<const Arg>())),
+            decltype(Parser::store_variable(std::declval<Logger&>(), std::declval<std::uint8_t *>(), std::declval<std::uint8_t *>(),
+                std::declval<const Arg>(), std::declval<std::size_t>()))>> : std::true_type {};
+
+        template<typename Logger, typename ArgTuple, std::size_t Idx>
+        static constexpr bool is_arg_storable() {
+            using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
+            using arg_t = typename std::tuple_element_t<Idx, ArgTuple>;
+            if constexpr(argument_parser::is_fixed_size) {
+                return has_store<argument_parser, arg_t>::value;
+            } else {
+                return has_store_variable<argument_parser, arg_t>::value ||
+                    has_logger_store_variable<argument_parser, Logger, arg_t>::value;
+            }
+        }
+        template<typename Logger, typename ArgTuple, std::size_t... I>
+        static constexpr bool is_storable(std::index_sequence<I...>) {
+            return (is_arg_storable<Logger, ArgTuple, I>() && ...);
+        }
+
+        template<std::size_t Idx, typename Logger, typename Arg>
+        static std::size_t variable_size(Logger& logger, const Arg arg) {
+            using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
+            if constexpr(argument_parser::is_fixed_size) {
+                return 0;
+            } else if constexpr(has_logger_store_variable<argument_parser, Logger, Arg>::value) {
+                return argument_parser::variable_size(logger, arg);
+            } else {
+                return argument_parser::variable_size(arg);
+            }
+        }
+        template<std::size_t Idx, typename Logger, typename Arg>
+        static void store_arg(Logger& logger, std::uint8_t *dst, std::uint8_t *& variable_dst, const Arg arg, std::size_t variable_size) {
+            using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
+            if constexpr(argument_parser::is_fixed_size) {
+                argument_parser::store(dst, arg);
+            } else {
+                if constexpr(has_logger_store_variable<argument_parser, Logger, Arg>::value) {
+                    argument_parser::store_variable(logger, dst, variable_dst, arg, variable_size);
+                } else {
+                    argument_parser::store_variable(dst, variable_dst, arg, variable_size);
+                }
+                variable_dst += variable_size;
+            }
+        }
+
+        template<typename Logger, typename ArgTuple, std::size_t... I>
+        bool store_args(Logger& logger, ArgTuple args, std::index_sequence<I...>) {
+            (check_arg<ArgTuple, I>(), ...);
+            constexpr std::size_t format_size = Logger::template format_size<string_format>();
+            constexpr std::size_t fixed_size = format_size + args_size();
+            // Before sizing the arguments, which may depend on the state it starts the record with
+            logger.template prepare_format<string_format>();
+            const std::size_t variable_sizes[] = {variable_size<I>(logger, std::get<I>(args))..., 0};
+            std::size_t total_size = fixed_size;
+            for (auto size : variable_sizes) {
+                total_size += size;
+            }
+
+            auto dst = logger.reserve(total_size);
+            if (!dst) {
+                return false;
+            }
+            logger.template store_format<string_format>(dst);
+            auto variable_dst = dst + fixed_size;
+            (store_arg<I>(logger, dst + format_size + format_parser::accumulate_argument_parser_size<argument_tuple, I>::value,
+                variable_dst, std::get<I>(args), variable_sizes[I]), ...);
+            logger.commit(total_size);
+            return true;
+        }
 
         template<typename Logger, typename ArgTuple, std::size_t Idx, typename Arg = typename std::tuple_element<Idx, ArgTuple>::type>
-        void apply_arg_variable(Logger& logger, const Arg arg) {
-            //No-Op for anything other than strings...
+        void apply_arg(Logger& logger, const Arg arg) {
+            using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
+            check_arg<ArgTuple, Idx>();
+            argument_parser::apply(logger, arg);
         }
+
         template<typename Logger, typename ArgTuple, std::size_t Idx, typename Arg = typename std::tuple_element<Idx, ArgTuple>::type>
-        void apply_arg_variable(Logger& logger, const char * arg) {
+        void apply_arg_variable(Logger& logger, const Arg arg) {
             using argument_parser = typename std::tuple_element_t<Idx, argument_tuple>;
 
+            //No-Op for fixed size arguments
             if constexpr(!argument_parser::is_fixed_size) {
                 argument_parser::apply_variable(logger, arg);
             }
-        };
+        }
         template<typename Logger, typename ArgTuple, std::size_t... I>
         void _apply_args(Logger& logger, ArgTuple args, std::index_sequence<I...>) {
             (apply_arg<Logger, ArgTuple, I>(logger, std::get<I>(args)), ...);
@@ -90,4 +211,14 @@ namespace llcpp::detail::log_line {
             _apply_args(logger, std::move(args), std::index_sequence_for<Args...>{});
         }
     };
+
+    /*
+     * The log_line type whose format is Prefix's format followed by LogLine's format (with LogLine's config)
+     */
+    template<typename Prefix, typename LogLine>
+    struct prepend_log_line;
+    template<typename PrefixConfig, typename CharT, CharT... PrefixChars, typename LogLine>
+    struct prepend_log_line<log_line<PrefixConfig, CharT, PrefixChars...>, LogLine> {
+        using type = typename LogLine::template log_line_with_prefix<PrefixChars...>;
+    };
 }
\ No newline at end of file
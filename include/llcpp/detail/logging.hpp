@@ -1,23 +1,130 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <functional>
+#include <unordered_map>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 #include "log_line.hpp"
+#include "level.hpp"
 #include "config.hpp"
+#include "format_dictionary.hpp"
+#include "framing.hpp"
+#include "clock.hpp"
+#include "per_thread.hpp"
+#include "cpu.hpp"
+#include "rotation.hpp"
+#include "crash_buffer.hpp"
+#include "stats.hpp"
+#include "sampling.hpp"
+#include "objects.hpp"
+#include "udl.hpp"
 
 namespace llcpp::detail::logging {
-    struct level {
-        enum level_enum : unsigned int {
-            trace = 0,
-            debug = 1,
-            info = 2,
-            warn = 3,
-            err = 4,
-            critical = 5,
-        };
+    // Written once per logger for each type logged with "%T", see objects.hpp
+    using schema_record_line = decltype("\x01schema %16s %s %s"_log);
+    static constexpr std::size_t schema_record_capacity = 4096;
+
+    /*
+     * The format of a meta record (written with `write_meta`) as it's stored, i.e. its id with the format dictionary.
+     * Empty for format dictionary entries and object schemas, which later records depend on: those are all kept.
+     */
+    template<typename Config>
+    std::string_view meta_record_format(const std::uint8_t *data, const std::size_t len) {
+        using schema_format = typename schema_record_line::template log_line_with_config<Config>::string_format;
+        if constexpr(Config::use_format_dictionary) {
+            format_dictionary::format_id_type id;
+            std::memcpy(&id, data, sizeof(id));
+            if (id == format_dictionary::dictionary_marker || id == schema_format::id()) {
+                return {};
+            }
+            return std::string_view(reinterpret_cast<const char *>(data), sizeof(id));
+        } else {
+            std::string_view format(reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), len));
+            if (format == std::string_view(schema_format::_chars)) {
+                return {};
+            }
+            return format;
+        }
+    }
+
+    /*
+     * A fixed size sink used to serialize a single record before handing it to `write_meta`.
+     * Formats are encoded by the owning logger.
+     */
+    template<typename Owner, std::size_t Capacity = 256>
+    struct record_buffer {
+        record_buffer(Owner& owner) : m_owner(owner) {}
+
+        void write(const std::uint8_t *data, const std::size_t len) {
+            if (m_size + len > Capacity) {
+                m_overflow = true;
+                return;
+            }
+            std::memcpy(m_data + m_size, data, len);
+            m_size += len;
+        }
+        std::uint8_t *reserve(const std::size_t len) {
+            return (m_size + len > Capacity) ? (nullptr) : (m_data + m_size);
+        }
+        void commit(const std::size_t len) {
+            m_size += len;
+        }
+
+        template<typename StringFormat>
+        static constexpr std::size_t format_size() {
+            return Owner::template format_size<StringFormat>();
+        }
+        template<typename StringFormat>
+        void prepare_format() {
+            m_owner.template register_format<StringFormat>();
+        }
+        template<typename Object>
+        void register_schema() {
+            m_owner.template register_schema<Object>();
+        }
+        // Meta records are decoded without a timestamp base
+        std::uint64_t timestamp_base() const {
+            return 0;
+        }
+        void set_next_timestamp_base(std::uint64_t timestamp) {
+        }
+        template<typename StringFormat>
+        static void store_format(std::uint8_t *dst) {
+            Owner::template store_format<StringFormat>(dst);
+        }
+        template<typename StringFormat>
+        void write_format() {
+            prepare_format<StringFormat>();
+            std::uint8_t tmp[format_size<StringFormat>()];
+            store_format<StringFormat>(tmp);
+            write(tmp, sizeof(tmp));
+        }
+
+        const std::uint8_t *data() const {
+            return m_data;
+        }
+        std::size_t size() const {
+            return m_size;
+        }
+        bool overflow() const {
+            return m_overflow;
+        }
+
+    private:
+        Owner& m_owner;
+        std::uint8_t m_data[Capacity];
+        std::size_t m_size = 0;
+        bool m_overflow = false;
     };
 
     template<typename PrefixTuple, typename Derived, typename Config = config::default_config>
@@ -30,50 +137,336 @@ namespace llcpp::detail::logging {
 
         template<typename LogLine, typename... Args>
         void trace(LogLine&& line, Args&&... args) {
-            log(level::trace, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::trace>(std::forward<LogLine>(line), std::forward<Args>(args)...);
         }
         template<typename LogLine, typename... Args>
         void debug(LogLine&& line, Args&&... args) {
-            log(level::debug, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::debug>(std::forward<LogLine>(line), std::forward<Args>(args)...);
         }
         template<typename LogLine, typename... Args>
         void info(LogLine&& line, Args&&... args) {
-            log(level::info, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::info>(std::forward<LogLine>(line), std::forward<Args>(args)...);
         }
         template<typename LogLine, typename... Args>
         void warn(LogLine&& line, Args&&... args) {
-            log(level::warn, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::warn>(std::forward<LogLine>(line), std::forward<Args>(args)...);
         }
         template<typename LogLine, typename... Args>
         void err(LogLine&& line, Args&&... args) {
-            log(level::err, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::err>(std::forward<LogLine>(line), std::forward<Args>(args)...);
         }
         template<typename LogLine, typename... Args>
         void critical(LogLine&& line, Args&&... args) {
-            log(level::critical, std::forward<LogLine>(line), std::forward<Args>(args)...);
+            log<level::critical>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+        }
+
+        /*
+         * Lines below `config_t::min_level` are compiled out. Lines below the runtime level cost a relaxed load and a branch,
+         *  but their arguments are still evaluated - use the LLCPP_LOG macros to avoid that.
+         */
+        template<level::level_enum Level, typename LogLine, typename... Args>
+        void log(LogLine&& line, Args&&... args) {
+            if constexpr(Level >= config_t::min_level) {
+                if (should_log<Level>()) {
+                    log_unchecked<Level>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+                }
+            }
+        }
+
+        /*
+         * Sampled variants of `log`, for statements in hot loops: every Nth call, the first N calls, or up to `Lines`
+         *  calls per `IntervalMs` (a token bucket). The state is a static atomic per _log literal, shared by all its
+         *  call sites and loggers. Skipped calls are never serialized, though their arguments are evaluated.
+         * The next logged line of a literal that had calls skipped starts with "[<count> suppressed] ".
+         */
+        template<level::level_enum Level, std::size_t N, typename LogLine, typename... Args>
+        void log_every_n(LogLine&& line, Args&&... args) {
+            log_sampled<Level, sampling::every_n<N>>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+        }
+        template<level::level_enum Level, std::size_t N, typename LogLine, typename... Args>
+        void log_first_n(LogLine&& line, Args&&... args) {
+            log_sampled<Level, sampling::first_n<N>>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+        }
+        template<level::level_enum Level, std::size_t Lines, std::size_t IntervalMs, typename LogLine, typename... Args>
+        void log_per_interval(LogLine&& line, Args&&... args) {
+            log_sampled<Level, sampling::per_interval<Lines, IntervalMs>>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+        }
+        // Policy is one of sampling's policies, or anything with `bool admit(std::uint64_t& suppressed)`
+        template<level::level_enum Level, typename Policy, typename LogLine, typename... Args>
+        void log_sampled(LogLine&& line, Args&&... args) {
+            if constexpr(Level >= config_t::min_level) {
+                if (!should_log<Level>()) {
+                    return;
+                }
+                using site_t = std::decay_t<LogLine>;
+                std::uint64_t suppressed = 0;
+                if (!sampling::site_state<site_t, Policy>.admit(suppressed)) {
+                    return;
+                }
+                if (suppressed == 0) {
+                    log_unchecked<Level>(std::forward<LogLine>(line), std::forward<Args>(args)...);
+                } else {
+                    log_unchecked<Level>(sampling::with_suppressed_count<site_t>(),
+                        static_cast<unsigned long long>(suppressed), std::forward<Args>(args)...);
+                }
+            }
+        }
+
+        template<level::level_enum Level>
+        bool should_log() const {
+            if constexpr(Level < config_t::min_level) {
+                return false;
+            } else {
+                return Level >= m_level.load(std::memory_order_relaxed);
+            }
+        }
+        bool should_log(level::level_enum lvl) const {
+            return lvl >= config_t::min_level && lvl >= m_level.load(std::memory_order_relaxed);
+        }
+        void set_level(level::level_enum lvl) {
+            m_level.store(lvl, std::memory_order_relaxed);
+        }
+        level::level_enum get_level() const {
+            return m_level.load(std::memory_order_relaxed);
+        }
+        // Write a line without checking its level, callers are expected to check `should_log` first
+        template<level::level_enum Level, typename LogLine, typename... Args>
+        void log_unchecked(LogLine&&, Args&&... args) {
+            static_assert(std::is_base_of_v<log_line::log_line_base, std::decay_t<LogLine>>, "LogLine type error, did you mean to use _log?");
+            using log_line_t = typename std::decay_t<LogLine>::template log_line_with_config<config_t>::template log_line_with_suffix<'\n'>;
+            [[maybe_unused]] std::uint64_t start = 0;
+            if constexpr(config_t::use_stats) {
+                start = clock::cycles();
+            }
+            if constexpr(fuse_prefixes) {
+                using fused_log_line_t = typename fused_log_line<log_line_t>::type;
+                std::apply([&](auto&&... prefix_args) {
+                    fused_log_line_t _line;
+                    _line(*this, prefix_args..., args...);
+                }, prefix_arguments(Level, std::make_index_sequence<std::tuple_size_v<PrefixTuple>>{}));
+            } else {
+                apply_prefix_tuples(Level, std::make_index_sequence<std::tuple_size_v<PrefixTuple>>{});
+                log_line_t _line;
+                _line(*this, args...);
+            }
+            if constexpr(Level >= config_t::flush_level) {
+                static_cast<Derived*>(this)->flush_line_impl();
+            } else {
+                line_hint();
+            }
+            if constexpr(config_t::use_stats) {
+                using string_format_t = typename std::decay_t<LogLine>::template log_line_with_config<config_t>::string_format;
+                m_stats.record_line(stats::format_index<string_format_t>(), clock::cycles() - start);
+            }
+        }
+
+        /*
+         * The lines, bytes and latency of each format logged so far (busiest first), and the time logging calls spent
+         *  flushing and rotating. Requires `config_with_stats`.
+         */
+        stats::snapshot stats_snapshot() {
+            static_assert(config_t::use_stats, "Statistics are only kept with config_with_stats");
+            return m_stats.take();
         }
 
         void write(const std::uint8_t *data, const std::size_t len) {
+            if constexpr(config_t::use_stats) {
+                m_stats.add_bytes(len);
+            }
             static_cast<Derived*>(this)->write_impl(data,len);
         }
+        /*
+         * Write a complete record which later records depend on (i.e. a dictionary entry).
+         * The record must reach the output before any record that is written after this call returns.
+         */
+        void write_meta(const std::uint8_t *data, const std::size_t len) {
+            static_cast<Derived*>(this)->write_meta_impl(data,len);
+        }
+        /*
+         * Reserve a contiguous span of `len` bytes for a single record, to be published by `commit`.
+         * Returns nullptr if the logger can't provide such a span, callers should fall back to `write`.
+         */
+        std::uint8_t *reserve(const std::size_t len) {
+            return static_cast<Derived*>(this)->reserve_impl(len);
+        }
+        void commit(const std::size_t len) {
+            if constexpr(config_t::use_stats) {
+                m_stats.add_bytes(len);
+            }
+            static_cast<Derived*>(this)->commit_impl(len);
+        }
+
+        /*
+         * Serialize a whole record and write it with `write_meta`.
+         * Meta records' formats start with '\x01' (i.e. "\x01tsc_calibration %llu"_log) and are consumed by the parser
+         *  rather than shown.
+         */
+        template<std::size_t Capacity = 256, typename LogLine, typename... Args>
+        void write_meta_record(LogLine&&, Args&&... args) {
+            static_assert(std::is_base_of_v<log_line::log_line_base, LogLine>, "LogLine type error, did you mean to use _log?");
+            record_buffer<logger_base, Capacity> buffer(*this);
+            typename std::decay_t<LogLine>::template log_line_with_config<config_t> _line;
+            _line(buffer, std::forward<Args>(args)...);
+            if (!buffer.overflow()) {
+                write_meta(buffer.data(), buffer.size());
+            }
+        }
+
+        // The number of bytes written to identify a record's format
+        template<typename StringFormat>
+        static constexpr std::size_t format_size() {
+            if constexpr(config_t::use_format_dictionary) {
+                return sizeof(format_dictionary::format_id_type);
+            } else {
+                return StringFormat::fmt_size();
+            }
+        }
+        // Must be called before writing or storing a format, starts a record
+        template<typename StringFormat>
+        void prepare_format() {
+            register_format<StringFormat>();
+            static_cast<Derived*>(this)->begin_record_impl();
+        }
+        template<typename StringFormat>
+        void register_format() {
+            if constexpr(config_t::use_format_dictionary) {
+                constexpr format_dictionary::format_id_type id = StringFormat::id();
+                if (!m_format_ids.contains(id)) {
+                    write_dictionary_entry<StringFormat>();
+                    m_format_ids.insert(id);
+                }
+                static_cast<Derived*>(this)->use_format_impl(id);
+            }
+        }
+        // Writes the schema of a type logged with "%T" the first time this logger sees it
+        template<typename Object>
+        void register_schema() {
+            auto& schema = objects::schema_of<Object>();
+            if (!m_schema_ids.contains(schema.id)) {
+                write_meta_record<schema_record_capacity>(schema_record_line{}, schema.hex_id, schema.name.c_str(), schema.fields.c_str());
+                m_schema_ids.insert(schema.id);
+            }
+        }
+        template<typename StringFormat>
+        static void store_format(std::uint8_t *dst) {
+            if constexpr(config_t::use_format_dictionary) {
+                constexpr format_dictionary::format_id_type id = StringFormat::id();
+                std::memcpy(dst, &id, sizeof(id));
+            } else {
+                std::memcpy(dst, StringFormat::_chars, StringFormat::fmt_size());
+            }
+        }
+        template<typename StringFormat>
+        void write_format() {
+            prepare_format<StringFormat>();
+            if constexpr(config_t::use_format_dictionary) {
+                constexpr format_dictionary::format_id_type id = StringFormat::id();
+                write((const std::uint8_t *)&id, sizeof(id));
+            } else {
+                write((const std::uint8_t *)StringFormat::_chars, StringFormat::fmt_size());
+            }
+        }
         void line_hint() {
             static_cast<Derived*>(this)->line_hint_impl();
         }
+        /*
+         * Compact timestamps (see terminators::compact::t) are written as the difference from `timestamp_base()`.
+         * A record's timestamps all use the base it started with, the next record's base is the last one it wrote.
+         */
+        std::uint64_t timestamp_base() {
+            return static_cast<Derived*>(this)->timestamp_base_impl();
+        }
+        void set_next_timestamp_base(std::uint64_t timestamp) {
+            static_cast<Derived*>(this)->set_next_timestamp_base_impl(timestamp);
+        }
 
     protected:
+        /*
+         * Prefixes that declare a `log_line_t` (the type of their _log format) and
+         *  `template<typename Logger> auto arguments(level::level_enum, Logger&)` (a tuple of the format's arguments)
+         *  are fused with the line: their formats are concatenated at compile time and the whole line is
+         *  serialized as a single record.
+         * Prefixes that only implement `apply` write records of their own.
+         */
+        template<typename Prefix, typename = void>
+        struct is_fusable_prefix : std::false_type {};
+        template<typename Prefix>
+        struct is_fusable_prefix<Prefix, std::void_t<typename Prefix::log_line_t>> : std::true_type {};
+
         template<std::size_t... I>
-        void apply_prefix_tuples(typename level::level_enum level, std::index_sequence<I...>) {
-            (std::get<I>(m_prefix_tuple).apply(level, *this), ...);
+        static constexpr bool all_prefixes_fusable(std::index_sequence<I...>) {
+            return (is_fusable_prefix<std::tuple_element_t<I, PrefixTuple>>::value && ...);
         }
+        static constexpr bool fuse_prefixes = all_prefixes_fusable(std::make_index_sequence<std::tuple_size_v<PrefixTuple>>{});
 
-        template<typename LogLine, typename... Args>
-        void log(typename level::level_enum level, LogLine&& line, Args&&... args) {
-            static_assert(std::is_base_of_v<log_line::log_line_base, LogLine>, "LogLine type error, did you mean to use _log?");            
-            apply_prefix_tuples(level, std::make_index_sequence<std::tuple_size_v<PrefixTuple>>{});
-            using log_line_t = typename LogLine::template log_line_with_config<config_t>::template log_line_with_suffix<'\n'>;
-            log_line_t _line;
-            _line(*this, args...);
-            line_hint();
+        template<typename LogLine, std::size_t Idx = std::tuple_size_v<PrefixTuple>>
+        struct fused_log_line {
+            using prefix_log_line_t = typename std::tuple_element_t<Idx - 1, PrefixTuple>::log_line_t;
+            using type = typename fused_log_line<typename log_line::prepend_log_line<prefix_log_line_t, LogLine>::type, Idx - 1>::type;
+        };
+        template<typename LogLine>
+        struct fused_log_line<LogLine, 0> {
+            using type = LogLine;
+        };
+
+        template<typename Prefix>
+        void apply_prefix(typename level::level_enum level, Prefix& prefix) {
+            if constexpr(is_fusable_prefix<Prefix>::value) {
+                std::apply([this](auto&&... prefix_args) {
+                    typename Prefix::log_line_t _line;
+                    _line(*this, prefix_args...);
+                }, prefix.arguments(level, *this));
+            } else {
+                prefix.apply(level, *this);
+            }
+        }
+        template<std::size_t... I>
+        void apply_prefix_tuples([[maybe_unused]] typename level::level_enum level, std::index_sequence<I...>) {
+            (apply_prefix(level, std::get<I>(m_prefix_tuple)), ...);
+        }
+        template<std::size_t... I>
+        auto prefix_arguments([[maybe_unused]] typename level::level_enum level, std::index_sequence<I...>) {
+            return std::tuple_cat(std::get<I>(m_prefix_tuple).arguments(level, *this)...);
+        }
+
+        /*
+         * With a stats report interval, log the report once it's due. Loggers call it on their flush path, between
+         *  lines, so it's paid by a call that already wrote to its sink rather than by a buffered one.
+         */
+        void report_stats_if_due() {
+            if constexpr(config_t::use_stats && config_t::stats_report_interval_ms > 0) {
+                if (m_stats.report_due()) {
+                    write_stats_report();
+                }
+            }
+        }
+        // The statistics of the busiest formats, as info lines
+        __attribute__((noinline)) void write_stats_report() {
+            auto snapshot = m_stats.take();
+            for (std::size_t i = 0; i < snapshot.formats.size() && i < stats_report_formats; i++) {
+                auto& format = snapshot.formats[i];
+                log_unchecked<level::info>("llcpp stats: %llu lines %llu bytes, p50 %llu p99 %llu max %llu ns: %s"_log,
+                    static_cast<unsigned long long>(format.lines), static_cast<unsigned long long>(format.bytes),
+                    static_cast<unsigned long long>(format.latency.percentile(50)),
+                    static_cast<unsigned long long>(format.latency.percentile(99)),
+                    static_cast<unsigned long long>(format.latency.max_ns), format.format.data());
+            }
+            log_unchecked<level::info>("llcpp stats: %llu flush stalls, p99 %llu max %llu ns, %llu rotations, max %llu ns"_log,
+                static_cast<unsigned long long>(snapshot.flush_stalls.count),
+                static_cast<unsigned long long>(snapshot.flush_stalls.percentile(99)),
+                static_cast<unsigned long long>(snapshot.flush_stalls.max_ns),
+                static_cast<unsigned long long>(snapshot.rotation_stalls.count),
+                static_cast<unsigned long long>(snapshot.rotation_stalls.max_ns));
+        }
+
+        template<typename StringFormat>
+        void write_dictionary_entry() {
+            using format_dictionary::format_id_type;
+            constexpr format_id_type header[] = { format_dictionary::dictionary_marker, StringFormat::id() };
+            std::uint8_t entry[sizeof(header) + StringFormat::fmt_size()];
+            std::memcpy(entry, header, sizeof(header));
+            std::memcpy(entry + sizeof(header), StringFormat::_chars, StringFormat::fmt_size());
+            write_meta(entry, sizeof(entry));
         }
 
         //Override these two functions in your derived logger
@@ -81,76 +474,624 @@ namespace llcpp::detail::logging {
         }
         void line_hint_impl() {
         }
+        //Optionally override this one to flush the lines at or above `config_t::flush_level` before the call returns
+        void flush_line_impl() {
+            static_cast<Derived*>(this)->line_hint_impl();
+        }
+        //Optionally override this one if write_impl may reorder records (i.e. per thread buffers)
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            static_cast<Derived*>(this)->write_impl(data, len);
+        }
+        //Optionally override these two to let records be serialized directly into the logger's buffer
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            return nullptr;
+        }
+        void commit_impl(const std::size_t len) {
+        }
+        //Optionally override these to keep a timestamp base, the parser must keep the same one (see framing's blocks)
+        void begin_record_impl() {
+        }
+        //Optionally override this to know the formats (their dictionary ids) the records are written with
+        void use_format_impl(format_dictionary::format_id_type) {
+        }
+        std::uint64_t timestamp_base_impl() {
+            return 0;
+        }
+        void set_next_timestamp_base_impl(std::uint64_t timestamp) {
+        }
 
         PrefixTuple m_prefix_tuple;
+        std::atomic<level::level_enum> m_level{level::trace};
+        std::conditional_t<
+            config_t::use_format_dictionary,
+            format_dictionary::format_id_set<>,
+            format_dictionary::empty_format_id_set
+        > m_format_ids;
+        format_dictionary::format_id_set<256> m_schema_ids;
+        static constexpr std::size_t stats_report_formats = 10;
+        std::conditional_t<
+            config_t::use_stats,
+            stats::recorder<config_t::stats_report_interval_ms>,
+            stats::empty_recorder
+        > m_stats;
     };
 
+    /*
+     * Each thread writes to its own buffer, per logger instance, registered with the logger on first use.
+     * A thread's buffer is flushed when the thread exits and handed to the next thread that logs, and every buffer is
+     *  flushed when the logger is destroyed (the logger must not be logged to concurrently with its destruction).
+     * With `Config::use_per_cpu_buffers`, buffers are per CPU instead: a line is written to the buffer of the CPU
+     *  the thread was on when the line started, locked (with a try-lock, moving on to the next CPU's buffer if it's
+     *  taken) until the line ends. Memory is then bounded by the number of CPUs rather than threads.
+     * The buffer size is `Config::buffer_size`, or a block (`Config::block_size`) when framing.
+     * With a `rotation::policy`, the logger moves on to the next file once the current one is big or old enough
+     *  (checked when a buffer is written, acted on by the next line to end). Each file starts with its own file header
+     *  and the meta records written so far (the format dictionary, the latest tsc calibration), so it decodes on its own.
+     */
     template<typename PrefixTuple, typename Config = config::default_config>
     struct file_logger : public detail::logging::logger_base<PrefixTuple, file_logger<PrefixTuple, Config>, Config> {
         friend class detail::logging::logger_base<PrefixTuple, file_logger<PrefixTuple, Config>, Config>;
 
-        file_logger(std::string_view path, PrefixTuple&& prefix_tuple = {}) : m_fp(std::fopen(path.data(), "w"), std::fclose),
-            logger_base<PrefixTuple, file_logger<PrefixTuple, Config>, Config>(std::forward<PrefixTuple>(prefix_tuple))
+        file_logger(std::string_view path, PrefixTuple&& prefix_tuple = {}) :
+            logger_base<PrefixTuple, file_logger<PrefixTuple, Config>, Config>(std::forward<PrefixTuple>(prefix_tuple)),
+            m_output(std::make_unique<output>(std::fopen(path.data(), "w"))),
+            m_crash_region(open_crash_region(path))
         {
             //TODO: Check errors etc...
+            write_file_header(*m_output);
+        }
+        file_logger(std::string_view path, const rotation::policy& policy, PrefixTuple&& prefix_tuple = {}) :
+            file_logger(path, std::forward<PrefixTuple>(prefix_tuple))
+        {
+            if (policy.enabled()) {
+                m_rotator = std::make_unique<rotation::file_rotator<output>>(path, policy, &file_logger::finish);
+                m_rotator->preallocate(m_output->fp.get());
+                m_rotate_at = policy.next_rotation(clock::coarse_realtime_ns());
+            }
         }
-        file_logger(std::FILE *fp, PrefixTuple&& prefix_tuple = {}) : m_fp(fp, {}),
-            logger_base<PrefixTuple, file_logger<PrefixTuple>>(std::forward<PrefixTuple>(prefix_tuple))
+        file_logger(std::FILE *fp, PrefixTuple&& prefix_tuple = {}) :
+            logger_base<PrefixTuple, file_logger<PrefixTuple, Config>, Config>(std::forward<PrefixTuple>(prefix_tuple)),
+            m_output(std::make_unique<output>(fp, false))
         {
             //TODO: Check errors etc...
+            write_file_header(*m_output);
         }
         ~file_logger() {
-            line_hint_impl(true);
+            m_buffers.detach_all([this](thread_buffer& buf) {
+                flush(buf);
+            });
+            m_buffers.for_each([](thread_buffer& buf) {
+                buf.release_cache();
+            });
+            for (auto& shard : m_shards) {
+                flush(shard->buf);
+            }
+            finish(*m_output);
+            // Finishes the files rotated out
+            m_rotator.reset();
         }
 
         void line_hint_impl(bool force_flush = false) {
+            auto& buf = buffer();
+            // Lines end at a record boundary, only complete lines are flushed (as blocks when framing)
+            if (buf.spilling) {
+                auto timer = this->m_stats.time_flush();
+                flush_spill(buf);
+            } else {
+                buf.line_start = buf.count;
+                buf.line_count++;
+            }
+            if constexpr(use_timestamp_deltas) {
+                buf.line_timestamp_base = buf.next_timestamp_base;
+            }
+            if constexpr(use_crash_buffer) {
+                publish_lines(buf);
+            }
+            if constexpr(use_flush_interval) {
+                force_flush = flush_due(buf) || force_flush;
+            }
             if (force_flush) {
-                std::fwrite(m_cache, m_cache_count, 1, m_fp.get());
-                m_cache_count = 0;
+                auto timer = this->m_stats.time_flush();
+                flush(buf);
+                flush_output();
+            }
+            if (m_rotation_due.load(std::memory_order_relaxed)) {
+                auto timer = this->m_stats.time_rotation();
+                rotate();
+            }
+            bool flushed = std::exchange(buf.flushed, false);
+            if constexpr(use_per_cpu_buffers) {
+                release_shard();
+            }
+            if (flushed) {
+                this->report_stats_if_due();
             }
         }
+        void flush_line_impl() {
+            line_hint_impl(true);
+        }
     protected:
+        static constexpr bool use_framing = Config::use_framing;
+        static constexpr bool use_per_cpu_buffers = Config::use_per_cpu_buffers;
+        static constexpr std::size_t payload_capacity = (use_framing) ? (Config::block_size) : (Config::buffer_size);
+        static constexpr std::size_t cache_size = (use_framing) ? (sizeof(framing::block_header) + payload_capacity) : (payload_capacity);
+        /*
+         * Compact timestamps are deltas within a buffer, from the first timestamp of the block they're written in.
+         * Without framing nothing tells the parser where a buffer's records start, so they're deltas from 0.
+         */
+        static constexpr bool use_timestamp_deltas = use_framing && Config::use_compact_encoding;
+        using compressor = typename Config::compressor;
+        static constexpr bool use_compression = compressor::id != compression::stored_id;
+        static_assert(use_framing || !use_compression, "Compression needs framing, compressed blocks are the container's blocks");
+        static constexpr bool use_crash_buffer = Config::use_crash_buffer;
+        static constexpr bool use_flush_interval = Config::flush_interval_ms > 0;
+        static_assert(!use_crash_buffer || std::is_same_v<typename Config::file_writer, file_writer::stdio_writer>,
+            "The crash buffer doesn't cover the lines held by batching file writers");
+
+        struct thread_buffer {
+            explicit thread_buffer(file_logger *owner) : logger(owner) {
+                if constexpr(use_crash_buffer) {
+                    if (owner->m_crash_region) {
+                        slot = owner->m_crash_region->acquire();
+                    }
+                }
+                if (slot) {
+                    cache = crash_buffer::region::buffer(slot);
+                } else {
+                    heap_cache.reset(new std::uint8_t[cache_size]);
+                    cache = heap_cache.get();
+                }
+                if constexpr(use_timestamp_deltas) {
+                    timestamp_base = next_timestamp_base = line_timestamp_base = clock::coarse_realtime_ns();
+                }
+            }
+            // The buffer goes to the next thread, with its cache (and crash buffer slot)
+            void on_thread_exit() {
+                logger->flush(*this);
+                count = 0;
+                spilling = false;
+                spill.clear();
+            }
+
+            // When framing, holds a block header followed by the block's payload
+            std::uint8_t *payload() {
+                return (use_framing) ? (cache + sizeof(framing::block_header)) : (cache);
+            }
+            // Once the buffer is flushed for good
+            void release_cache() {
+                if (slot) {
+                    crash_buffer::region::release(slot);
+                    slot = nullptr;
+                }
+                heap_cache.reset();
+                cache = nullptr;
+            }
+
+            // On the heap, or in the crash buffer's slot
+            std::uint8_t *cache;
+            std::unique_ptr<std::uint8_t[]> heap_cache;
+            crash_buffer::slot_header *slot = nullptr;
+            std::size_t count = 0;
+            std::size_t line_start = 0;
+            bool spilling = false;
+            std::vector<std::uint8_t> spill;
+            // Complete lines in the buffer
+            std::uint32_t line_count = 0;
+            // With a flush interval, when the buffer's first complete line ended
+            std::uint64_t first_line_time = 0;
+            // Written since the last line ended, the stats report goes with a flush
+            bool flushed = false;
+            std::uint64_t block_timestamp = 0;
+            // The current record's timestamp base, the next record's, and the current line's first record's
+            std::uint64_t timestamp_base = 0;
+            std::uint64_t next_timestamp_base = 0;
+            std::uint64_t line_timestamp_base = 0;
+            // Compression only, a block header followed by the compressed payload
+            std::vector<std::uint8_t> compressed;
+            file_logger *logger;
+        };
+
+        // A file being written, replaced when rotating
+        struct output {
+            explicit output(std::FILE *file, bool owned = true) :
+                fp(file, [owned](std::FILE *f) { return (owned) ? (std::fclose(f)) : (0); }), writer(file)
+            {
+                if constexpr(use_crash_buffer) {
+                    // Flushed lines must reach the file, the crash buffer no longer holds them
+                    if (file) {
+                        std::setvbuf(file, nullptr, _IONBF, 0);
+                    }
+                }
+            }
+
+            std::unique_ptr<std::FILE, std::function<int(std::FILE*)>> fp;
+            // Declared after fp, it's flushed before the file is closed
+            typename Config::file_writer writer;
+            std::uint64_t offset = 0;
+            std::vector<framing::index_entry> index;
+        };
+
+        struct alignas(64) cpu_shard {
+            explicit cpu_shard(file_logger *owner) : buf(owner) {}
+
+            std::atomic<bool> locked{false};
+            thread_buffer buf;
+        };
+        // The shard the calling thread holds for the line it's writing
+        struct held_shard_t {
+            file_logger *owner;
+            cpu_shard *shard;
+        };
+        static held_shard_t& held_shard() {
+            thread_local held_shard_t t_held = {nullptr, nullptr};
+            return t_held;
+        }
+
+        thread_buffer& buffer() {
+            if constexpr(use_per_cpu_buffers) {
+                auto& held = held_shard();
+                if (held.owner == this) {
+                    return held.shard->buf;
+                }
+                return acquire_shard(held);
+            } else {
+                return m_buffers.local(this);
+            }
+        }
+        __attribute__((noinline)) thread_buffer& acquire_shard(held_shard_t& held) {
+            auto first = cpu::current();
+            for (std::size_t i = 0;; i++) {
+                auto& shard = *m_shards[(first + i) % m_shards.size()];
+                if (!shard.locked.load(std::memory_order_relaxed) && !shard.locked.exchange(true, std::memory_order_acquire)) {
+                    held = {this, &shard};
+                    return shard.buf;
+                }
+                // Every shard is held by a line in progress (i.e. its writer was preempted)
+                if ((i + 1) % m_shards.size() == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        void release_shard() {
+            auto& held = held_shard();
+            if (held.owner == this) {
+                held.shard->locked.store(false, std::memory_order_release);
+                held = {nullptr, nullptr};
+            }
+        }
+        // Called between lines, so everything in the buffer is flushed
+        void flush(thread_buffer& buf) {
+            flush_lines(buf);
+        }
+        // Hand what the file writer holds to the file
+        void flush_output() {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            m_output->writer.flush();
+        }
+        // Called as a line ends in `buf`, the coarse clock is cheap enough to read on every line
+        bool flush_due(thread_buffer& buf) {
+            auto now = clock::coarse_realtime_ns();
+            if (buf.line_count <= 1) {
+                buf.first_line_time = now;
+                return false;
+            }
+            return now - buf.first_line_time >= Config::flush_interval_ms * 1000000;
+        }
+
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            // Bypass the (per thread) cache, other threads may reference this record before our cache is flushed
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            if (m_rotator) {
+                remember_meta(data, len);
+            }
+            write_meta_to(*m_output, data, len);
+            check_rotation();
+        }
+        static void write_meta_to(output& out, const std::uint8_t *data, const std::size_t len) {
+            if constexpr(use_framing) {
+                std::uint8_t stack_block[512];
+                std::vector<std::uint8_t> heap_block;
+                std::uint8_t *block = stack_block;
+                if (sizeof(framing::block_header) + len > sizeof(stack_block)) {
+                    heap_block.resize(sizeof(framing::block_header) + len);
+                    block = heap_block.data();
+                }
+                std::memcpy(block + sizeof(framing::block_header), data, len);
+                append_block(out, block, len, 0, clock::coarse_realtime_ns(), framing::meta_block);
+            } else {
+                out.writer.write(data, len);
+                out.offset += len;
+            }
+        }
         void write_impl(const std::uint8_t *data, const std::size_t len) { 
-            if (len > sizeof(m_cache)) {
-                // Flush current cache
-                line_hint_impl(true);
-                // Write everything else directly
-                std::fwrite(data, len, 1, m_fp.get());
+            auto& buf = buffer();
+            if (buf.spilling || !make_room(buf, len)) {
+                spill(buf, data, len);
                 return;
-            }  
-            if (m_cache_count + len > sizeof(m_cache)) {
-                // TODO: Will probably be faster if we fill the cache, flush and then copy the rest.
-                line_hint_impl(true);
             }
-            std::memcpy(m_cache + m_cache_count, data, len);
-            m_cache_count += len;
+            std::memcpy(buf.payload() + buf.count, data, len);
+            buf.count += len;
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            auto& buf = buffer();
+            if (buf.spilling || !make_room(buf, len)) {
+                return nullptr;
+            }
+            return buf.payload() + buf.count;
+        }
+        void commit_impl(const std::size_t len) {
+            buffer().count += len;
+        }
+        void begin_record_impl() {
+            if constexpr(use_timestamp_deltas) {
+                auto& buf = buffer();
+                buf.timestamp_base = buf.next_timestamp_base;
+            }
+        }
+        std::uint64_t timestamp_base_impl() {
+            if constexpr(use_timestamp_deltas) {
+                return buffer().timestamp_base;
+            } else {
+                return 0;
+            }
+        }
+        void set_next_timestamp_base_impl(std::uint64_t timestamp) {
+            if constexpr(use_timestamp_deltas) {
+                buffer().next_timestamp_base = timestamp;
+            }
         }
 
-        std::unique_ptr<std::FILE, std::function<int(std::FILE*)>> m_fp;
-        static constexpr std::size_t m_cache_size = 4 * 1024;
-        static thread_local std::uint8_t m_cache[m_cache_size];
-        static thread_local std::size_t m_cache_count;
-    };
+        static void write_file_header(output& out) {
+            if constexpr(use_framing) {
+                auto header = framing::make_file_header<Config>(static_cast<std::uint32_t>(Config::block_size));
+                out.writer.write(header.data(), header.size());
+                out.offset = header.size();
+            }
+        }
+        // Called on a file once nothing else is written to it
+        static void finish(output& out) {
+            if constexpr(use_framing) {
+                write_index(out);
+            }
+        }
+
+        /*
+         * `line_start` is where the current (incomplete) line starts, everything before it can be flushed, so a line's
+         *  records are written together even when they're written in pieces.
+         * A line that doesn't fit in an empty buffer is spilled to a growable buffer and written whole (as an oversized block).
+         * Framing: the cache holds a block header followed by the block's payload, so a block is written with a single
+         *  write. With timestamp deltas, a block's first timestamp is the timestamp base of its first record.
+         */
+        bool make_room(thread_buffer& buf, const std::size_t len) {
+            if constexpr(use_framing) {
+                if (buf.count == 0) {
+                    buf.block_timestamp = (use_timestamp_deltas) ? (buf.timestamp_base) : (clock::coarse_realtime_ns());
+                }
+            }
+            if (buf.count + len <= payload_capacity) {
+                return true;
+            }
+            auto timer = this->m_stats.time_flush();
+            flush_lines(buf);
+            return buf.count + len <= payload_capacity;
+        }
+        void flush_lines(thread_buffer& buf) {
+            if (buf.line_start == 0) {
+                return;
+            }
+            if constexpr(use_framing) {
+                write_data_block(buf, buf.cache, buf.line_start, buf.line_count, buf.slot);
+            } else {
+                write_data(buf.payload(), buf.line_start, buf.slot);
+            }
+            auto pending = buf.count - buf.line_start;
+            std::memmove(buf.payload(), buf.payload() + buf.line_start, pending);
+            buf.count = pending;
+            buf.line_start = 0;
+            buf.line_count = 0;
+            buf.flushed = true;
+            if constexpr(use_framing) {
+                buf.block_timestamp = (use_timestamp_deltas) ? (buf.line_timestamp_base) : (clock::coarse_realtime_ns());
+            }
+        }
+        // Crash buffer: the lines a crash would leave to recover
+        void publish_lines(thread_buffer& buf) {
+            if (buf.slot) {
+                buf.slot->line_count.store(buf.line_count, std::memory_order_relaxed);
+                buf.slot->block_timestamp.store(buf.block_timestamp, std::memory_order_relaxed);
+                buf.slot->committed.store(buf.line_start, std::memory_order_release);
+            }
+        }
+        void spill(thread_buffer& buf, const std::uint8_t *data, const std::size_t len) {
+            if (!buf.spilling) {
+                // Only the current line is left in the cache
+                buf.spill.assign(buf.cache, buf.payload() + buf.count);
+                buf.count = 0;
+                buf.spilling = true;
+            }
+            buf.spill.insert(buf.spill.end(), data, data + len);
+        }
+        void flush_spill(thread_buffer& buf) {
+            if constexpr(use_framing) {
+                write_data_block(buf, buf.spill.data(), buf.spill.size() - sizeof(framing::block_header), 1);
+            } else {
+                write_data(buf.spill.data(), buf.spill.size());
+            }
+            buf.spill.clear();
+            buf.spilling = false;
+            buf.flushed = true;
+        }
+        /*
+         * Compression runs here, on the flushing thread and outside the blocks lock, so it's paid once per block and
+         *  in parallel. Blocks that don't shrink are written as is.
+         */
+        void write_data_block(thread_buffer& buf, std::uint8_t *block, const std::size_t payload_size, std::uint32_t record_count,
+                crash_buffer::slot_header *slot = nullptr) {
+            if constexpr(use_compression) {
+                constexpr std::size_t prefix_size = sizeof(framing::block_header) + sizeof(std::uint32_t);
+                auto capacity = compressor::max_compressed_size(payload_size);
+                if (buf.compressed.size() < prefix_size + capacity) {
+                    buf.compressed.resize(prefix_size + capacity);
+                }
+                auto size = compressor::compress(block + sizeof(framing::block_header), payload_size,
+                    buf.compressed.data() + prefix_size, capacity);
+                if (size > 0 && sizeof(std::uint32_t) + size < payload_size) {
+                    auto uncompressed_size = static_cast<std::uint32_t>(payload_size);
+                    std::memcpy(buf.compressed.data() + sizeof(framing::block_header), &uncompressed_size, sizeof(uncompressed_size));
+                    write_block(buf.compressed.data(), sizeof(std::uint32_t) + size, record_count, buf.block_timestamp,
+                        framing::data_block, compressor::id, slot);
+                    return;
+                }
+            }
+            write_block(block, payload_size, record_count, buf.block_timestamp, framing::data_block, compression::stored_id, slot);
+        }
+        /*
+         * Unframed, whole lines.
+         * `slot` is the crash buffer slot the data is flushed from, marked as flushing for as long as the write may
+         *  be incomplete. It's done under the output lock so that an interrupted write is always the end of the file.
+         */
+        void write_data(const std::uint8_t *data, const std::size_t len, crash_buffer::slot_header *slot = nullptr) {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            crash_buffer::begin_flush(slot, m_output->offset);
+            m_output->writer.write(data, len);
+            m_output->offset += len;
+            crash_buffer::end_flush(slot);
+            check_rotation();
+        }
+        // `block` is a block header followed by `payload_size` bytes of payload
+        void write_block(std::uint8_t *block, const std::size_t payload_size, std::uint32_t record_count,
+                std::uint64_t first_timestamp, std::uint16_t flags, std::uint16_t codec = compression::stored_id,
+                crash_buffer::slot_header *slot = nullptr) {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            crash_buffer::begin_flush(slot, m_output->offset);
+            append_block(*m_output, block, payload_size, record_count, first_timestamp, flags, codec);
+            crash_buffer::end_flush(slot);
+            check_rotation();
+        }
+        static void append_block(output& out, std::uint8_t *block, const std::size_t payload_size, std::uint32_t record_count,
+                std::uint64_t first_timestamp, std::uint16_t flags, std::uint16_t codec = compression::stored_id) {
+            framing::block_header header;
+            framing::seal_block(header, static_cast<std::uint32_t>(payload_size), record_count, first_timestamp, flags,
+                block + sizeof(header), codec);
+            std::memcpy(block, &header, sizeof(header));
+            out.index.push_back({out.offset, first_timestamp, record_count, flags, 0});
+            out.writer.write(block, sizeof(header) + payload_size);
+            out.offset += sizeof(header) + payload_size;
+        }
+        static void write_index(output& out) {
+            auto index_size = out.index.size() * sizeof(framing::index_entry);
+            std::vector<std::uint8_t> block(sizeof(framing::block_header) + index_size);
+            std::memcpy(block.data() + sizeof(framing::block_header), out.index.data(), index_size);
+            auto index_offset = out.offset;
+            append_block(out, block.data(), index_size, 0, clock::coarse_realtime_ns(), framing::index_block);
+            framing::trailer trailer;
+            trailer.index_offset = index_offset;
+            std::memcpy(trailer.magic, framing::index_magic.data(), sizeof(trailer.magic));
+            out.writer.write(reinterpret_cast<const std::uint8_t *>(&trailer), sizeof(trailer));
+        }
 
-    template<typename PrefixTuple, typename Config>
-    thread_local std::uint8_t file_logger<PrefixTuple, Config>::m_cache[m_cache_size] = {0};
-    template<typename PrefixTuple, typename Config>
-    thread_local std::size_t file_logger<PrefixTuple, Config>::m_cache_count = 0;
+        /*
+         * Rotation. With m_output_mutex held, the writes flag the rotation as due, and the next line to end
+         *  does it: the prepared file gets its header and the meta state, and the current one is handed to the rotator
+         *  to be finished and closed. Lines still buffered by other threads go to the new file.
+         */
+        void check_rotation() {
+            if (m_rotator && !m_rotation_due.load(std::memory_order_relaxed)) {
+                auto max_size = m_rotator->rotation_policy().max_size;
+                if ((max_size > 0 && m_output->offset >= max_size) || clock::coarse_realtime_ns() >= m_rotate_at) {
+                    m_rotation_due.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+        __attribute__((noinline)) void rotate() {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            if (!m_rotation_due.load(std::memory_order_relaxed)) {
+                // Another thread rotated first
+                return;
+            }
+            m_rotation_due.store(false, std::memory_order_relaxed);
+            m_rotate_at = m_rotator->rotation_policy().next_rotation(clock::coarse_realtime_ns());
+            auto next = m_rotator->next();
+            if (!next) {
+                // Keep writing to the current file
+                return;
+            }
+            write_file_header(*next);
+            if (!m_dictionary.empty()) {
+                write_meta_to(*next, m_dictionary.data(), m_dictionary.size());
+            }
+            for (auto& [format, record] : m_latest_meta) {
+                write_meta_to(*next, record.data(), record.size());
+            }
+            m_rotator->retire(std::exchange(m_output, std::move(next)));
+            m_file_index++;
+            if (m_crash_region) {
+                m_crash_region->set_file_index(m_file_index);
+            }
+        }
+        /*
+         * Dictionary entries are all kept, other meta records (i.e. tsc_calibration) are state: only the latest one
+         *  with each format is.
+         */
+        void remember_meta(const std::uint8_t *data, const std::size_t len) {
+            auto format = meta_record_format<Config>(data, len);
+            if (format.empty()) {
+                m_dictionary.insert(m_dictionary.end(), data, data + len);
+                return;
+            }
+            m_latest_meta[std::string(format)].assign(data, data + len);
+        }
+
+        std::mutex m_output_mutex;
+        std::unique_ptr<output> m_output;
+        std::unique_ptr<rotation::file_rotator<output>> m_rotator;
+        std::uint64_t m_rotate_at = ~0ULL;
+        std::atomic<bool> m_rotation_due{false};
+        // Rotation only, written again at the start of each file
+        std::vector<std::uint8_t> m_dictionary;
+        std::unordered_map<std::string, std::vector<std::uint8_t>> m_latest_meta;
+        std::uint64_t m_file_index = 0;
+        // Before the buffers, which take its slots
+        std::unique_ptr<crash_buffer::region> m_crash_region;
+
+        static std::unique_ptr<crash_buffer::region> open_crash_region(std::string_view path) {
+            if constexpr(use_crash_buffer) {
+                auto region = std::make_unique<crash_buffer::region>(path, static_cast<std::uint32_t>(Config::crash_buffer_slots),
+                    static_cast<std::uint32_t>(cache_size), (use_framing) ? (static_cast<std::uint32_t>(crash_buffer::framed_flag)) : (0u));
+                if (region->is_open()) {
+                    return region;
+                }
+            }
+            return nullptr;
+        }
+        per_thread::registry<thread_buffer> m_buffers;
+        std::vector<std::unique_ptr<cpu_shard>> m_shards = make_shards();
+
+        std::vector<std::unique_ptr<cpu_shard>> make_shards() {
+            std::vector<std::unique_ptr<cpu_shard>> shards;
+            if constexpr(use_per_cpu_buffers) {
+                for (std::size_t i = 0; i < cpu::count(); i++) {
+                    shards.push_back(std::make_unique<cpu_shard>(this));
+                }
+            }
+            return shards;
+        }
+    };
 
     //XXX: Hack...
     template<typename PrefixTuple, typename Config = config::default_config>
     struct stdout_logger : public file_logger<PrefixTuple, Config> {
         stdout_logger(PrefixTuple&& prefix_tuple = {}) : 
-            file_logger<PrefixTuple>(stdout, std::forward<PrefixTuple>(prefix_tuple))
+            file_logger<PrefixTuple, Config>(stdout, std::forward<PrefixTuple>(prefix_tuple))
         {
         }
     };
 
     template<typename PrefixTuple, typename Config = config::default_config>
-    struct vector_logger : public logger_base<PrefixTuple, vector_logger<PrefixTuple>, Config> {
+    struct vector_logger : public logger_base<PrefixTuple, vector_logger<PrefixTuple, Config>, Config> {
 
         vector_logger(std::vector<std::uint8_t>& vec, PrefixTuple&& prefix_tuple = {}) : m_vec(vec),
-            logger_base<PrefixTuple, vector_logger<PrefixTuple>>(std::forward<PrefixTuple>(prefix_tuple))
+            logger_base<PrefixTuple, vector_logger<PrefixTuple, Config>, Config>(std::forward<PrefixTuple>(prefix_tuple))
         {
         }
 
@@ -160,8 +1101,19 @@ namespace llcpp::detail::logging {
         void write_impl(const std::uint8_t *data, const std::size_t len) {    
             m_vec.insert(m_vec.end(), data, data+len);
         }
+        // Records are serialized into a buffer of our own, growing m_vec ahead would zero fill what's then overwritten
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            if (m_record.size() < len) {
+                m_record.resize(len);
+            }
+            return m_record.data();
+        }
+        void commit_impl(const std::size_t len) {
+            m_vec.insert(m_vec.end(), m_record.data(), m_record.data() + len);
+        }
 
     private:
         std::vector<std::uint8_t>& m_vec;
+        std::vector<std::uint8_t> m_record;
     };
 }
\ No newline at end of file
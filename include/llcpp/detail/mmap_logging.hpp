@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "logging.hpp"
+#include "per_thread.hpp"
+
+namespace llcpp::detail::logging {
+    /*
+     * What mmap_file_logger does with a chunk once the writers moved past it:
+     * - none: Leave write back to the kernel.
+     * - async: Start writing it back (msync(MS_ASYNC)).
+     * - sync: Write it back and wait (msync(MS_SYNC)), on the thread that maps the next chunk.
+     */
+    enum class mmap_sync_policy {
+        none,
+        async,
+        sync,
+    };
+
+    /*
+     * Serializes records straight into a shared mapping of the log file.
+     * The file grows in chunks of `ChunkSize` bytes, preallocated with fallocate and mapped back to back into a
+     *  reserved range of address space, so that a record's span is always contiguous. A record is placed by an atomic
+     *  compare-and-swap on the file's tail, the call site makes no syscall and no intermediate copy. Only mapped space
+     *  is ever claimed, so the file has no hole short of a crash mid-record.
+     * Records that can't be serialized in a single shot (i.e. prefixes that aren't fused) are staged in a per-thread
+     *  buffer and copied into the mapping as a whole line.
+     * When the logger is destroyed, the file is truncated to the written size. A process that dies first leaves the
+     *  rest of the last chunk zeroed, which decoders read as the end of the log.
+     */
+    template<typename PrefixTuple, typename Config = config::default_config,
+        std::size_t ChunkSize = 64 * 1024 * 1024, mmap_sync_policy SyncPolicy = mmap_sync_policy::none>
+    struct mmap_file_logger : public logger_base<PrefixTuple, mmap_file_logger<PrefixTuple, Config, ChunkSize, SyncPolicy>, Config> {
+        using base_t = logger_base<PrefixTuple, mmap_file_logger<PrefixTuple, Config, ChunkSize, SyncPolicy>, Config>;
+        friend base_t;
+
+        /*
+         * `max_size` is the address space reserved for the mapping, and so the maximum size of the log.
+         * Records that would go past it are dropped and counted by `dropped()`.
+         * `release_chunks` drops written chunks from the process' mapping (MADV_DONTNEED), the data stays in the page cache.
+         * If the file can't be opened (or the address space reserved), `is_open()` is false and every record is dropped.
+         */
+        mmap_file_logger(std::string_view path, PrefixTuple&& prefix_tuple = {},
+                std::size_t max_size = std::size_t(1) << 40, bool release_chunks = false) :
+            base_t(std::forward<PrefixTuple>(prefix_tuple)),
+            m_fd(::open(path.data(), O_RDWR | O_CREAT | O_TRUNC, 0644)),
+            m_max_size(max_size - max_size % ChunkSize),
+            m_release_chunks(release_chunks)
+        {
+            if (m_fd < 0 || m_max_size == 0) {
+                return;
+            }
+            void *base = ::mmap(nullptr, m_max_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            m_base = (base == MAP_FAILED) ? (nullptr) : (static_cast<std::uint8_t *>(base));
+            if (m_base) {
+                map_chunks(ChunkSize);
+            }
+        }
+        ~mmap_file_logger() {
+            m_staging.detach_all([this](staging_buffer& staging) {
+                copy_staged(staging);
+            });
+            if (m_base) {
+                auto written = std::min<std::uint64_t>(m_tail.load(std::memory_order_acquire), m_max_size);
+                if constexpr(SyncPolicy != mmap_sync_policy::none) {
+                    ::msync(m_base, m_mapped.load(std::memory_order_acquire),
+                        (SyncPolicy == mmap_sync_policy::sync) ? (MS_SYNC) : (MS_ASYNC));
+                }
+                ::munmap(m_base, m_max_size);
+                if (::ftruncate(m_fd, written) != 0) {
+                    // The file keeps its zeroed tail, which still decodes
+                }
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        bool is_open() const {
+            return m_base != nullptr;
+        }
+        // Records dropped because the log reached its maximum size, the file couldn't grow, or isn't open
+        std::uint64_t dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        void line_hint_impl() {
+            auto& staging = m_staging.local(this);
+            if (!staging.data.empty()) {
+                copy_staged(staging);
+            }
+        }
+    protected:
+        struct staging_buffer {
+            explicit staging_buffer(mmap_file_logger *owner) : logger(owner) {}
+
+            // The buffer goes to the next thread
+            void on_thread_exit() {
+                if (!data.empty()) {
+                    logger->copy_staged(*this);
+                }
+            }
+
+            std::vector<std::uint8_t> data;
+            mmap_file_logger *logger;
+        };
+
+        void write_impl(const std::uint8_t *data, const std::size_t len) {
+            auto& staging = m_staging.local(this);
+            staging.data.insert(staging.data.end(), data, data + len);
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            // A partial line is staged, the record must follow it
+            if (!m_staging.local(this).data.empty()) {
+                return nullptr;
+            }
+            // If the log is full, the record goes through the staging buffer and is dropped (and counted) there
+            return place(len);
+        }
+        void commit_impl(const std::size_t len) {
+        }
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            auto dst = place(len);
+            if (!dst) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::memcpy(dst, data, len);
+        }
+
+        void copy_staged(staging_buffer& staging) {
+            auto dst = place(staging.data.size());
+            if (dst) {
+                std::memcpy(dst, staging.data.data(), staging.data.size());
+            } else {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            staging.data.clear();
+        }
+
+        // Claim `len` bytes at the tail of the file, nullptr if the log is full (or the file couldn't grow)
+        std::uint8_t *place(const std::size_t len) {
+            if (!m_base) {
+                return nullptr;
+            }
+            auto offset = m_tail.load(std::memory_order_relaxed);
+            while (true) {
+                auto end = offset + len;
+                if (end > m_max_size) {
+                    return nullptr;
+                }
+                // Map ahead by half a chunk so that writers rarely wait for a chunk to be mapped
+                auto mapped = m_mapped.load(std::memory_order_acquire);
+                if (end + ChunkSize / 2 > mapped && mapped < m_max_size) {
+                    map_chunks(end + ChunkSize / 2);
+                    mapped = m_mapped.load(std::memory_order_acquire);
+                }
+                // Nothing is claimed past the mapping, a failed record leaves no hole for the next ones
+                if (end > mapped) {
+                    return nullptr;
+                }
+                if (m_tail.compare_exchange_weak(offset, end, std::memory_order_relaxed)) {
+                    return m_base + offset;
+                }
+            }
+        }
+
+        void map_chunks(std::uint64_t until) {
+            std::lock_guard<std::mutex> lock(m_map_mutex);
+            auto mapped = m_mapped.load(std::memory_order_relaxed);
+            while (mapped < until && mapped < m_max_size) {
+                if (!allocate(mapped, ChunkSize)) {
+                    break;
+                }
+                void *chunk = ::mmap(m_base + mapped, ChunkSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, mapped);
+                if (chunk == MAP_FAILED) {
+                    break;
+                }
+                ::madvise(chunk, ChunkSize, MADV_SEQUENTIAL);
+                retire_chunk(mapped);
+                mapped += ChunkSize;
+                m_mapped.store(mapped, std::memory_order_release);
+            }
+        }
+        bool allocate(std::uint64_t offset, std::size_t len) {
+#if defined(__linux__)
+            if (::fallocate(m_fd, 0, offset, len) == 0) {
+                return true;
+            }
+#endif
+            // Not supported by the file system, extend the file sparsely
+            return ::ftruncate(m_fd, offset + len) == 0;
+        }
+        // Called when the chunk starting at `new_chunk` is mapped, the one two chunks back is done being written (mostly)
+        void retire_chunk(std::uint64_t new_chunk) {
+            if (new_chunk < 2 * ChunkSize) {
+                return;
+            }
+            auto old_chunk = m_base + new_chunk - 2 * ChunkSize;
+            if constexpr(SyncPolicy == mmap_sync_policy::async) {
+                ::msync(old_chunk, ChunkSize, MS_ASYNC);
+            } else if constexpr(SyncPolicy == mmap_sync_policy::sync) {
+                ::msync(old_chunk, ChunkSize, MS_SYNC);
+            }
+            if (m_release_chunks) {
+                // Safe even if a late writer still has a record there, the page is faulted back in from the page cache
+                ::madvise(old_chunk, ChunkSize, MADV_DONTNEED);
+            }
+        }
+
+        const int m_fd;
+        const std::size_t m_max_size;
+        const bool m_release_chunks;
+        std::uint8_t *m_base = nullptr;
+
+        alignas(64) std::atomic<std::uint64_t> m_tail{0};
+        alignas(64) std::atomic<std::uint64_t> m_mapped{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+        std::mutex m_map_mutex;
+        per_thread::registry<staging_buffer> m_staging;
+    };
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace llcpp {
+    /*
+     * Describes a trivially copyable type logged with "%T": its name and the fields the decoder shows.
+     *  template<> struct llcpp::serializer<order> {
+     *      static constexpr const char *name = "order";
+     *      static constexpr auto fields = std::make_tuple(llcpp::field("id", &order::id), llcpp::field("price", &order::price));
+     *  };
+     * The object itself is copied whole, fields not listed are still written but not shown.
+     */
+    template<typename T, typename = void>
+    struct serializer;
+
+    template<typename Class, typename Member>
+    struct field_description {
+        const char *name;
+        Member Class::*member;
+    };
+    template<typename Class, typename Member>
+    constexpr field_description<Class, Member> field(const char *name, Member Class::*member) {
+        return {name, member};
+    }
+}
+
+namespace llcpp::detail::objects {
+    /*
+     * An object's schema is written once per logger, as a "\x01schema %16s %s %s" meta record: the schema id (16 hex
+     *  digits), the type's name and its fields, "name:kind:offset:size" separated by ','.
+     * Kinds: 'i' signed and 'u' unsigned integers, 'b' bool, 'c' char, 'f' floating point, 's' char array (a string
+     *  up to its first '\0'), 'x' anything else (shown as hex bytes).
+     * The id is a hash of the name and fields, so a type whose layout changed gets a new one.
+     */
+    static constexpr std::size_t schema_id_size = 16;
+
+    template<typename T, typename = void>
+    struct has_serializer : std::false_type {};
+    template<typename T>
+    struct has_serializer<T, std::void_t<decltype(serializer<T>::name), decltype(serializer<T>::fields)>> : std::true_type {};
+
+    template<typename Member>
+    constexpr char field_kind() {
+        if constexpr(std::is_enum_v<Member>) {
+            return field_kind<std::underlying_type_t<Member>>();
+        } else if constexpr(std::is_same_v<Member, bool>) {
+            return 'b';
+        } else if constexpr(std::is_same_v<Member, char>) {
+            return 'c';
+        } else if constexpr(std::is_integral_v<Member> && sizeof(Member) <= sizeof(std::uint64_t)) {
+            return (std::is_signed_v<Member>) ? ('i') : ('u');
+        } else if constexpr(std::is_same_v<Member, float> || std::is_same_v<Member, double>) {
+            return 'f';
+        } else if constexpr(std::is_array_v<Member> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<Member>>, char>) {
+            return 's';
+        } else {
+            return 'x';
+        }
+    }
+
+    struct schema {
+        std::uint64_t id;
+        char hex_id[schema_id_size + 1];
+        std::string name;
+        std::string fields;
+    };
+
+    template<typename T>
+    schema make_schema() {
+        schema result;
+        result.name = serializer<T>::name;
+        // Member offsets, measured on uninitialized storage (T is trivially copyable, nothing is read)
+        alignas(T) static unsigned char storage[sizeof(T)];
+        auto object = reinterpret_cast<const T *>(storage);
+        std::apply([&](auto&&... fields) {
+            ((result.fields += (result.fields.empty() ? "" : ","),
+              result.fields += fields.name,
+              result.fields += ':',
+              result.fields += field_kind<std::remove_cv_t<std::remove_reference_t<decltype(object->*(fields.member))>>>(),
+              result.fields += ':' + std::to_string(reinterpret_cast<const unsigned char *>(&(object->*(fields.member))) - storage),
+              result.fields += ':' + std::to_string(sizeof(object->*(fields.member)))), ...);
+        }, serializer<T>::fields);
+
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        for (auto& part : {result.name, result.fields}) {
+            for (auto ch : part) {
+                hash ^= static_cast<std::uint8_t>(ch);
+                hash *= 0x100000001b3ULL;
+            }
+            hash ^= ' ';
+            hash *= 0x100000001b3ULL;
+        }
+        // 0 marks empty slots in the loggers' sets of written schemas
+        result.id = (hash == 0) ? (1) : (hash);
+        static constexpr char digits[] = "0123456789abcdef";
+        for (std::size_t i = 0; i < schema_id_size; i++) {
+            result.hex_id[i] = digits[(result.id >> (60 - 4 * i)) & 0xf];
+        }
+        result.hex_id[schema_id_size] = '\0';
+        return result;
+    }
+
+    // Built on first use
+    template<typename T>
+    const schema& schema_of() {
+        static const schema s_schema = make_schema<T>();
+        return s_schema;
+    }
+}
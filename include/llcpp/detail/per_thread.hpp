@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace llcpp::detail::per_thread {
+    /*
+     * Unique, never reused, identifier of a registry instance.
+     * Thread local lookups are keyed on it so a registry that reuses a dead one's address is never confused with it.
+     */
+    inline std::uint64_t next_registry_id() {
+        static std::atomic<std::uint64_t> s_next_id{1};
+        return s_next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Something to do when the thread that registered it exits, see `on_thread_exit`
+    struct exit_hook {
+        virtual ~exit_hook() = default;
+        virtual void on_thread_exit() = 0;
+    };
+
+    struct exit_hooks {
+        ~exit_hooks() {
+            for (auto& hook : hooks) {
+                hook->on_thread_exit();
+            }
+        }
+        std::vector<std::shared_ptr<exit_hook>> hooks;
+    };
+
+    /*
+     * Run `hook->on_thread_exit()` on the calling thread when it exits (when its thread locals are destroyed).
+     * The hook is shared with whoever registered it. Hooks nobody else holds anymore are dropped as new ones come in,
+     *  so a long lived thread doesn't accumulate the hooks of dead objects.
+     */
+    inline void on_thread_exit(std::shared_ptr<exit_hook> hook) {
+        thread_local exit_hooks t_hooks;
+        auto& hooks = t_hooks.hooks;
+        for (std::size_t i = 0; i < hooks.size();) {
+            if (hooks[i].use_count() == 1) {
+                hooks[i] = std::move(hooks.back());
+                hooks.pop_back();
+            } else {
+                i++;
+            }
+        }
+        hooks.push_back(std::move(hook));
+    }
+
+    // The calling thread's (registry id, entry) pairs, shared by all registries since ids are unique
+    inline std::vector<std::pair<std::uint64_t, void *>>& thread_entries() {
+        thread_local std::vector<std::pair<std::uint64_t, void *>> t_entries;
+        return t_entries;
+    }
+
+    template<typename T, typename = void>
+    struct has_exit_handler : std::false_type {};
+    template<typename T>
+    struct has_exit_handler<T, std::void_t<decltype(std::declval<T&>().on_thread_exit())>> : std::true_type {};
+
+    /*
+     * Holds one T per (registry, live thread) pair.
+     * - `local()` returns the calling thread's T, creating and registering it on first use.
+     *   The fast path is a single thread local comparison.
+     * - Registration is a lock-free push, so `for_each` may run concurrently from any thread.
+     * - Every T is owned by the registry. When its thread exits, T's `on_thread_exit()` runs (if it has one) on that
+     *   thread and the entry is handed as is to the next thread that registers, so the registry is as big as the
+     *   most threads ever alive at once, not as every thread that ever logged.
+     * - `detach_all` is for the owner's destructor: it runs on the entries still in use, and stops their threads'
+     *   exits from touching them.
+     */
+    template<typename T>
+    struct registry {
+        registry() : m_id(next_registry_id()), m_head(nullptr) {}
+        registry(const registry&) = delete;
+        registry& operator=(const registry&) = delete;
+        ~registry() {
+            detach_all([](T&) {});
+            auto cur = m_head.load(std::memory_order_acquire);
+            while (cur) {
+                auto next = cur->next;
+                delete cur;
+                cur = next;
+            }
+        }
+
+        template<typename... Args>
+        T& local(Args&&... args) {
+            auto& last = last_lookup();
+            if (last.id == m_id) {
+                return *static_cast<T*>(last.value);
+            }
+            return local_slow(last, std::forward<Args>(args)...);
+        }
+
+        template<typename F>
+        void for_each(F&& f) {
+            for (auto cur = m_head.load(std::memory_order_acquire); cur; cur = cur->next) {
+                f(cur->value);
+            }
+        }
+        template<typename F>
+        void detach_all(F&& f) {
+            for (auto cur = m_head.load(std::memory_order_acquire); cur; cur = cur->next) {
+                if (cur->hook) {
+                    cur->hook->detach(f);
+                }
+            }
+        }
+
+    private:
+        struct node;
+        // Returns its node to the registry when the thread that claimed it exits
+        struct node_hook : public exit_hook {
+            node_hook(std::uint64_t registry_id, node *owner) : id(registry_id), entry(owner) {}
+
+            void on_thread_exit() override {
+                // Runs on the exiting thread, its lookups must not find the entry once another thread has it
+                auto& last = last_lookup();
+                if (last.id == id) {
+                    last = {0, nullptr};
+                }
+                auto& entries = thread_entries();
+                for (std::size_t i = 0; i < entries.size(); i++) {
+                    if (entries[i].first == id) {
+                        entries[i] = entries.back();
+                        entries.pop_back();
+                        break;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (entry) {
+                    if constexpr(has_exit_handler<T>::value) {
+                        entry->value.on_thread_exit();
+                    }
+                    entry->in_use.store(false, std::memory_order_release);
+                    entry = nullptr;
+                }
+            }
+            template<typename F>
+            void detach(F& f) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (entry) {
+                    f(entry->value);
+                    entry = nullptr;
+                }
+            }
+
+            const std::uint64_t id;
+            std::mutex mutex;
+            node *entry;
+        };
+        struct node {
+            template<typename... Args>
+            node(Args&&... args) : value(std::forward<Args>(args)...), next(nullptr) {}
+            T value;
+            node *next;
+            std::atomic<bool> in_use{true};
+            // The hook of the thread that has the node, shared with that thread's exit hooks
+            std::shared_ptr<node_hook> hook;
+        };
+        // Trivial, so that the fast path's thread local needs no initialization guard
+        struct last_lookup_t {
+            std::uint64_t id;
+            void *value;
+        };
+
+        static last_lookup_t& last_lookup() {
+            thread_local last_lookup_t t_last = {0, nullptr};
+            return t_last;
+        }
+
+        template<typename... Args>
+        __attribute__((noinline)) T& local_slow(last_lookup_t& last, Args&&... args) {
+            auto& entries = thread_entries();
+            void *found = nullptr;
+            for (auto& entry : entries) {
+                if (entry.first == m_id) {
+                    found = entry.second;
+                    break;
+                }
+            }
+            if (!found) {
+                auto n = claim_free_node();
+                if (!n) {
+                    n = new node(std::forward<Args>(args)...);
+                    n->next = m_head.load(std::memory_order_relaxed);
+                    while (!m_head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+                }
+                n->hook = std::make_shared<node_hook>(m_id, n);
+                on_thread_exit(n->hook);
+                found = &n->value;
+                entries.emplace_back(m_id, found);
+            }
+            last.id = m_id;
+            last.value = found;
+            return *static_cast<T*>(found);
+        }
+
+        // A node left by a thread that exited
+        node *claim_free_node() {
+            for (auto cur = m_head.load(std::memory_order_acquire); cur; cur = cur->next) {
+                bool in_use = false;
+                if (!cur->in_use.load(std::memory_order_relaxed) &&
+                        cur->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return cur;
+                }
+            }
+            return nullptr;
+        }
+
+        const std::uint64_t m_id;
+        std::atomic<node*> m_head;
+    };
+}
\ No newline at end of file
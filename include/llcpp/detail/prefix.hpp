@@ -1,13 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <array>
+#include <ctime>
+#include <thread>
 
 #include "udl.hpp"
 #include "logging.hpp"
+#include "clock.hpp"
 
 namespace llcpp::detail::prefix {
 
+    /*
+     * Prefixes either:
+     * - Declare `log_line_t`, the type of their _log format, and implement `arguments` which returns a tuple of
+     *    the format's arguments. The logger fuses these with the line's format into a single record.
+     * - Or implement `apply` which writes records of their own.
+     */
     struct prefix_base {
         virtual ~prefix_base() {}
 
@@ -17,24 +28,31 @@ namespace llcpp::detail::prefix {
 
     template<bool UseLocalTime = true>
     struct time_format_prefix : public prefix_base {
-        std::tm localtime()
+        // The broken down time is only recomputed (per thread) when the second changes
+        const std::tm& localtime()
         {
             //TODO check errors
+            thread_local std::time_t cached_t = -1;
+            thread_local std::tm tm;
             std::time_t now_t = std::time(nullptr);
-            std::tm tm;
-            if constexpr (UseLocalTime) {
-                localtime_r(&now_t, &tm);
-            } else {
-                gmtime_r(&now_t, &tm);
+            if (now_t != cached_t) {
+                if constexpr (UseLocalTime) {
+                    localtime_r(&now_t, &tm);
+                } else {
+                    gmtime_r(&now_t, &tm);
+                }
+                cached_t = now_t;
             }
             
             return tm;
         }
 
+        using log_line_t = decltype("[%d-%3s-%d %d:%d:%d]: "_log);
+
         template<typename Logger>
-        void apply(typename logging::level::level_enum level, Logger& logger) {
-            auto lt = localtime();
-            "[%d-%3s-%d %d:%d:%d]: "_log(logger, lt.tm_year + 1900, m_month_strings[lt.tm_mon], lt.tm_mday, lt.tm_hour, lt.tm_min, lt.tm_sec);
+        auto arguments(typename logging::level::level_enum level, Logger& logger) {
+            const auto& lt = localtime();
+            return std::make_tuple(lt.tm_year + 1900, m_month_strings[lt.tm_mon], lt.tm_mday, lt.tm_hour, lt.tm_min, lt.tm_sec);
         }
 
         static constexpr std::array<const char *, 12> m_month_strings = {
@@ -43,27 +61,82 @@ namespace llcpp::detail::prefix {
         };
     };
     struct nanosec_time_prefix : public prefix_base {
+        using log_line_t = decltype("[%t]: "_log);
+
         template<typename Logger>
-        void apply(typename logging::level::level_enum level, Logger& logger) {
+        auto arguments(typename logging::level::level_enum level, Logger& logger) {
             auto now = std::chrono::system_clock::now();
             auto now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
-            "[%llu]: "_log(logger, now_ns);
+            return std::make_tuple(now_ns);
+        }
+    };
+    /*
+     * Wall clock nanoseconds from CLOCK_REALTIME_COARSE: Cheap, but with the resolution of the kernel's tick.
+     */
+    struct coarse_time_prefix : public prefix_base {
+        using log_line_t = decltype("[%t]: "_log);
+
+        template<typename Logger>
+        auto arguments(typename logging::level::level_enum level, Logger& logger) {
+            return std::make_tuple(clock::coarse_realtime_ns());
+        }
+    };
+    /*
+     * Only writes the raw cycle counter.
+     * A tsc_calibration meta record (cycles, wall clock nanoseconds and cycles per second) is written before the first
+     *  line and then every `calibration_interval`, which lets the parser convert cycles to wall time.
+     */
+    struct tsc_time_prefix : public prefix_base {
+        using log_line_t = decltype("[%#t]: "_log);
+
+        tsc_time_prefix(std::chrono::milliseconds calibration_interval = std::chrono::seconds(1)) :
+            m_calibration_interval(calibration_interval)
+        {
+            clock::reference_anchor();
+        }
+        tsc_time_prefix(tsc_time_prefix&& other) : m_calibration_interval(other.m_calibration_interval) {}
+
+        template<typename Logger>
+        auto arguments(typename logging::level::level_enum level, Logger& logger) {
+            auto now = clock::cycles();
+            if (now >= m_next_calibration.load(std::memory_order_relaxed)) {
+                calibrate(logger, now);
+            }
+            return std::make_tuple(now);
         }
+
+    private:
+        template<typename Logger>
+        void calibrate(Logger& logger, std::uint64_t now) {
+            if (m_calibrating.exchange(true, std::memory_order_acquire)) {
+                // Records must not precede the first calibration, wait for it. Later ones are skipped.
+                while (m_next_calibration.load(std::memory_order_acquire) == 0) {
+                    std::this_thread::yield();
+                }
+                return;
+            }
+            if (now >= m_next_calibration.load(std::memory_order_relaxed)) {
+                auto anchor = clock::cycles_anchor::now();
+                auto frequency = clock::cycles_frequency(clock::reference_anchor(), anchor);
+                logger.write_meta_record("\x01tsc_calibration %llu %llu %llu"_log, anchor.cycles, anchor.realtime_ns, frequency);
+                auto interval_cycles = static_cast<std::uint64_t>(
+                    static_cast<long double>(frequency) * m_calibration_interval.count() / 1000);
+                m_next_calibration.store(anchor.cycles + std::max<std::uint64_t>(interval_cycles, 1), std::memory_order_release);
+            }
+            m_calibrating.store(false, std::memory_order_release);
+        }
+
+        const std::chrono::milliseconds m_calibration_interval;
+        std::atomic<std::uint64_t> m_next_calibration{0};
+        std::atomic<bool> m_calibrating{false};
     };
     struct log_level_prefix : public prefix_base {
+        // A single byte, the parser shows the level's name
+        using log_line_t = decltype("[%v]"_log);
 
         template<typename Logger>        
-        void apply(typename logging::level::level_enum level, Logger& logger) {
-            "[%8s]"_log(logger, m_level_strings[level]);
+        auto arguments(typename logging::level::level_enum level, Logger& logger) {
+            return std::make_tuple(level);
         }
-
-        static constexpr std::array<const char *, 6> m_level_strings = {
-            "TRACE",
-            "DEBUG",
-            "INFO",
-            "WARN",
-            "ERR",
-            "CRITICAL"
-        };
     };
 }
\ No newline at end of file
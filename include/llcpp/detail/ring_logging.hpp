@@ -0,0 +1,215 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logging.hpp"
+#include "file_writer.hpp"
+#include "spsc_ring.hpp"
+
+namespace llcpp::detail::logging {
+    /*
+     * A flight recorder: lines are written to a fixed size, preallocated ring in memory, overwriting the oldest whole
+     *  lines once it's full, and nothing is written anywhere until `dump` is called (i.e. on an error, or from a fatal
+     *  signal's handler). Logging at trace level all the time then costs no I/O and bounded memory.
+     * Threads take turns on the ring: a line holds the ring's lock from its first record to its end.
+     * Meta records are kept aside and written at the start of every dump: all the format dictionary entries, and the
+     *  latest meta record of each format (i.e. tsc_calibration).
+     * A dump is a plain (unframed) log, decoded like any other log written with the same config.
+     */
+    template<typename PrefixTuple, typename Config = config::default_config>
+    struct ring_logger : public logger_base<PrefixTuple, ring_logger<PrefixTuple, Config>, Config> {
+        using base_t = logger_base<PrefixTuple, ring_logger<PrefixTuple, Config>, Config>;
+        friend base_t;
+        static_assert(!Config::use_framing, "ring_logger dumps plain logs, framing isn't supported");
+
+        /*
+         * `capacity` (in bytes) is rounded up to a power of 2. With `huge_pages` the ring is backed by huge pages
+         *  (see spsc_ring::ring_memory), it's prefaulted either way.
+         * `meta_capacity` bounds the format dictionary entries kept for dumps, entries past it are lost.
+         */
+        explicit ring_logger(std::size_t capacity, PrefixTuple&& prefix_tuple = {}, bool huge_pages = false,
+                std::size_t meta_capacity = 64 * 1024) :
+            base_t(std::forward<PrefixTuple>(prefix_tuple)),
+            m_ring(ring_capacity(capacity), huge_pages),
+            m_dictionary(new std::uint8_t[meta_capacity]),
+            m_dictionary_capacity(meta_capacity)
+        {
+        }
+
+        // Lines overwritten, or too big for the ring
+        std::uint64_t dropped() const {
+            return m_ring.dropped();
+        }
+
+        /*
+         * Write the meta records and the lines in the ring, oldest first, to `fd`. The ring isn't consumed.
+         * Async signal safe: it doesn't allocate, and only waits a bounded time for the line in progress (if any)
+         *  to end. If that line's thread doesn't release the ring in time (i.e. it's the one the signal interrupted,
+         *  or it was preempted), the lines are written anyway.
+         */
+        bool dump(int fd) {
+            bool ring_locked = held_ring() != this && try_lock(m_locked);
+            bool meta_locked = try_lock(m_meta_locked);
+            dump_writer out(fd);
+            out.write(m_dictionary.get(), m_dictionary_size.load(std::memory_order_acquire));
+            for (auto& slot : m_latest_meta) {
+                out.write(slot.data, slot.len);
+            }
+            m_ring.peek(m_ring.committed(), [&out](const std::uint8_t *data, std::size_t len) {
+                out.write(data, len);
+            });
+            out.flush();
+            if (meta_locked) {
+                m_meta_locked.store(false, std::memory_order_release);
+            }
+            if (ring_locked) {
+                m_locked.store(false, std::memory_order_release);
+            }
+            return out.ok;
+        }
+        bool dump(std::string_view path) {
+            int fd = ::open(path.data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            bool ok = dump(fd);
+            return (::close(fd) == 0) && ok;
+        }
+
+        void line_hint_impl() {
+            auto& held = held_ring();
+            if (held == this) {
+                m_ring.commit();
+                held = nullptr;
+                m_locked.store(false, std::memory_order_release);
+            }
+        }
+    protected:
+        using ring_t = spsc_ring::record_ring<spsc_ring::full_ring_policy::overwrite>;
+        static constexpr std::size_t meta_slot_count = 8;
+        // Meta records are serialized into a record_buffer, which bounds their size
+        static constexpr std::size_t meta_record_capacity = 256;
+
+        struct meta_slot {
+            std::size_t format_len = 0;
+            std::size_t len = 0;
+            std::uint8_t data[meta_record_capacity];
+        };
+        // Copies into a stack buffer and writes it in chunks, instead of a write per record
+        struct dump_writer {
+            explicit dump_writer(int out_fd) : fd(out_fd) {}
+
+            const int fd;
+            bool ok = true;
+            std::size_t size = 0;
+            std::uint8_t chunk[4096];
+
+            void write(const std::uint8_t *data, std::size_t len) {
+                if (len >= sizeof(chunk)) {
+                    flush();
+                    ok = file_writer::write_all(fd, data, len) && ok;
+                    return;
+                }
+                if (size + len > sizeof(chunk)) {
+                    flush();
+                }
+                std::memcpy(chunk + size, data, len);
+                size += len;
+            }
+            void flush() {
+                ok = file_writer::write_all(fd, chunk, size) && ok;
+                size = 0;
+            }
+        };
+
+        static std::size_t ring_capacity(std::size_t capacity) {
+            std::size_t pow2 = 4096;
+            while (pow2 < capacity) {
+                pow2 <<= 1;
+            }
+            return pow2;
+        }
+        // The ring whose lock this thread holds, for the line it's writing
+        static ring_logger*& held_ring() {
+            thread_local ring_logger *t_held = nullptr;
+            return t_held;
+        }
+        ring_t& line_ring() {
+            auto& held = held_ring();
+            if (held != this) {
+                lock_ring(held);
+            }
+            return m_ring;
+        }
+        __attribute__((noinline)) void lock_ring(ring_logger*& held) {
+            for (std::size_t i = 1; m_locked.load(std::memory_order_relaxed) || m_locked.exchange(true, std::memory_order_acquire); i++) {
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            held = this;
+        }
+        // A bounded wait, for dumps
+        static bool try_lock(std::atomic<bool>& locked) {
+            for (std::size_t i = 1; i <= 64 * 1024; i++) {
+                if (!locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire)) {
+                    return true;
+                }
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            return false;
+        }
+
+        void write_impl(const std::uint8_t *data, const std::size_t len) {
+            line_ring().write(data, len);
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            return line_ring().reserve(len);
+        }
+        void commit_impl(const std::size_t len) {
+            m_ring.advance(len);
+        }
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            auto format = meta_record_format<Config>(data, len);
+            while (m_meta_locked.exchange(true, std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            if (format.empty()) {
+                auto size = m_dictionary_size.load(std::memory_order_relaxed);
+                if (size + len <= m_dictionary_capacity) {
+                    std::memcpy(m_dictionary.get() + size, data, len);
+                    m_dictionary_size.store(size + len, std::memory_order_release);
+                }
+            } else if (len <= meta_record_capacity) {
+                for (auto& slot : m_latest_meta) {
+                    if (slot.len == 0 || std::string_view(reinterpret_cast<const char *>(slot.data), slot.format_len) == format) {
+                        slot.format_len = format.size();
+                        slot.len = len;
+                        std::memcpy(slot.data, data, len);
+                        break;
+                    }
+                }
+            }
+            m_meta_locked.store(false, std::memory_order_release);
+        }
+
+        ring_t m_ring;
+        alignas(64) std::atomic<bool> m_locked{false};
+        alignas(64) std::atomic<bool> m_meta_locked{false};
+        std::unique_ptr<std::uint8_t[]> m_dictionary;
+        const std::size_t m_dictionary_capacity;
+        std::atomic<std::size_t> m_dictionary_size{0};
+        std::array<meta_slot, meta_slot_count> m_latest_meta;
+    };
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+
+namespace llcpp::detail::rotation {
+    /*
+     * When `file_logger` moves on to the next file. Either limit may be 0 (none).
+     * Files are `path`, then `path.1`, `path.2`, etc.
+     */
+    struct policy {
+        // Rotate once the file holds at least this many bytes
+        std::uint64_t max_size = 0;
+        // Rotate on each multiple of `interval` since the epoch (i.e. on the hour for 1 hour)
+        std::chrono::nanoseconds interval{0};
+        // Disk space reserved for each file when it's opened, `max_size` by default
+        std::uint64_t preallocate = 0;
+
+        bool enabled() const {
+            return max_size > 0 || interval.count() > 0;
+        }
+        std::uint64_t next_rotation(std::uint64_t now_ns) const {
+            if (interval.count() <= 0) {
+                return ~0ULL;
+            }
+            auto ns = static_cast<std::uint64_t>(interval.count());
+            return (now_ns / ns + 1) * ns;
+        }
+    };
+
+    inline std::string file_name(std::string_view path, std::size_t idx) {
+        std::string name(path);
+        if (idx > 0) {
+            name += '.';
+            name += std::to_string(idx);
+        }
+        return name;
+    }
+
+    /*
+     * Opens and preallocates the next file ahead of time, and finishes (and closes) the retired ones, on a background
+     *  thread, so that rotating only swaps a pointer on the logging thread.
+     * `Output` is constructed from the (owned) FILE*, and `finish(Output&)` is called on it once it's retired.
+     */
+    template<typename Output>
+    struct file_rotator {
+        using finish_t = std::function<void(Output&)>;
+
+        file_rotator(std::string_view path, const policy& p, finish_t finish) : m_path(path), m_policy(p),
+            m_finish(std::move(finish)), m_worker([this] { worker_loop(); })
+        {
+        }
+        file_rotator(const file_rotator&) = delete;
+        file_rotator& operator=(const file_rotator&) = delete;
+        // Finishes the retired files, and deletes the prepared one which was never used
+        ~file_rotator() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            m_worker.join();
+            if (m_next) {
+                m_next.reset();
+                std::remove(file_name(m_path, m_next_idx).c_str());
+            }
+        }
+
+        const policy& rotation_policy() const {
+            return m_policy;
+        }
+        // Preallocate the file that's written first (the logger opens it), this one on the calling thread
+        void preallocate(std::FILE *fp) const {
+            reserve_space(fp);
+        }
+        // The prepared next file (waits for it if it's not ready yet), nullptr if it couldn't be opened
+        std::unique_ptr<Output> next() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_prepared; });
+            m_prepared = false;
+            auto next = std::move(m_next);
+            if (next) {
+                m_next_idx++;
+            }
+            lock.unlock();
+            m_cv.notify_all();
+            return next;
+        }
+        void retire(std::unique_ptr<Output> output) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_retired.push_back(std::move(output));
+            }
+            m_cv.notify_all();
+        }
+
+    private:
+        void worker_loop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+                m_cv.wait(lock, [this] { return m_stop || !m_prepared || !m_retired.empty(); });
+                while (!m_retired.empty()) {
+                    auto output = std::move(m_retired.front());
+                    m_retired.pop_front();
+                    lock.unlock();
+                    m_finish(*output);
+                    output.reset();
+                    lock.lock();
+                }
+                if (m_stop) {
+                    return;
+                }
+                if (!m_prepared) {
+                    auto name = file_name(m_path, m_next_idx);
+                    lock.unlock();
+                    std::unique_ptr<Output> output;
+                    if (auto fp = std::fopen(name.c_str(), "w")) {
+                        reserve_space(fp);
+                        output = std::make_unique<Output>(fp);
+                    }
+                    lock.lock();
+                    m_next = std::move(output);
+                    m_prepared = true;
+                    m_cv.notify_all();
+                }
+            }
+        }
+        // Allocate the file's blocks without changing its size, best effort
+        void reserve_space(std::FILE *fp) const {
+#if defined(__linux__)
+            auto len = (m_policy.preallocate > 0) ? (m_policy.preallocate) : (m_policy.max_size);
+            if (fp && len > 0) {
+                ::fallocate(fileno(fp), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(len));
+            }
+#endif
+        }
+
+        const std::string m_path;
+        const policy m_policy;
+        const finish_t m_finish;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_stop = false;
+        bool m_prepared = false;
+        std::size_t m_next_idx = 1;
+        std::unique_ptr<Output> m_next;
+        std::deque<std::unique_ptr<Output>> m_retired;
+        // Last, it uses everything above
+        std::thread m_worker;
+    };
+}
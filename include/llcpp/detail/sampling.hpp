@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "clock.hpp"
+#include "log_line.hpp"
+#include "udl.hpp"
+
+namespace llcpp::detail::sampling {
+    /*
+     * Sampling policies, see `logger_base::log_sampled`. `admit` decides whether a call is logged, and if so sets
+     *  `suppressed` to the number of calls skipped since the previous logged one.
+     * Skipped calls only touch the policy's atomics, nothing is serialized.
+     */
+
+    // The 1st, N+1th, 2N+1th... calls
+    template<std::size_t N>
+    struct every_n {
+        static_assert(N > 0, "N must be positive");
+
+        bool admit(std::uint64_t& suppressed) {
+            auto call = m_calls.fetch_add(1, std::memory_order_relaxed);
+            if (call % N != 0) {
+                return false;
+            }
+            suppressed = (call == 0) ? (0) : (N - 1);
+            return true;
+        }
+
+        std::atomic<std::uint64_t> m_calls{0};
+    };
+
+    // The first N calls, once these are logged the rest cost a relaxed load
+    template<std::size_t N>
+    struct first_n {
+        bool admit(std::uint64_t& suppressed) {
+            if (m_calls.load(std::memory_order_relaxed) >= N) {
+                return false;
+            }
+            suppressed = 0;
+            return m_calls.fetch_add(1, std::memory_order_relaxed) < N;
+        }
+
+        std::atomic<std::uint64_t> m_calls{0};
+    };
+
+    /*
+     * A token bucket of `Lines` tokens, refilled at `Lines` per `IntervalMs`: bursts of up to `Lines` calls, and
+     *  `Lines` per interval on average. Implemented as GCRA, the bucket is the single timestamp the next call is
+     *  "expected" at, advanced with a CAS. Time is read from the coarse monotonic clock (a few ms of resolution).
+     */
+    template<std::size_t Lines, std::size_t IntervalMs>
+    struct per_interval {
+        static_assert(Lines > 0 && IntervalMs > 0, "Lines and IntervalMs must be positive");
+        static constexpr std::uint64_t interval_ns = IntervalMs * 1000000ULL;
+        static constexpr std::uint64_t emission_ns = interval_ns / Lines;
+
+        bool admit(std::uint64_t& suppressed) {
+            auto now = clock::coarse_monotonic_ns();
+            auto expected = m_expected.load(std::memory_order_relaxed);
+            for (;;) {
+                auto next = std::max(expected, now) + emission_ns;
+                if (next > now + interval_ns) {
+                    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (m_expected.compare_exchange_weak(expected, next, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        std::atomic<std::uint64_t> m_expected{0};
+        std::atomic<std::uint64_t> m_suppressed{0};
+    };
+
+    /*
+     * A policy's state for each _log literal (its log_line type), shared by every call site and logger using it.
+     * Constant initialized, so reaching it needs no guard.
+     */
+    template<typename LogLine, typename Policy>
+    inline Policy site_state{};
+
+    // The line logged after suppressed ones: "[<count> suppressed] " followed by the line's format
+    template<typename LogLine>
+    using with_suppressed_count = typename log_line::prepend_log_line<decltype("[%llu suppressed] "_log), LogLine>::type;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+#include "logging.hpp"
+#include "framing.hpp"
+#include "shm_transport.hpp"
+#include "spsc_ring.hpp"
+
+namespace llcpp::detail::logging {
+    /*
+     * Writes to the shared memory region of a collector (see shm_transport.hpp), which merges the lines of many
+     *  processes into a single log, each line tagged with its process's pid. The collector must be running first.
+     * The process gets a ring of its own in the region, which its threads take turns on: a line holds the ring's
+     *  lock from its first record to its end, like ring_logger. When the ring is full, the `Policy` decides whether
+     *  the call site waits for the collector (block) or drops the line (drop).
+     * Meta records go through a second ring, so they're collected before the lines that depend on them. They're
+     *  never dropped whatever the `Policy`: a dictionary entry is written once, the lines that depend on it couldn't
+     *  be decoded without it. Waits end when the collector dies, nothing is collected from then on.
+     * Create the logger in the process that logs (i.e. after forking), the pid is the one it attached with.
+     */
+    template<typename PrefixTuple, typename Config = config::default_config,
+        spsc_ring::full_ring_policy Policy = spsc_ring::full_ring_policy::drop>
+    struct shm_logger : public logger_base<PrefixTuple, shm_logger<PrefixTuple, Config, Policy>, Config> {
+        using base_t = logger_base<PrefixTuple, shm_logger<PrefixTuple, Config, Policy>, Config>;
+        friend base_t;
+        static_assert(!Config::use_compact_encoding,
+            "The collector interleaves the lines of many threads, compact timestamps need a single writer's base");
+
+        explicit shm_logger(std::string_view name, PrefixTuple&& prefix_tuple = {}) :
+            base_t(std::forward<PrefixTuple>(prefix_tuple)),
+            m_region(name)
+        {
+            if (!m_region.is_open()) {
+                return;
+            }
+            auto header = framing::make_file_header<Config>(0);
+            m_producer = m_region.attach(header.data(), header.size());
+            if (m_producer) {
+                auto collector_pid = m_region.header()->collector_pid;
+                m_meta.emplace(&m_producer->meta, shm_transport::region::meta_data(m_producer), shm_transport::meta_ring_size,
+                    collector_pid);
+                m_ring.emplace(&m_producer->data, shm_transport::region::ring_data(m_producer), m_region.header()->ring_size,
+                    collector_pid);
+            }
+        }
+        ~shm_logger() {
+            if (m_producer) {
+                shm_transport::region::detach(m_producer);
+            }
+        }
+
+        // Attached to a collector's region, otherwise every line is dropped
+        bool is_open() const {
+            return m_producer != nullptr;
+        }
+        // Lines dropped because the ring was full, or because the logger isn't attached
+        std::uint64_t dropped() const {
+            auto total = m_unattached_drops.load(std::memory_order_relaxed);
+            if (m_producer) {
+                total += m_meta->dropped() + m_ring->dropped();
+            }
+            return total;
+        }
+
+        void line_hint_impl() {
+            auto& held = held_ring();
+            if (held == this) {
+                m_ring->commit();
+                held = nullptr;
+                m_locked.store(false, std::memory_order_release);
+            } else if (!m_producer) {
+                m_unattached_drops.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    protected:
+        using ring_t = shm_transport::ring_writer<Policy>;
+        using meta_ring_t = shm_transport::ring_writer<spsc_ring::full_ring_policy::block>;
+
+        // The logger whose ring this thread holds, for the line it's writing
+        static shm_logger*& held_ring() {
+            thread_local shm_logger *t_held = nullptr;
+            return t_held;
+        }
+        ring_t *line_ring() {
+            if (!m_producer) {
+                return nullptr;
+            }
+            auto& held = held_ring();
+            if (held != this) {
+                lock_ring(held);
+            }
+            return &*m_ring;
+        }
+        __attribute__((noinline)) void lock_ring(shm_logger*& held) {
+            for (std::size_t i = 1; m_locked.load(std::memory_order_relaxed) || m_locked.exchange(true, std::memory_order_acquire); i++) {
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            held = this;
+        }
+
+        void write_impl(const std::uint8_t *data, const std::size_t len) {
+            if (auto ring = line_ring()) {
+                ring->write(data, len);
+            }
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            auto ring = line_ring();
+            return (ring) ? (ring->reserve(len)) : (nullptr);
+        }
+        void commit_impl(const std::size_t len) {
+            m_ring->advance(len);
+        }
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            if (!m_producer) {
+                m_unattached_drops.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_meta_mutex);
+            m_meta->write(data, len);
+            m_meta->commit();
+        }
+
+        shm_transport::region m_region;
+        shm_transport::producer_header *m_producer = nullptr;
+        std::optional<ring_t> m_ring;
+        alignas(64) std::atomic<bool> m_locked{false};
+        std::mutex m_meta_mutex;
+        std::optional<meta_ring_t> m_meta;
+        std::atomic<std::uint64_t> m_unattached_drops{0};
+    };
+}
@@ -0,0 +1,634 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "udl.hpp"
+#include "clock.hpp"
+#include "framing.hpp"
+#include "format_dictionary.hpp"
+#include "logging.hpp"
+#include "spsc_ring.hpp"
+
+namespace llcpp::detail::shm_transport {
+    /*
+     * Many processes logging to a single file through shared memory: each process's `shm_logger` attaches to a
+     *  region created by the collector (`llcpp_collect`, see `collector`), and writes its records to a ring pair of
+     *  its own in the region, without a syscall or a lock shared with other processes.
+     *  [region_header][producer_header][meta ring][data ring]...
+     * Each ring entry is an entry_header followed by a line's records (or a meta record, in the meta ring).
+     * The collector drains every ring, merges the lines by timestamp, puts the producer's pid before each line
+     *  (a "[%d]" record) and writes them to one framed log.
+     * The collector publishes its terminators, producers must use the same ones (the collector writes the pid
+     *  records with them). The first producer to attach publishes its file header (i.e. its format dictionary
+     *  setting), later producers must match it.
+     */
+    inline constexpr std::array<char, 8> region_magic = {{'L', 'L', 'C', 'P', 'P', 'S', 'H', 'M'}};
+    constexpr std::uint32_t region_version = 1;
+    constexpr std::size_t max_format_size = 256;
+    constexpr std::size_t max_terminator_count = max_format_size - sizeof(framing::file_header);
+    constexpr std::size_t meta_ring_size = 64 * 1024;
+
+    enum format_state : std::uint32_t {
+        no_format = 0,
+        publishing_format = 1,
+        published_format = 2,
+    };
+    enum producer_state : std::uint32_t {
+        free_producer = 0,
+        attaching_producer = 1,
+        attached_producer = 2,
+        // The producer is gone, the collector frees the slot once its rings are drained
+        detached_producer = 3,
+    };
+
+    struct alignas(64) region_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t producer_count;
+        // Data ring bytes per producer, a power of 2
+        std::uint64_t ring_size;
+        // Producers waiting for room stop once it's gone
+        std::int64_t collector_pid;
+        std::uint32_t terminator_count;
+        char terminators[max_terminator_count];
+        std::atomic<std::uint32_t> format_state;
+        std::uint32_t format_size;
+        // The log's file header, see framing::make_file_header
+        std::uint8_t format[max_format_size];
+    };
+    // Positions are monotonic, the index into the ring is `position & (size - 1)`
+    struct ring_header {
+        // Written by the producer
+        alignas(64) std::atomic<std::uint64_t> head;
+        // Written by the collector
+        alignas(64) std::atomic<std::uint64_t> tail;
+        std::atomic<std::uint64_t> dropped;
+    };
+    struct alignas(64) producer_header {
+        std::atomic<std::uint32_t> state;
+        std::int64_t pid;
+        ring_header meta;
+        ring_header data;
+    };
+    struct entry_header {
+        std::uint32_t size;
+        std::uint32_t reserved;
+        // Nanoseconds since the epoch, when the entry was started
+        std::uint64_t timestamp;
+    };
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared atomics must be lock free");
+
+    inline constexpr std::size_t producer_size(std::size_t ring_size) {
+        return sizeof(producer_header) + meta_ring_size + ring_size;
+    }
+    inline bool is_alive(std::int64_t pid) {
+        return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+    }
+
+    /*
+     * The mapped region. The collector creates it (removing a previous one by the same name), producers open it.
+     * `name` is a POSIX shared memory name, i.e. "/llcpp".
+     */
+    struct region {
+        // Open an existing region
+        explicit region(std::string_view name) {
+            int fd = ::shm_open(std::string(name).c_str(), O_RDWR, 0);
+            struct stat st;
+            if (fd < 0) {
+                return;
+            }
+            if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(region_header)) {
+                map(fd, st.st_size);
+            }
+            ::close(fd);
+            auto h = header();
+            if (m_base && (std::memcmp(h->magic, region_magic.data(), sizeof(h->magic)) != 0 || h->version != region_version ||
+                    sizeof(region_header) + h->producer_count * producer_size(h->ring_size) > m_size)) {
+                unmap();
+            }
+        }
+        // Create a region for `producer_count` producers, logging with `terminators`
+        region(std::string_view name, std::uint32_t producer_count, std::size_t ring_size, std::string_view terminators) : m_name(name) {
+            ::shm_unlink(m_name.c_str());
+            int fd = (terminators.size() <= max_terminator_count) ? (::shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660)) : (-1);
+            if (fd < 0) {
+                return;
+            }
+            auto size = sizeof(region_header) + producer_count * producer_size(ring_size);
+            if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+                map(fd, size);
+            }
+            ::close(fd);
+            if (!m_base) {
+                ::shm_unlink(m_name.c_str());
+                return;
+            }
+            m_owner = true;
+            auto h = new (m_base) region_header;
+            h->version = region_version;
+            h->producer_count = producer_count;
+            h->ring_size = ring_size;
+            h->collector_pid = ::getpid();
+            h->terminator_count = static_cast<std::uint32_t>(terminators.size());
+            std::memcpy(h->terminators, terminators.data(), terminators.size());
+            h->format_state.store(no_format, std::memory_order_relaxed);
+            h->format_size = 0;
+            for (std::uint32_t i = 0; i < producer_count; i++) {
+                auto p = new (producer(i)) producer_header;
+                p->state.store(free_producer, std::memory_order_relaxed);
+                for (auto ring : {&p->meta, &p->data}) {
+                    ring->head.store(0, std::memory_order_relaxed);
+                    ring->tail.store(0, std::memory_order_relaxed);
+                    ring->dropped.store(0, std::memory_order_relaxed);
+                }
+            }
+            // Last, producers ignore a region without its magic
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(h->magic, region_magic.data(), sizeof(h->magic));
+        }
+        region(const region&) = delete;
+        region& operator=(const region&) = delete;
+        ~region() {
+            unmap();
+            if (m_owner) {
+                ::shm_unlink(m_name.c_str());
+            }
+        }
+
+        bool is_open() const {
+            return m_base != nullptr;
+        }
+        region_header *header() const {
+            return reinterpret_cast<region_header *>(m_base);
+        }
+        producer_header *producer(std::uint32_t i) const {
+            return reinterpret_cast<producer_header *>(m_base + sizeof(region_header) + i * producer_size(header()->ring_size));
+        }
+        static std::uint8_t *meta_data(producer_header *p) {
+            return reinterpret_cast<std::uint8_t *>(p) + sizeof(producer_header);
+        }
+        static std::uint8_t *ring_data(producer_header *p) {
+            return meta_data(p) + meta_ring_size;
+        }
+
+        /*
+         * Producer side: publish (or check) the log's file header, and claim a free slot.
+         * nullptr if the terminators aren't the collector's, the header doesn't match the published one, or every slot is taken.
+         */
+        producer_header *attach(const std::uint8_t *format, std::size_t format_size) {
+            auto h = header();
+            if (format_size > max_format_size || format_size - sizeof(framing::file_header) != h->terminator_count ||
+                    std::memcmp(format + sizeof(framing::file_header), h->terminators, h->terminator_count) != 0) {
+                return nullptr;
+            }
+            std::uint32_t expected = no_format;
+            if (h->format_state.compare_exchange_strong(expected, publishing_format, std::memory_order_acq_rel)) {
+                std::memcpy(h->format, format, format_size);
+                h->format_size = static_cast<std::uint32_t>(format_size);
+                h->format_state.store(published_format, std::memory_order_release);
+            }
+            while (h->format_state.load(std::memory_order_acquire) != published_format) {
+                std::this_thread::yield();
+            }
+            if (h->format_size != format_size || std::memcmp(h->format, format, format_size) != 0) {
+                return nullptr;
+            }
+            for (std::uint32_t i = 0; i < h->producer_count; i++) {
+                auto p = producer(i);
+                std::uint32_t state = free_producer;
+                if (p->state.compare_exchange_strong(state, attaching_producer, std::memory_order_acq_rel)) {
+                    p->pid = ::getpid();
+                    p->state.store(attached_producer, std::memory_order_release);
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+        static void detach(producer_header *p) {
+            p->state.store(detached_producer, std::memory_order_release);
+        }
+
+    private:
+        void map(int fd, std::size_t size) {
+            void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base != MAP_FAILED) {
+                m_base = static_cast<std::uint8_t *>(base);
+                m_size = size;
+            }
+        }
+        void unmap() {
+            if (m_base) {
+                ::munmap(m_base, m_size);
+                m_base = nullptr;
+            }
+        }
+
+        std::string m_name;
+        bool m_owner = false;
+        std::uint8_t *m_base = nullptr;
+        std::size_t m_size = 0;
+    };
+
+    inline void copy_in(std::uint8_t *ring, std::size_t capacity, std::uint64_t pos, const std::uint8_t *data, std::size_t len) {
+        auto idx = pos & (capacity - 1);
+        auto first = std::min(len, capacity - idx);
+        std::memcpy(ring + idx, data, first);
+        std::memcpy(ring, data + first, len - first);
+    }
+    inline void copy_out(const std::uint8_t *ring, std::size_t capacity, std::uint64_t pos, std::uint8_t *data, std::size_t len) {
+        auto idx = pos & (capacity - 1);
+        auto first = std::min(len, capacity - idx);
+        std::memcpy(data, ring + idx, first);
+        std::memcpy(data + first, ring, len - first);
+    }
+
+    /*
+     * The producer's side of a ring: appends an entry with any number of `write`s and publishes it with `commit`,
+     *  like spsc_ring::record_ring. With the block policy a full ring waits for the collector, with drop the entry
+     *  is dropped and counted.
+     * Only the collector frees room, so the wait ends when it's gone (a new collector makes a new region, this one is
+     *  never drained again): from then on entries are dropped.
+     */
+    template<spsc_ring::full_ring_policy Policy>
+    struct ring_writer {
+        static_assert(Policy != spsc_ring::full_ring_policy::overwrite, "The collector owns the ring's tail, entries can't be overwritten");
+
+        ring_writer(ring_header *header, std::uint8_t *data, std::size_t capacity, std::int64_t collector_pid) : m_header(header),
+            m_data(data), m_capacity(capacity), m_collector_pid(collector_pid), m_write(header->head.load(std::memory_order_acquire)),
+            m_entry_start(m_write)
+        {
+        }
+
+        void write(const std::uint8_t *data, const std::size_t len) {
+            if (m_dropping || !begin_entry() || !make_room(len)) {
+                return;
+            }
+            copy_in(m_data, m_capacity, m_write, data, len);
+            m_write += len;
+        }
+        // A contiguous span, nullptr if it would wrap around the ring (use `write` instead)
+        std::uint8_t *reserve(const std::size_t len) {
+            if (m_dropping || !begin_entry()) {
+                return nullptr;
+            }
+            auto idx = m_write & (m_capacity - 1);
+            if (idx + len > m_capacity || !make_room(len)) {
+                return nullptr;
+            }
+            return m_data + idx;
+        }
+        void advance(const std::size_t len) {
+            m_write += len;
+        }
+        void commit() {
+            if (m_dropping) {
+                m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+                m_write = m_entry_start;
+                m_dropping = false;
+                return;
+            }
+            if (m_write == m_entry_start) {
+                return;
+            }
+            entry_header entry{static_cast<std::uint32_t>(m_write - m_entry_start - sizeof(entry_header)), 0, m_timestamp};
+            copy_in(m_data, m_capacity, m_entry_start, reinterpret_cast<const std::uint8_t *>(&entry), sizeof(entry));
+            m_header->head.store(m_write, std::memory_order_release);
+            m_entry_start = m_write;
+        }
+        // Count an entry that was never written
+        void drop() {
+            m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::uint64_t dropped() const {
+            return m_header->dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        bool begin_entry() {
+            if (m_write == m_entry_start) {
+                m_timestamp = clock::realtime_ns();
+                if (!make_room(sizeof(entry_header))) {
+                    return false;
+                }
+                m_write += sizeof(entry_header);
+            }
+            return true;
+        }
+        bool make_room(std::size_t len) {
+            // The entry as a whole must fit in the ring
+            if (m_write + len - m_entry_start > m_capacity) {
+                m_dropping = true;
+                return false;
+            }
+            for (std::size_t i = 1; m_write + len - m_header->tail.load(std::memory_order_acquire) > m_capacity; i++) {
+                if constexpr(Policy == spsc_ring::full_ring_policy::drop) {
+                    m_dropping = true;
+                    return false;
+                } else {
+                    if (m_collector_gone || (i % 1024 == 0 && !is_alive(m_collector_pid))) {
+                        m_collector_gone = true;
+                        m_dropping = true;
+                        return false;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            return true;
+        }
+
+        ring_header *m_header;
+        std::uint8_t *m_data;
+        const std::size_t m_capacity;
+        const std::int64_t m_collector_pid;
+        bool m_collector_gone = false;
+        std::uint64_t m_write;
+        std::uint64_t m_entry_start;
+        std::uint64_t m_timestamp = 0;
+        bool m_dropping = false;
+    };
+
+    /*
+     * Serializes the "[%d]" record the collector puts before each line, per the producers' format dictionary setting.
+     * With the dictionary, its entry is handed to `on_meta` the first time.
+     */
+    template<typename Config>
+    struct tag_encoder : public logging::logger_base<std::tuple<>, tag_encoder<Config>, Config> {
+        using base_t = logging::logger_base<std::tuple<>, tag_encoder<Config>, Config>;
+        friend base_t;
+        using meta_callback_t = std::function<void(const std::uint8_t *, std::size_t)>;
+
+        explicit tag_encoder(meta_callback_t on_meta) : m_on_meta(std::move(on_meta)) {}
+
+        std::vector<std::uint8_t> encode(std::int64_t pid) {
+            logging::record_buffer<base_t> buffer(*this);
+            typename decltype("[%d]"_log)::template log_line_with_config<Config> line;
+            line(buffer, static_cast<int>(pid));
+            return std::vector<std::uint8_t>(buffer.data(), buffer.data() + buffer.size());
+        }
+
+    protected:
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            m_on_meta(data, len);
+        }
+
+        const meta_callback_t m_on_meta;
+    };
+
+    struct collector_options {
+        std::uint32_t producers = 64;
+        // Per producer, rounded up to a power of 2
+        std::size_t ring_size = 1024 * 1024;
+        std::size_t block_size = 64 * 1024;
+    };
+
+    /*
+     * Drains every producer's rings into a framed log. Call `poll` repeatedly (see tools/llcpp_collect.cpp), the log's
+     *  index is written when the collector is destroyed.
+     * `Config` is the producers' (for its terminators, the pid records are written with them). Whether the log uses
+     *  the format dictionary is up to the first producer.
+     * Each poll writes the meta records it found in a meta block (format dictionary entries only once), then the lines,
+     *  merged by timestamp, in data blocks of about `block_size` bytes. Lines are ordered within a poll, across polls
+     *  a line committed late (i.e. by a preempted producer) lands in the next one.
+     * Producers that exit without detaching are noticed by their pid, their committed lines are collected.
+     */
+    template<typename Config = config::default_config>
+    struct collector {
+        using options = collector_options;
+        static_assert(!Config::use_compact_encoding, "shm_logger doesn't support compact encoding");
+
+        collector(std::string_view name, std::string_view path, const options& opts = {}) :
+            m_region(name, opts.producers, ring_capacity(opts.ring_size),
+                std::string_view(framing::terminator_set<Config>.data(), framing::terminator_set<Config>.size())),
+            m_block_size(opts.block_size), m_out(path),
+            m_producers(opts.producers)
+        {
+        }
+        collector(const collector&) = delete;
+        collector& operator=(const collector&) = delete;
+        ~collector() {
+            if (is_open()) {
+                poll();
+                if (m_started) {
+                    m_out.write_index(clock::realtime_ns());
+                }
+            }
+        }
+
+        bool is_open() const {
+            return m_region.is_open() && m_out.is_open();
+        }
+        // Drain every ring once, returns the number of lines written
+        std::size_t poll() {
+            auto h = m_region.header();
+            if (!m_started) {
+                if (h->format_state.load(std::memory_order_acquire) != published_format) {
+                    return 0;
+                }
+                start(h);
+            }
+            m_meta.clear();
+            std::size_t lines = 0;
+            for (std::uint32_t i = 0; i < h->producer_count; i++) {
+                lines += collect(i);
+            }
+            if (!m_meta.empty()) {
+                m_out.write_block(m_meta.data(), m_meta.size(), 0, clock::realtime_ns(), framing::meta_block);
+            }
+            merge();
+            m_out.flush();
+            m_lines += lines;
+            return lines;
+        }
+
+        std::uint64_t lines() const {
+            return m_lines;
+        }
+        // Lines (and meta records) producers dropped because their rings were full
+        std::uint64_t dropped() const {
+            auto total = m_dropped;
+            for (std::uint32_t i = 0; m_region.is_open() && i < m_region.header()->producer_count; i++) {
+                auto p = m_region.producer(i);
+                total += p->meta.dropped.load(std::memory_order_relaxed) + p->data.dropped.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+    private:
+        struct pending {
+            std::int64_t pid = 0;
+            // The "[%d]" record
+            std::vector<std::uint8_t> tag;
+            // This poll's entries
+            std::vector<std::uint8_t> entries;
+            std::size_t pos = 0;
+        };
+
+        static std::size_t ring_capacity(std::size_t size) {
+            std::size_t pow2 = 4096;
+            while (pow2 < size) {
+                pow2 <<= 1;
+            }
+            return pow2;
+        }
+        void start(region_header *h) {
+            framing::file_header header;
+            std::memcpy(&header, h->format, sizeof(header));
+            header.max_block_size = static_cast<std::uint32_t>(m_block_size);
+            m_dictionary = (header.flags & framing::format_dictionary_flag) != 0;
+            std::vector<std::uint8_t> file_header(h->format, h->format + h->format_size);
+            std::memcpy(file_header.data(), &header, sizeof(header));
+            m_out.write(file_header.data(), file_header.size());
+            m_started = true;
+        }
+        std::vector<std::uint8_t> encode_tag(std::int64_t pid) {
+            return (m_dictionary) ? (m_dictionary_tags.encode(pid)) : (m_plain_tags.encode(pid));
+        }
+
+        // Copy a producer's committed entries, and free its slot once it's gone and drained
+        std::size_t collect(std::uint32_t i) {
+            auto p = m_region.producer(i);
+            auto& out = m_producers[i];
+            out.entries.clear();
+            out.pos = 0;
+            auto state = p->state.load(std::memory_order_acquire);
+            if (state != attached_producer && state != detached_producer) {
+                return 0;
+            }
+            bool gone = state == detached_producer || !is_alive(p->pid);
+            if (out.pid != p->pid || out.tag.empty()) {
+                out.pid = p->pid;
+                out.tag = encode_tag(p->pid);
+            }
+            // The data before the meta: a line committed by now was written after the meta records it depends on
+            auto data_head = p->data.head.load(std::memory_order_acquire);
+            auto meta_head = p->meta.head.load(std::memory_order_acquire);
+            drain_meta(p, meta_head);
+            auto tail = p->data.tail.load(std::memory_order_relaxed);
+            out.entries.resize(data_head - tail);
+            copy_out(region::ring_data(p), m_region.header()->ring_size, tail, out.entries.data(), out.entries.size());
+            p->data.tail.store(data_head, std::memory_order_release);
+            std::size_t lines = 0;
+            for (std::size_t pos = 0; pos + sizeof(entry_header) <= out.entries.size(); lines++) {
+                entry_header entry;
+                std::memcpy(&entry, out.entries.data() + pos, sizeof(entry));
+                pos += sizeof(entry) + entry.size;
+            }
+            if (gone) {
+                m_dropped += p->meta.dropped.exchange(0, std::memory_order_relaxed) + p->data.dropped.exchange(0, std::memory_order_relaxed);
+                out.pid = 0;
+                p->state.store(free_producer, std::memory_order_release);
+            }
+            return lines;
+        }
+        void drain_meta(producer_header *p, std::uint64_t head) {
+            auto pos = p->meta.tail.load(std::memory_order_relaxed);
+            std::vector<std::uint8_t> record;
+            while (pos < head) {
+                entry_header entry;
+                copy_out(region::meta_data(p), meta_ring_size, pos, reinterpret_cast<std::uint8_t *>(&entry), sizeof(entry));
+                record.resize(entry.size);
+                copy_out(region::meta_data(p), meta_ring_size, pos + sizeof(entry), record.data(), record.size());
+                pos += sizeof(entry) + entry.size;
+                add_meta(record.data(), record.size());
+            }
+            p->meta.tail.store(head, std::memory_order_release);
+        }
+        void add_meta(const std::uint8_t *data, std::size_t len) {
+            // Every producer writes the entries of the formats it uses, the log needs each of them once
+            format_dictionary::format_id_type marker, id;
+            if (m_dictionary && len >= 2 * sizeof(id)) {
+                std::memcpy(&marker, data, sizeof(marker));
+                std::memcpy(&id, data + sizeof(marker), sizeof(id));
+                if (marker == format_dictionary::dictionary_marker && !m_dictionary_ids.insert(id).second) {
+                    return;
+                }
+            }
+            m_meta.insert(m_meta.end(), data, data + len);
+        }
+
+        // Write this poll's lines, oldest first
+        void merge() {
+            using item = std::pair<std::uint64_t, std::uint32_t>;
+            std::priority_queue<item, std::vector<item>, std::greater<item>> heads;
+            for (std::uint32_t i = 0; i < m_producers.size(); i++) {
+                if (!m_producers[i].entries.empty()) {
+                    heads.emplace(entry_at(m_producers[i]).timestamp, i);
+                }
+            }
+            while (!heads.empty()) {
+                auto [timestamp, i] = heads.top();
+                heads.pop();
+                auto& producer = m_producers[i];
+                auto entry = entry_at(producer);
+                auto payload = producer.entries.data() + producer.pos + sizeof(entry);
+                if (m_block.empty()) {
+                    m_block.resize(sizeof(framing::block_header));
+                    m_block_timestamp = timestamp;
+                    m_block_lines = 0;
+                }
+                m_block.insert(m_block.end(), producer.tag.begin(), producer.tag.end());
+                m_block.insert(m_block.end(), payload, payload + entry.size);
+                m_block_lines++;
+                if (m_block.size() - sizeof(framing::block_header) >= m_block_size) {
+                    flush_block();
+                }
+                producer.pos += sizeof(entry) + entry.size;
+                if (producer.pos < producer.entries.size()) {
+                    heads.emplace(entry_at(producer).timestamp, i);
+                }
+            }
+            flush_block();
+        }
+        static entry_header entry_at(const pending& producer) {
+            entry_header entry;
+            std::memcpy(&entry, producer.entries.data() + producer.pos, sizeof(entry));
+            return entry;
+        }
+        void flush_block() {
+            if (m_block.empty()) {
+                return;
+            }
+            m_out.append_block(m_block.data(), m_block.size() - sizeof(framing::block_header), m_block_lines, m_block_timestamp,
+                framing::data_block);
+            m_block.clear();
+        }
+        region m_region;
+        const std::size_t m_block_size;
+        framing::log_writer m_out;
+        std::vector<pending> m_producers;
+        bool m_started = false;
+        bool m_dictionary = false;
+        std::unordered_set<format_dictionary::format_id_type> m_dictionary_ids;
+        std::vector<std::uint8_t> m_meta;
+        tag_encoder<typename Config::template config_with_format_dictionary<false>> m_plain_tags{
+            [this](const std::uint8_t *data, std::size_t len) { add_meta(data, len); }};
+        tag_encoder<typename Config::template config_with_format_dictionary<>> m_dictionary_tags{
+            [this](const std::uint8_t *data, std::size_t len) { add_meta(data, len); }};
+        std::vector<std::uint8_t> m_block;
+        std::uint64_t m_block_timestamp = 0;
+        std::uint32_t m_block_lines = 0;
+        std::uint64_t m_lines = 0;
+        std::uint64_t m_dropped = 0;
+    };
+}
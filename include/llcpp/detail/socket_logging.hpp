@@ -0,0 +1,505 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "logging.hpp"
+#include "framing.hpp"
+#include "per_thread.hpp"
+#include "socket_transport.hpp"
+#include "spsc_ring.hpp"
+
+namespace llcpp::detail::logging {
+    /*
+     * Ships lines to a receiver over a socket (see socket_transport.hpp), as framed blocks.
+     * Each thread batches its lines in a buffer of its own, and a line that brings the batch to `batch_size` bytes
+     *  (or ends once the batch is `max_delay` old) seals it into a block and queues it for the sender thread. The
+     *  sender thread sends every queued batch at once: a single vectored send on a stream socket, a sendmmsg (one
+     *  datagram per batch) on a datagram socket.
+     * The queue is bounded (`max_pending` batches): when the receiver is slow or unreachable, the `Policy` decides
+     *  whether a full batch is dropped (drop), the oldest queued one is dropped (overwrite), or the call site waits
+     *  (block). Dropped lines are counted by `dropped()`.
+     * Meta records are kept (all the dictionary entries, the latest record of each other format) and sent before the
+     *  batches that follow them, again on every new connection, and every `meta_interval` over datagrams. A datagram
+     *  can be lost or overtake another, so with the format dictionary each batch's datagram also carries the entries
+     *  its lines use (the receiver writes each entry once).
+     * A thread's batch is sent when the thread exits, and every batch is sent when the logger is destroyed (the logger
+     *  must not be logged to concurrently with its destruction).
+     */
+    template<typename PrefixTuple, typename Config = config::default_config,
+        spsc_ring::full_ring_policy Policy = spsc_ring::full_ring_policy::drop>
+    struct socket_logger : public logger_base<PrefixTuple, socket_logger<PrefixTuple, Config, Policy>, Config> {
+        using base_t = logger_base<PrefixTuple, socket_logger<PrefixTuple, Config, Policy>, Config>;
+        friend base_t;
+        using options = socket_transport::sender_options;
+
+        // `spec` is the receiver's endpoint, i.e. "unix:/run/llcpp.sock" or "udp:127.0.0.1:5140"
+        explicit socket_logger(std::string_view spec, PrefixTuple&& prefix_tuple = {}, const options& opts = {}) :
+            base_t(std::forward<PrefixTuple>(prefix_tuple)),
+            m_endpoint(socket_transport::parse_endpoint(spec)),
+            m_options(opts),
+            m_file_header(framing::make_file_header<Config>(static_cast<std::uint32_t>(opts.batch_size))),
+            m_bundle_entries(Config::use_format_dictionary && m_endpoint && !m_endpoint->is_stream())
+        {
+            if (m_endpoint) {
+                m_sender = std::thread([this] { sender_loop(); });
+            }
+        }
+        ~socket_logger() {
+            {
+                // The last batches are queued whatever the queue's size
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_closing = true;
+            }
+            m_room.notify_all();
+            m_batches.detach_all([this](thread_batch& batch) {
+                send_batch(batch);
+            });
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_ready.notify_one();
+            if (m_sender.joinable()) {
+                m_sender.join();
+            }
+        }
+
+        // The endpoint was understood, it may still be unreachable
+        bool is_open() const {
+            return m_endpoint.has_value();
+        }
+        // Lines dropped because the queue was full, or because they couldn't be sent
+        std::uint64_t dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        void line_hint_impl() {
+            auto& batch = m_batches.local(this);
+            if (batch.count == sizeof(framing::block_header)) {
+                return;
+            }
+            if (batch.line_count++ == 0) {
+                batch.tick = m_tick.load(std::memory_order_relaxed);
+            }
+            if (batch.count - sizeof(framing::block_header) >= m_options.batch_size ||
+                    batch.tick != m_tick.load(std::memory_order_relaxed)) {
+                send_batch(batch);
+                this->report_stats_if_due();
+            }
+        }
+    protected:
+        static constexpr bool use_timestamp_deltas = Config::use_compact_encoding;
+
+        // A block header followed by the batch's lines, the buffer is sized for a whole batch (and then some)
+        struct thread_batch {
+            explicit thread_batch(socket_logger *owner) : logger(owner) {
+                owner->prepare(data);
+                if constexpr(use_timestamp_deltas) {
+                    timestamp_base = next_timestamp_base = clock::coarse_realtime_ns();
+                }
+            }
+            // The batch goes to the next thread
+            void on_thread_exit() {
+                logger->send_batch(*this);
+                count = sizeof(framing::block_header);
+            }
+
+            std::vector<std::uint8_t> data;
+            std::size_t count = sizeof(framing::block_header);
+            std::uint32_t line_count = 0;
+            std::uint64_t block_timestamp = 0;
+            // m_tick when the batch's first line ended
+            std::uint64_t tick = 0;
+            // The current record's timestamp base, and the next record's
+            std::uint64_t timestamp_base = 0;
+            std::uint64_t next_timestamp_base = 0;
+            // Datagrams with the format dictionary, the formats of the batch's records
+            std::unordered_set<format_dictionary::format_id_type> formats;
+            socket_logger *logger;
+        };
+        // A sealed batch, and the dictionary entries sent in its datagram
+        struct queued_batch {
+            std::vector<std::uint8_t> block;
+            std::vector<std::uint8_t> entries;
+        };
+
+        std::uint8_t *make_room(thread_batch& batch, const std::size_t len) {
+            if (batch.count == sizeof(framing::block_header)) {
+                batch.block_timestamp = (use_timestamp_deltas) ? (batch.timestamp_base) : (clock::coarse_realtime_ns());
+            }
+            if (batch.count + len > batch.data.size()) {
+                // Past the slack, i.e. a line bigger than a batch, sent as an oversized block
+                batch.data.resize(std::max(batch.data.size() * 2, batch.count + len));
+            }
+            return batch.data.data() + batch.count;
+        }
+        void write_impl(const std::uint8_t *data, const std::size_t len) {
+            auto& batch = m_batches.local(this);
+            std::memcpy(make_room(batch, len), data, len);
+            batch.count += len;
+        }
+        std::uint8_t *reserve_impl(const std::size_t len) {
+            return make_room(m_batches.local(this), len);
+        }
+        void commit_impl(const std::size_t len) {
+            m_batches.local(this).count += len;
+        }
+        void use_format_impl(format_dictionary::format_id_type id) {
+            if (m_bundle_entries) {
+                m_batches.local(this).formats.insert(id);
+            }
+        }
+        void begin_record_impl() {
+            if constexpr(use_timestamp_deltas) {
+                auto& batch = m_batches.local(this);
+                batch.timestamp_base = batch.next_timestamp_base;
+            }
+        }
+        std::uint64_t timestamp_base_impl() {
+            if constexpr(use_timestamp_deltas) {
+                return m_batches.local(this).timestamp_base;
+            } else {
+                return 0;
+            }
+        }
+        void set_next_timestamp_base_impl(std::uint64_t timestamp) {
+            if constexpr(use_timestamp_deltas) {
+                m_batches.local(this).next_timestamp_base = timestamp;
+            }
+        }
+
+        /*
+         * Kept for every new connection, queued for the current one. Dictionary entries are all kept, other meta
+         *  records (i.e. tsc_calibration) are state: only the latest one with each format is.
+         */
+        void write_meta_impl(const std::uint8_t *data, const std::size_t len) {
+            std::vector<std::uint8_t> block(sizeof(framing::block_header) + len);
+            std::memcpy(block.data() + sizeof(framing::block_header), data, len);
+            seal(block.data(), len, 0, clock::coarse_realtime_ns(), framing::meta_block);
+            auto format = meta_record_format<Config>(data, len);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (format.empty()) {
+                m_dictionary.insert(m_dictionary.end(), block.begin(), block.end());
+                format_dictionary::format_id_type marker, id;
+                if (m_bundle_entries && len >= 2 * sizeof(id)) {
+                    std::memcpy(&marker, data, sizeof(marker));
+                    std::memcpy(&id, data + sizeof(marker), sizeof(id));
+                    if (marker == format_dictionary::dictionary_marker) {
+                        m_entries[id] = block;
+                    }
+                }
+            } else {
+                m_latest_meta[std::string(format)] = block;
+            }
+            m_new_meta.insert(m_new_meta.end(), block.begin(), block.end());
+            m_ready.notify_one();
+        }
+
+        static void seal(std::uint8_t *block, std::size_t payload_size, std::uint32_t record_count, std::uint64_t first_timestamp,
+                std::uint16_t flags) {
+            framing::block_header header;
+            framing::seal_block(header, static_cast<std::uint32_t>(payload_size), record_count, first_timestamp, flags,
+                block + sizeof(header));
+            std::memcpy(block, &header, sizeof(header));
+        }
+        void prepare(std::vector<std::uint8_t>& buffer) const {
+            auto size = sizeof(framing::block_header) + m_options.batch_size + 4096;
+            if (buffer.size() < size) {
+                buffer.resize(size);
+            }
+        }
+        // Seal a thread's lines into a block and queue it, the batch starts over with a spare buffer
+        void send_batch(thread_batch& batch) {
+            if (batch.line_count == 0) {
+                return;
+            }
+            auto payload_size = batch.count - sizeof(framing::block_header);
+            seal(batch.data.data(), payload_size, batch.line_count, batch.block_timestamp, framing::data_block);
+            auto lines = batch.line_count;
+            batch.count = sizeof(framing::block_header);
+            batch.line_count = 0;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            std::vector<std::uint8_t> entries;
+            for (auto id : batch.formats) {
+                auto it = m_entries.find(id);
+                if (it != m_entries.end()) {
+                    entries.insert(entries.end(), it->second.begin(), it->second.end());
+                }
+            }
+            batch.formats.clear();
+            if (m_queue.size() >= m_options.max_pending && !m_closing) {
+                if constexpr(Policy == spsc_ring::full_ring_policy::block) {
+                    m_room.wait(lock, [this] { return m_queue.size() < m_options.max_pending || m_closing; });
+                } else if constexpr(Policy == spsc_ring::full_ring_policy::drop) {
+                    m_dropped.fetch_add(lines, std::memory_order_relaxed);
+                    return;
+                } else {
+                    m_dropped.fetch_add(line_count(m_queue.front().block), std::memory_order_relaxed);
+                    m_spare.push_back(std::move(m_queue.front().block));
+                    m_queue.pop_front();
+                }
+            }
+            m_queue.push_back({std::move(batch.data), std::move(entries)});
+            if (m_spare.empty()) {
+                batch.data = std::vector<std::uint8_t>();
+            } else {
+                batch.data = std::move(m_spare.back());
+                m_spare.pop_back();
+            }
+            lock.unlock();
+            m_ready.notify_one();
+            prepare(batch.data);
+        }
+        // Queued buffers are bigger than the block they hold
+        static framing::block_header header_of(const std::vector<std::uint8_t>& block) {
+            framing::block_header header;
+            std::memcpy(&header, block.data(), sizeof(header));
+            return header;
+        }
+        static std::uint32_t line_count(const std::vector<std::uint8_t>& block) {
+            return header_of(block).record_count;
+        }
+        static std::size_t block_size(const std::vector<std::uint8_t>& block) {
+            return sizeof(framing::block_header) + header_of(block).payload_size;
+        }
+
+        // What the sender thread takes from the queue at once
+        struct outgoing {
+            // Meta blocks, sent first
+            std::vector<std::uint8_t> meta;
+            std::vector<queued_batch> batches;
+        };
+
+        void sender_loop() {
+            using clock_t = std::chrono::steady_clock;
+            auto next_tick = clock_t::now() + m_options.max_delay;
+            auto next_connect = clock_t::now();
+            auto next_meta = clock_t::now() + m_options.meta_interval;
+            bool resend_meta = true;
+            outgoing out;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true) {
+                auto now = clock_t::now();
+                if (now >= next_tick) {
+                    m_tick.fetch_add(1, std::memory_order_relaxed);
+                    next_tick = now + m_options.max_delay;
+                }
+                if (m_fd < 0 && (now >= next_connect || m_stop)) {
+                    lock.unlock();
+                    m_fd = socket_transport::connect_to(*m_endpoint);
+                    lock.lock();
+                    next_connect = now + m_options.reconnect_interval;
+                    resend_meta = true;
+                }
+                if (!m_endpoint->is_stream() && now >= next_meta) {
+                    next_meta = now + m_options.meta_interval;
+                    resend_meta = true;
+                }
+                bool pending = !m_queue.empty() || !m_new_meta.empty();
+                if (m_fd < 0 && m_stop) {
+                    // The receiver is gone, give up on what's left
+                    for (auto& batch : m_queue) {
+                        m_dropped.fetch_add(line_count(batch.block), std::memory_order_relaxed);
+                    }
+                    break;
+                }
+                if (m_fd >= 0 && (pending || resend_meta)) {
+                    take(out, resend_meta);
+                    resend_meta = false;
+                    lock.unlock();
+                    m_room.notify_all();
+                    if (!send(out)) {
+                        ::close(m_fd);
+                        m_fd = -1;
+                    }
+                    lock.lock();
+                    for (auto& batch : out.batches) {
+                        if (m_spare.size() < m_options.max_pending) {
+                            m_spare.push_back(std::move(batch.block));
+                        }
+                    }
+                    out.batches.clear();
+                    continue;
+                }
+                if (m_stop) {
+                    break;
+                }
+                auto wake = next_tick;
+                if (m_fd < 0) {
+                    wake = std::min(wake, next_connect);
+                } else if (!m_endpoint->is_stream()) {
+                    wake = std::min(wake, next_meta);
+                }
+                m_ready.wait_until(lock, wake, [&] { return m_stop || (m_fd >= 0 && (!m_queue.empty() || !m_new_meta.empty())); });
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+        // With m_mutex held. A new connection (or a meta resend) starts with every meta record kept so far
+        void take(outgoing& out, bool all_meta) {
+            out.meta.clear();
+            if (all_meta) {
+                out.meta = m_dictionary;
+                for (auto& [format, block] : m_latest_meta) {
+                    out.meta.insert(out.meta.end(), block.begin(), block.end());
+                }
+                m_new_meta.clear();
+            } else {
+                out.meta.swap(m_new_meta);
+            }
+            while (!m_queue.empty()) {
+                out.batches.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        // False once the connection is lost. Lines that weren't sent are counted as dropped
+        bool send(const outgoing& out) {
+            return (m_endpoint->is_stream()) ? (send_stream(out)) : (send_datagrams(out));
+        }
+        bool send_stream(const outgoing& out) {
+            std::vector<iovec> iov;
+            if (!m_connected) {
+                iov.push_back({const_cast<std::uint8_t *>(m_file_header.data()), m_file_header.size()});
+            }
+            if (!out.meta.empty()) {
+                iov.push_back({const_cast<std::uint8_t *>(out.meta.data()), out.meta.size()});
+            }
+            for (auto& batch : out.batches) {
+                iov.push_back({const_cast<std::uint8_t *>(batch.block.data()), block_size(batch.block)});
+            }
+            std::size_t first = 0;
+            auto batches_start = iov.size() - out.batches.size();
+            while (first < iov.size()) {
+                msghdr msg{};
+                msg.msg_iov = iov.data() + first;
+                msg.msg_iovlen = std::min<std::size_t>(iov.size() - first, IOV_MAX);
+                auto sent = ::sendmsg(m_fd, &msg, MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    for (auto i = std::max(first, batches_start) - batches_start; i < out.batches.size(); i++) {
+                        m_dropped.fetch_add(line_count(out.batches[i].block), std::memory_order_relaxed);
+                    }
+                    m_connected = false;
+                    return false;
+                }
+                // Skip what was sent, a partially sent buffer is resumed where it stopped
+                auto remaining = static_cast<std::size_t>(sent);
+                while (first < iov.size() && remaining >= iov[first].iov_len) {
+                    remaining -= iov[first].iov_len;
+                    first++;
+                }
+                if (remaining > 0) {
+                    iov[first].iov_base = static_cast<std::uint8_t *>(iov[first].iov_base) + remaining;
+                    iov[first].iov_len -= remaining;
+                }
+            }
+            m_connected = true;
+            return true;
+        }
+        bool send_datagrams(const outgoing& out) {
+            // The meta blocks go in datagrams of about batch_size bytes, each batch in one of its own after its entries
+            std::vector<iovec> payloads;
+            for (std::size_t pos = 0, start = 0; pos < out.meta.size();) {
+                framing::block_header header;
+                std::memcpy(&header, out.meta.data() + pos, sizeof(header));
+                pos += sizeof(header) + header.payload_size;
+                if (pos - start >= m_options.batch_size || pos == out.meta.size()) {
+                    payloads.push_back({nullptr, 0});
+                    payloads.push_back({const_cast<std::uint8_t *>(out.meta.data() + start), pos - start});
+                    start = pos;
+                }
+            }
+            auto batches_start = payloads.size() / 2;
+            for (auto& batch : out.batches) {
+                payloads.push_back({const_cast<std::uint8_t *>(batch.entries.data()), batch.entries.size()});
+                payloads.push_back({const_cast<std::uint8_t *>(batch.block.data()), block_size(batch.block)});
+            }
+            std::vector<iovec> iov(3 * (payloads.size() / 2));
+            std::vector<mmsghdr> msgs(payloads.size() / 2);
+            for (std::size_t i = 0; i < msgs.size(); i++) {
+                iov[3 * i] = {const_cast<std::uint8_t *>(m_file_header.data()), m_file_header.size()};
+                iov[3 * i + 1] = payloads[2 * i];
+                iov[3 * i + 2] = payloads[2 * i + 1];
+                msgs[i] = {};
+                msgs[i].msg_hdr.msg_iov = &iov[3 * i];
+                msgs[i].msg_hdr.msg_iovlen = 3;
+            }
+            for (std::size_t first = 0; first < msgs.size();) {
+                auto sent = ::sendmmsg(m_fd, msgs.data() + first, static_cast<unsigned>(msgs.size() - first), MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent < 0 && (errno == ECONNREFUSED || errno == ENOTCONN || errno == ENOENT)) {
+                    // The receiver is gone (a new one would be another socket), reconnect
+                    for (auto i = std::max(first, batches_start) - batches_start; i < out.batches.size(); i++) {
+                        m_dropped.fetch_add(line_count(out.batches[i].block), std::memory_order_relaxed);
+                    }
+                    return false;
+                }
+                if (sent <= 0) {
+                    // This datagram failed (i.e. it's too big), move on to the next one
+                    if (first >= batches_start) {
+                        m_dropped.fetch_add(line_count(out.batches[first - batches_start].block), std::memory_order_relaxed);
+                    }
+                    first++;
+                    continue;
+                }
+                first += sent;
+            }
+            return true;
+        }
+
+        const std::optional<socket_transport::endpoint> m_endpoint;
+        const options m_options;
+        const decltype(framing::make_file_header<Config>(0)) m_file_header;
+        // Datagrams with the format dictionary, each batch carries the entries it uses
+        const bool m_bundle_entries;
+        per_thread::registry<thread_batch> m_batches;
+        alignas(64) std::atomic<std::uint64_t> m_tick{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+
+        std::mutex m_mutex;
+        std::condition_variable m_ready;
+        std::condition_variable m_room;
+        std::deque<queued_batch> m_queue;
+        std::vector<std::vector<std::uint8_t>> m_spare;
+        std::vector<std::uint8_t> m_new_meta;
+        std::vector<std::uint8_t> m_dictionary;
+        std::unordered_map<std::string, std::vector<std::uint8_t>> m_latest_meta;
+        std::unordered_map<format_dictionary::format_id_type, std::vector<std::uint8_t>> m_entries;
+        bool m_closing = false;
+        bool m_stop = false;
+
+        // Sender thread only
+        int m_fd = -1;
+        bool m_connected = false;
+        std::thread m_sender;
+    };
+}
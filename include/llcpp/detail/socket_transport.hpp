@@ -0,0 +1,373 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "framing.hpp"
+#include "format_dictionary.hpp"
+
+namespace llcpp::detail::socket_transport {
+    /*
+     * Shipping logs over a socket: `socket_logger` sends its lines as framed blocks (see framing.hpp) to a receiver
+     *  (`llcpp_receive`, see `receiver`), which writes them to a framed log.
+     * - Stream sockets (unix, tcp): each connection starts with the sender's file header, followed by blocks.
+     * - Datagram sockets (unixgram, udp): each datagram is the sender's file header followed by whole blocks.
+     * A block holds whole lines, meta records are in meta blocks of their own, like in a framed file.
+     * Endpoints are written "unix:<path>", "unixgram:<path>", "tcp:<host>:<port>" or "udp:<host>:<port>" (an IPv6
+     *  host in brackets, i.e. "udp:[::1]:5140").
+     */
+    enum class socket_kind {
+        unix_stream,
+        unix_datagram,
+        tcp,
+        udp,
+    };
+
+    struct endpoint {
+        socket_kind kind;
+        sockaddr_storage address;
+        socklen_t address_len;
+
+        bool is_stream() const {
+            return kind == socket_kind::unix_stream || kind == socket_kind::tcp;
+        }
+        bool is_unix() const {
+            return kind == socket_kind::unix_stream || kind == socket_kind::unix_datagram;
+        }
+        const char *unix_path() const {
+            return reinterpret_cast<const sockaddr_un *>(&address)->sun_path;
+        }
+    };
+
+    // `passive` resolves an address to bind to, where an empty host means any address
+    inline std::optional<endpoint> parse_endpoint(std::string_view spec, bool passive = false) {
+        endpoint result{};
+        auto colon = spec.find(':');
+        if (colon == std::string_view::npos) {
+            return std::nullopt;
+        }
+        auto scheme = spec.substr(0, colon);
+        auto rest = spec.substr(colon + 1);
+        if (scheme == "unix" || scheme == "unixgram") {
+            result.kind = (scheme == "unix") ? (socket_kind::unix_stream) : (socket_kind::unix_datagram);
+            auto addr = reinterpret_cast<sockaddr_un *>(&result.address);
+            if (rest.empty() || rest.size() >= sizeof(addr->sun_path)) {
+                return std::nullopt;
+            }
+            addr->sun_family = AF_UNIX;
+            std::memcpy(addr->sun_path, rest.data(), rest.size());
+            result.address_len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + rest.size() + 1);
+            return result;
+        }
+        if (scheme != "tcp" && scheme != "udp") {
+            return std::nullopt;
+        }
+        result.kind = (scheme == "tcp") ? (socket_kind::tcp) : (socket_kind::udp);
+        auto port_colon = rest.rfind(':');
+        if (port_colon == std::string_view::npos) {
+            return std::nullopt;
+        }
+        auto host = std::string(rest.substr(0, port_colon));
+        auto port = std::string(rest.substr(port_colon + 1));
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = (result.kind == socket_kind::tcp) ? (SOCK_STREAM) : (SOCK_DGRAM);
+        hints.ai_flags = AI_NUMERICSERV | ((passive) ? (AI_PASSIVE) : (0));
+        addrinfo *info = nullptr;
+        if (::getaddrinfo((host.empty()) ? (nullptr) : (host.c_str()), port.c_str(), &hints, &info) != 0 || !info) {
+            return std::nullopt;
+        }
+        std::memcpy(&result.address, info->ai_addr, info->ai_addrlen);
+        result.address_len = info->ai_addrlen;
+        ::freeaddrinfo(info);
+        return result;
+    }
+
+    inline int open_socket(const endpoint& ep) {
+        return ::socket(ep.address.ss_family, ((ep.is_stream()) ? (SOCK_STREAM) : (SOCK_DGRAM)) | SOCK_CLOEXEC, 0);
+    }
+    // A connected socket (datagram sockets too, so the sender needs no address per message), -1 on failure
+    inline int connect_to(const endpoint& ep) {
+        int fd = open_socket(ep);
+        if (fd < 0) {
+            return -1;
+        }
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&ep.address), ep.address_len) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Options of a socket_logger
+    struct sender_options {
+        // A thread's lines are sent once they add up to this many bytes (keep datagrams under 64KB with udp)
+        std::size_t batch_size = 32 * 1024;
+        // Batches waiting for the sender thread, past which the full ring policy applies
+        std::size_t max_pending = 64;
+        // A batch is also sent by the first line to end after it's this old
+        std::chrono::milliseconds max_delay{100};
+        // Between connection attempts, while the receiver can't be reached
+        std::chrono::milliseconds reconnect_interval{1000};
+        // Datagrams only, how often the meta records are sent again, in case they were lost
+        std::chrono::milliseconds meta_interval{1000};
+    };
+
+    /*
+     * Receives the blocks of any number of senders (see socket_logger) and writes them to a single framed log.
+     * Call `poll` repeatedly (see tools/llcpp_receive.cpp), the log's index is written when the receiver is destroyed.
+     * The first sender sets the log's file header, senders with a different one (i.e. another format dictionary
+     *  setting or terminator set) are refused. Blocks are checked and written as they are, format dictionary entries
+     *  are written once. Blocks of different senders are interleaved, each one's lines stay in order.
+     */
+    struct receiver {
+        // Bigger datagrams are truncated and rejected
+        static constexpr std::size_t max_datagram_size = 256 * 1024;
+
+        receiver(std::string_view spec, std::string_view path) : m_out(path) {
+            auto ep = parse_endpoint(spec, true);
+            if (!ep || !m_out.is_open()) {
+                return;
+            }
+            m_endpoint = *ep;
+            if (m_endpoint.is_unix()) {
+                ::unlink(m_endpoint.unix_path());
+            }
+            int fd = open_socket(m_endpoint);
+            int one = 1;
+            if (fd >= 0 && m_endpoint.kind == socket_kind::tcp) {
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            }
+            if (fd < 0 || ::bind(fd, reinterpret_cast<const sockaddr *>(&m_endpoint.address), m_endpoint.address_len) != 0 ||
+                    (m_endpoint.is_stream() && ::listen(fd, SOMAXCONN) != 0)) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                return;
+            }
+            m_fd = fd;
+            m_bound = true;
+            if (!m_endpoint.is_stream()) {
+                m_datagram.resize(max_datagram_size);
+            }
+        }
+        receiver(const receiver&) = delete;
+        receiver& operator=(const receiver&) = delete;
+        ~receiver() {
+            for (auto& conn : m_connections) {
+                ::close(conn.fd);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+            if (m_bound && m_endpoint.is_unix()) {
+                ::unlink(m_endpoint.unix_path());
+            }
+            if (!m_header.empty()) {
+                m_out.write_index(clock::realtime_ns());
+            }
+        }
+
+        bool is_open() const {
+            return m_fd >= 0;
+        }
+        // Wait up to `timeout` for data, and write what arrived. Returns the number of lines written
+        std::size_t poll(std::chrono::milliseconds timeout) {
+            std::vector<pollfd> fds;
+            fds.push_back({m_fd, POLLIN, 0});
+            for (auto& conn : m_connections) {
+                fds.push_back({conn.fd, POLLIN, 0});
+            }
+            if (::poll(fds.data(), fds.size(), static_cast<int>(timeout.count())) <= 0) {
+                return 0;
+            }
+            auto start = m_lines;
+            if (fds[0].revents & POLLIN) {
+                if (m_endpoint.is_stream()) {
+                    accept_connection();
+                } else {
+                    receive_datagrams();
+                }
+            }
+            // Connections accepted in this poll are at the end, and not polled yet
+            for (std::size_t i = fds.size() - 1; i > 0; i--) {
+                if (fds[i].revents && !receive(m_connections[i - 1])) {
+                    ::close(m_connections[i - 1].fd);
+                    m_connections.erase(m_connections.begin() + (i - 1));
+                }
+            }
+            m_out.flush();
+            return m_lines - start;
+        }
+
+        std::uint64_t lines() const {
+            return m_lines;
+        }
+        // Blocks that failed their checksum, and connections or datagrams refused for their file header
+        std::uint64_t rejected() const {
+            return m_rejected;
+        }
+
+    private:
+        struct connection {
+            int fd;
+            std::vector<std::uint8_t> data;
+            bool has_header = false;
+        };
+
+        void accept_connection() {
+            int fd = ::accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                m_connections.push_back({fd, {}, false});
+            }
+        }
+        // False once the connection is closed (or refused)
+        bool receive(connection& conn) {
+            auto size = conn.data.size();
+            conn.data.resize(size + 64 * 1024);
+            auto received = ::recv(conn.fd, conn.data.data() + size, conn.data.size() - size, 0);
+            if (received <= 0) {
+                return received < 0 && (errno == EINTR || errno == EAGAIN);
+            }
+            conn.data.resize(size + received);
+            std::size_t pos = 0;
+            if (!conn.has_header) {
+                auto header_size = file_header_size(conn.data.data(), conn.data.size());
+                if (header_size == 0) {
+                    // Not enough of it yet
+                    return conn.data.size() < sizeof(framing::file_header) + 256;
+                }
+                if (!accept_header(conn.data.data(), header_size)) {
+                    return false;
+                }
+                conn.has_header = true;
+                pos = header_size;
+            }
+            pos += consume_blocks(conn.data.data() + pos, conn.data.size() - pos);
+            conn.data.erase(conn.data.begin(), conn.data.begin() + pos);
+            return true;
+        }
+        void receive_datagrams() {
+            // Drain what's queued, without waiting
+            while (true) {
+                auto received = ::recv(m_fd, m_datagram.data(), m_datagram.size(), MSG_DONTWAIT | MSG_TRUNC);
+                if (received < 0) {
+                    return;
+                }
+                auto len = static_cast<std::size_t>(received);
+                auto header_size = file_header_size(m_datagram.data(), std::min(len, m_datagram.size()));
+                if (len > m_datagram.size() || header_size == 0 || !accept_header(m_datagram.data(), header_size)) {
+                    m_rejected++;
+                    continue;
+                }
+                if (header_size + consume_blocks(m_datagram.data() + header_size, len - header_size) < len) {
+                    // A datagram is never split, whatever is left is garbage
+                    m_rejected++;
+                }
+            }
+        }
+
+        // The size of the file header at `data`, 0 if it isn't all there yet
+        static std::size_t file_header_size(const std::uint8_t *data, std::size_t len) {
+            framing::file_header header;
+            if (len < sizeof(header)) {
+                return 0;
+            }
+            std::memcpy(&header, data, sizeof(header));
+            auto size = sizeof(header) + header.terminator_count;
+            return (len >= size) ? (size) : (0);
+        }
+        bool accept_header(const std::uint8_t *data, std::size_t len) {
+            if (m_header.empty()) {
+                framing::file_header header;
+                std::memcpy(&header, data, sizeof(header));
+                if (std::memcmp(header.magic, framing::file_magic.data(), sizeof(header.magic)) != 0) {
+                    m_rejected++;
+                    return false;
+                }
+                m_header.assign(data, data + len);
+                m_dictionary = (header.flags & framing::format_dictionary_flag) != 0;
+                m_out.write(data, len);
+                return true;
+            }
+            if (len != m_header.size() || std::memcmp(data, m_header.data(), len) != 0) {
+                m_rejected++;
+                return false;
+            }
+            return true;
+        }
+        // Write the whole blocks at `data`, returns the number of bytes consumed
+        std::size_t consume_blocks(const std::uint8_t *data, std::size_t len) {
+            std::size_t pos = 0;
+            framing::block_header header;
+            while (len - pos >= sizeof(header)) {
+                std::memcpy(&header, data + pos, sizeof(header));
+                if (header.sync != framing::sync_marker) {
+                    // Out of sync, drop it all
+                    m_rejected++;
+                    return len;
+                }
+                if (len - pos - sizeof(header) < header.payload_size) {
+                    break;
+                }
+                auto payload = data + pos + sizeof(header);
+                if (framing::block_checksum(header, payload) != header.checksum) {
+                    m_rejected++;
+                } else if (header.flags == framing::meta_block) {
+                    if (!is_known_entry(payload, header.payload_size)) {
+                        m_out.append_sealed(data + pos);
+                    }
+                } else if (header.flags == framing::data_block) {
+                    m_out.append_sealed(data + pos);
+                    m_lines += header.record_count;
+                }
+                pos += sizeof(header) + header.payload_size;
+            }
+            return pos;
+        }
+        // Senders write their dictionary entries again (on every connection, and periodically over datagrams)
+        bool is_known_entry(const std::uint8_t *data, std::size_t len) {
+            format_dictionary::format_id_type marker, id;
+            if (!m_dictionary || len < 2 * sizeof(id)) {
+                return false;
+            }
+            std::memcpy(&marker, data, sizeof(marker));
+            std::memcpy(&id, data + sizeof(marker), sizeof(id));
+            return marker == format_dictionary::dictionary_marker && !m_dictionary_ids.insert(id).second;
+        }
+
+        framing::log_writer m_out;
+        endpoint m_endpoint{};
+        int m_fd = -1;
+        bool m_bound = false;
+        std::vector<connection> m_connections;
+        std::vector<std::uint8_t> m_datagram;
+        std::vector<std::uint8_t> m_header;
+        bool m_dictionary = false;
+        std::unordered_set<format_dictionary::format_id_type> m_dictionary_ids;
+        std::uint64_t m_lines = 0;
+        std::uint64_t m_rejected = 0;
+    };
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace llcpp::detail::spsc_ring {
+    /*
+     * What a producer does when a record doesn't fit in its ring:
+     * - block: Wait for the consumer to make room. Records bigger than the ring are dropped.
+     * - drop: Drop the record being written and count it.
+     * - overwrite: Drop the oldest committed records (and count them) to make room.
+     */
+    enum class full_ring_policy {
+        block,
+        drop,
+        overwrite,
+    };
+
+    /*
+     * A ring's buffer, prefaulted. With `huge_pages` it's mapped from the reserved huge pages (MAP_HUGETLB), or from
+     *  regular pages with transparent huge pages requested when none are reserved.
+     */
+    struct ring_memory {
+        static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+        ring_memory(std::size_t capacity, bool huge_pages) {
+            if (!huge_pages) {
+                m_heap.reset(new std::uint8_t[capacity]());
+                m_data = m_heap.get();
+                return;
+            }
+            m_mapped_len = (capacity + huge_page_size - 1) / huge_page_size * huge_page_size;
+            void *mapping = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+            mapping = ::mmap(nullptr, m_mapped_len, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+#endif
+            if (mapping == MAP_FAILED) {
+                mapping = ::mmap(nullptr, m_mapped_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mapping == MAP_FAILED) {
+                    m_mapped_len = 0;
+                    m_heap.reset(new std::uint8_t[capacity]());
+                    m_data = m_heap.get();
+                    return;
+                }
+#if defined(MADV_HUGEPAGE)
+                ::madvise(mapping, m_mapped_len, MADV_HUGEPAGE);
+#endif
+                std::memset(mapping, 0, m_mapped_len);
+            }
+            m_data = static_cast<std::uint8_t *>(mapping);
+        }
+        ring_memory(const ring_memory&) = delete;
+        ring_memory& operator=(const ring_memory&) = delete;
+        ~ring_memory() {
+            if (m_mapped_len > 0) {
+                ::munmap(m_data, m_mapped_len);
+            }
+        }
+
+        std::uint8_t *get() const {
+            return m_data;
+        }
+
+    private:
+        std::unique_ptr<std::uint8_t[]> m_heap;
+        std::size_t m_mapped_len = 0;
+        std::uint8_t *m_data = nullptr;
+    };
+
+    /*
+     * A single producer, single consumer byte ring holding whole records.
+     * The producer appends a record with any number of `write` calls and publishes it with `commit`,
+     *  so the consumer never sees a partial record.
+     * Positions are monotonic 64bit counters, the index into the buffer is `position & mask`.
+     * With the overwrite policy each record is preceded by its length so that the producer can
+     *  skip over (and the consumer can validate) whole records.
+     */
+    template<full_ring_policy Policy>
+    struct record_ring {
+        using record_length_type = std::uint32_t;
+        static constexpr std::size_t header_size = (Policy == full_ring_policy::overwrite) ? (sizeof(record_length_type)) : (0);
+
+        explicit record_ring(std::size_t capacity, bool huge_pages = false) : m_capacity(capacity), m_mask(capacity - 1),
+            m_buffer(capacity, huge_pages)
+        {
+        }
+
+        // Producer side
+        void write(const std::uint8_t *data, const std::size_t len) {
+            if (m_dropping || !begin_record()) {
+                return;
+            }
+            if (!make_room(len)) {
+                m_dropping = true;
+                return;
+            }
+            copy_in(m_write, data, len);
+            m_write += len;
+        }
+        /*
+         * A contiguous span of `len` bytes to be appended to the pending record with `advance`.
+         * Returns nullptr if the span would wrap around the ring or if the record is being dropped,
+         *  in which case `write` should be used instead.
+         */
+        std::uint8_t *reserve(const std::size_t len) {
+            if (m_dropping || !begin_record()) {
+                return nullptr;
+            }
+            auto idx = m_write & m_mask;
+            if (idx + len > m_capacity) {
+                return nullptr;
+            }
+            if (!make_room(len)) {
+                m_dropping = true;
+                return nullptr;
+            }
+            return m_buffer.get() + idx;
+        }
+        void advance(const std::size_t len) {
+            m_write += len;
+        }
+        void commit() {
+            if (m_dropping) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_write = m_record_start;
+                m_dropping = false;
+                return;
+            }
+            if (m_write == m_record_start) {
+                return;
+            }
+            if constexpr(header_size > 0) {
+                record_length_type len = static_cast<record_length_type>(m_write - m_record_start - header_size);
+                copy_in(m_record_start, (const std::uint8_t *)&len, sizeof(len));
+            }
+            m_head.store(m_write, std::memory_order_release);
+            m_record_start = m_write;
+        }
+
+        // Consumer side
+        std::uint64_t committed() const {
+            return m_head.load(std::memory_order_acquire);
+        }
+        /*
+         * Append committed records, up to position `limit` (a value previously returned by `committed()`), to `out`.
+         * Returns the number of bytes appended.
+         */
+        std::size_t drain(std::vector<std::uint8_t>& out, std::uint64_t limit) {
+            auto start_size = out.size();
+            if constexpr(Policy != full_ring_policy::overwrite) {
+                auto tail = m_tail.load(std::memory_order_relaxed);
+                if (tail >= limit) {
+                    return 0;
+                }
+                copy_out(out, tail, limit - tail);
+                m_tail.store(limit, std::memory_order_release);
+            } else {
+                while (true) {
+                    auto tail = m_tail.load(std::memory_order_acquire);
+                    if (tail >= limit) {
+                        break;
+                    }
+                    record_length_type len;
+                    copy_out((std::uint8_t *)&len, tail, sizeof(len));
+                    if (len > limit - tail - header_size) {
+                        // The producer overwrote this record while we were reading it, retry from the new tail
+                        continue;
+                    }
+                    auto prev_size = out.size();
+                    copy_out(out, tail + header_size, len);
+                    // The producer may have overwritten what we just copied, only keep it if we still own it
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (!m_tail.compare_exchange_strong(tail, tail + header_size + len, std::memory_order_acq_rel)) {
+                        out.resize(prev_size);
+                    }
+                }
+            }
+            return out.size() - start_size;
+        }
+
+        /*
+         * Call `fn(data, len)` with the committed records up to `limit`, oldest first, without consuming them.
+         * A record wrapping around the ring is passed in two spans. Overwrite policy only, and only consistent while
+         *  the producer is stopped: it doesn't allocate, so it can be used to dump the ring from a signal handler.
+         */
+        template<typename Fn>
+        void peek(std::uint64_t limit, Fn&& fn) const {
+            static_assert(Policy == full_ring_policy::overwrite, "Records are only delimited with the overwrite policy");
+            auto pos = m_tail.load(std::memory_order_acquire);
+            while (pos < limit) {
+                record_length_type len;
+                copy_out((std::uint8_t *)&len, pos, sizeof(len));
+                if (len > limit - pos - header_size) {
+                    return;
+                }
+                auto idx = (pos + header_size) & m_mask;
+                auto first = std::min<std::size_t>(len, m_capacity - idx);
+                fn(m_buffer.get() + idx, first);
+                if (first < len) {
+                    fn(m_buffer.get(), len - first);
+                }
+                pos += header_size + len;
+            }
+        }
+
+        std::uint64_t dropped() const {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        bool begin_record() {
+            if (m_write == m_record_start && header_size > 0) {
+                if (!make_room(header_size)) {
+                    m_dropping = true;
+                    return false;
+                }
+                m_write += header_size;
+            }
+            return true;
+        }
+        bool make_room(std::size_t len) {
+            // The pending record as a whole must fit in the ring
+            if (m_write + len - m_record_start > m_capacity) {
+                return false;
+            }
+            while (true) {
+                auto tail = m_tail.load(std::memory_order_acquire);
+                if (m_write + len - tail <= m_capacity) {
+                    break;
+                }
+                if constexpr(Policy == full_ring_policy::block) {
+                    std::this_thread::yield();
+                } else if constexpr(Policy == full_ring_policy::drop) {
+                    return false;
+                } else {
+                    // There must be committed records between tail and m_record_start, overwrite the oldest one
+                    record_length_type oldest_len;
+                    copy_out((std::uint8_t *)&oldest_len, tail, sizeof(oldest_len));
+                    if (m_tail.compare_exchange_strong(tail, tail + header_size + oldest_len, std::memory_order_acq_rel)) {
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            return true;
+        }
+
+        void copy_in(std::uint64_t pos, const std::uint8_t *data, std::size_t len) {
+            auto idx = pos & m_mask;
+            auto first = std::min(len, m_capacity - idx);
+            std::memcpy(m_buffer.get() + idx, data, first);
+            std::memcpy(m_buffer.get(), data + first, len - first);
+        }
+        void copy_out(std::uint8_t *data, std::uint64_t pos, std::size_t len) const {
+            auto idx = pos & m_mask;
+            auto first = std::min(len, m_capacity - idx);
+            std::memcpy(data, m_buffer.get() + idx, first);
+            std::memcpy(data + first, m_buffer.get(), len - first);
+        }
+        void copy_out(std::vector<std::uint8_t>& out, std::uint64_t pos, std::size_t len) const {
+            auto idx = pos & m_mask;
+            auto first = std::min(len, m_capacity - idx);
+            out.insert(out.end(), m_buffer.get() + idx, m_buffer.get() + idx + first);
+            out.insert(out.end(), m_buffer.get(), m_buffer.get() + (len - first));
+        }
+
+        const std::size_t m_capacity;
+        const std::size_t m_mask;
+        ring_memory m_buffer;
+
+        // Shared
+        alignas(64) std::atomic<std::uint64_t> m_head{0};
+        alignas(64) std::atomic<std::uint64_t> m_tail{0};
+        std::atomic<std::uint64_t> m_dropped{0};
+
+        // Producer only
+        alignas(64) std::uint64_t m_write = 0;
+        std::uint64_t m_record_start = 0;
+        bool m_dropping = false;
+    };
+}
\ No newline at end of file
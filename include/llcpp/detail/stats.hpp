@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "clock.hpp"
+#include "per_thread.hpp"
+
+namespace llcpp::detail::stats {
+    /*
+     * Latencies are measured in cycles (clock::cycles) and counted in power of 2 buckets: bucket i holds the values
+     *  below 2^i (and at least 2^(i-1)), the last one everything above. Converted to nanoseconds in snapshots.
+     */
+    static constexpr std::size_t bucket_count = 40;
+
+    inline std::size_t bucket_of(std::uint64_t cycles) {
+        if (cycles == 0) {
+            return 0;
+        }
+        return std::min<std::size_t>(64 - __builtin_clzll(cycles), bucket_count - 1);
+    }
+
+    /*
+     * A latency histogram with a single writer (the thread it belongs to) and any number of readers.
+     * Updates are plain relaxed load/store pairs, not read-modify-writes, readers may see a histogram mid-update.
+     */
+    struct counters {
+        void record(std::uint64_t cycles) {
+            bump(count, 1);
+            bump(total, cycles);
+            bump(buckets[bucket_of(cycles)], 1);
+            if (cycles > max.load(std::memory_order_relaxed)) {
+                max.store(cycles, std::memory_order_relaxed);
+            }
+        }
+        static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> max{0};
+        std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+    };
+
+    struct format_counters {
+        std::atomic<std::uint64_t> bytes{0};
+        // Its count is the number of lines
+        counters latency;
+    };
+
+    /*
+     * The formats seen by any logger in the process, numbered in order of first use so each thread can keep its
+     *  counters in an array. The same format used with different configs (or loggers) shares a number.
+     */
+    struct format_registry {
+        static format_registry& instance() {
+            static format_registry s_registry;
+            return s_registry;
+        }
+
+        std::size_t index_of(std::uint64_t id, const char *format) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto [it, inserted] = m_indices.try_emplace(id, m_formats.size());
+            if (inserted) {
+                m_formats.push_back(format);
+            }
+            return it->second;
+        }
+        std::string_view format(std::size_t index) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_formats[index];
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::unordered_map<std::uint64_t, std::size_t> m_indices;
+        // The string_formats' static characters
+        std::vector<const char *> m_formats;
+    };
+
+    // Numbered once, on the first line with this format
+    template<typename StringFormat>
+    std::size_t format_index() {
+        static const std::size_t s_index = format_registry::instance().index_of(StringFormat::id(), StringFormat::_chars);
+        return s_index;
+    }
+
+    /*
+     * One thread's counters for one logger. Format counters are allocated in pages as new formats show up and never
+     *  freed or moved, so other threads can read them at any time. Formats past `max_formats` aren't counted.
+     */
+    struct thread_stats {
+        static constexpr std::size_t page_size = 16;
+        static constexpr std::size_t page_count = 256;
+        static constexpr std::size_t max_formats = page_size * page_count;
+        using page = std::array<format_counters, page_size>;
+
+        thread_stats() = default;
+        thread_stats(const thread_stats&) = delete;
+        thread_stats& operator=(const thread_stats&) = delete;
+        ~thread_stats() {
+            for (auto& p : m_pages) {
+                delete p.load(std::memory_order_relaxed);
+            }
+        }
+
+        format_counters *find(std::size_t index) {
+            if (index >= max_formats) {
+                return nullptr;
+            }
+            auto& slot = m_pages[index / page_size];
+            auto p = slot.load(std::memory_order_relaxed);
+            if (!p) {
+                p = new page();
+                slot.store(p, std::memory_order_release);
+            }
+            return &(*p)[index % page_size];
+        }
+        template<typename F>
+        void for_each(F&& f) const {
+            for (std::size_t i = 0; i < page_count; i++) {
+                if (auto p = m_pages[i].load(std::memory_order_acquire)) {
+                    for (std::size_t j = 0; j < page_size; j++) {
+                        f(i * page_size + j, (*p)[j]);
+                    }
+                }
+            }
+        }
+
+        // Bytes written by the line in progress, owner only
+        std::uint64_t line_bytes = 0;
+        counters flush_stalls;
+        counters rotation_stalls;
+
+    private:
+        std::array<std::atomic<page*>, page_count> m_pages{};
+    };
+
+    /*
+     * A latency histogram in nanoseconds. Percentiles are the upper bound of the bucket they fall in (capped by the
+     *  worst case), so they're within a factor of 2 of the real value.
+     */
+    struct histogram {
+        std::uint64_t count = 0;
+        std::uint64_t total_ns = 0;
+        std::uint64_t max_ns = 0;
+        std::array<std::uint64_t, bucket_count> buckets{};
+        double ns_per_cycle = 1;
+
+        void add(const counters& c) {
+            count += c.count.load(std::memory_order_relaxed);
+            total_ns += static_cast<std::uint64_t>(c.total.load(std::memory_order_relaxed) * ns_per_cycle);
+            max_ns = std::max(max_ns, static_cast<std::uint64_t>(c.max.load(std::memory_order_relaxed) * ns_per_cycle));
+            for (std::size_t i = 0; i < bucket_count; i++) {
+                buckets[i] += c.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        std::uint64_t percentile(double percentile) const {
+            auto rank = static_cast<std::uint64_t>(percentile / 100 * count + 0.5);
+            rank = std::max<std::uint64_t>(rank, 1);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i + 1 < bucket_count; i++) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    return std::min(max_ns, static_cast<std::uint64_t>((1ULL << i) * ns_per_cycle));
+                }
+            }
+            return max_ns;
+        }
+        double mean_ns() const {
+            return (count > 0) ? (static_cast<double>(total_ns) / count) : (0);
+        }
+    };
+
+    struct format_stats {
+        // As written in the _log literal
+        std::string_view format;
+        std::uint64_t lines = 0;
+        std::uint64_t bytes = 0;
+        // Of the whole logging call: prefixes, serialization, and any flush or rotation it did
+        histogram latency;
+    };
+
+    // A logger's counters summed over all the threads that used it, formats sorted by bytes written
+    struct snapshot {
+        std::vector<format_stats> formats;
+        // Logging calls held up flushing a buffer (or the file writer), and rotating the file
+        histogram flush_stalls;
+        histogram rotation_stalls;
+    };
+
+    // Measures from its construction to its destruction, into `target` (if any)
+    struct scoped_timer {
+        explicit scoped_timer(counters *target) : m_target(target), m_start(clock::cycles()) {}
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+        ~scoped_timer() {
+            if (m_target) {
+                m_target->record(clock::cycles() - m_start);
+            }
+        }
+
+    private:
+        counters *m_target;
+        std::uint64_t m_start;
+    };
+
+    /*
+     * A logger's statistics: per-thread counters, so recording is lock-free and contention-free.
+     * With a report interval, `report_due` returns true for a single caller once per interval.
+     */
+    template<std::size_t ReportIntervalMs>
+    struct recorder {
+        recorder() {
+            // Anchors the cycles frequency estimate (the first call sleeps briefly), rather than on the first snapshot
+            clock::reference_anchor();
+            m_next_report.store(clock::coarse_realtime_ns() + ReportIntervalMs * 1000000, std::memory_order_relaxed);
+        }
+
+        thread_stats& local() {
+            return m_threads.local();
+        }
+        void add_bytes(std::size_t len) {
+            local().line_bytes += len;
+        }
+        void record_line(std::size_t format_index, std::uint64_t cycles) {
+            auto& stats = local();
+            if (auto c = stats.find(format_index)) {
+                counters::bump(c->bytes, stats.line_bytes);
+                c->latency.record(cycles);
+            }
+            stats.line_bytes = 0;
+        }
+        scoped_timer time_flush() {
+            return scoped_timer(&local().flush_stalls);
+        }
+        scoped_timer time_rotation() {
+            return scoped_timer(&local().rotation_stalls);
+        }
+
+        bool report_due() {
+            auto now = clock::coarse_realtime_ns();
+            auto due = m_next_report.load(std::memory_order_relaxed);
+            return now >= due &&
+                m_next_report.compare_exchange_strong(due, now + ReportIntervalMs * 1000000, std::memory_order_relaxed);
+        }
+
+        snapshot take() {
+            auto frequency = clock::cycles_frequency(clock::reference_anchor(), clock::cycles_anchor::now());
+            double ns_per_cycle = (frequency > 0) ? (1e9 / static_cast<double>(frequency)) : (1);
+            snapshot result;
+            result.flush_stalls.ns_per_cycle = result.rotation_stalls.ns_per_cycle = ns_per_cycle;
+            std::vector<format_stats> by_index;
+            m_threads.for_each([&](thread_stats& stats) {
+                result.flush_stalls.add(stats.flush_stalls);
+                result.rotation_stalls.add(stats.rotation_stalls);
+                stats.for_each([&](std::size_t index, const format_counters& c) {
+                    if (c.latency.count.load(std::memory_order_relaxed) == 0) {
+                        return;
+                    }
+                    if (index >= by_index.size()) {
+                        by_index.resize(index + 1);
+                    }
+                    auto& format = by_index[index];
+                    format.latency.ns_per_cycle = ns_per_cycle;
+                    format.latency.add(c.latency);
+                    format.bytes += c.bytes.load(std::memory_order_relaxed);
+                });
+            });
+            auto& registry = format_registry::instance();
+            for (std::size_t i = 0; i < by_index.size(); i++) {
+                if (by_index[i].latency.count > 0) {
+                    by_index[i].format = registry.format(i);
+                    by_index[i].lines = by_index[i].latency.count;
+                    result.formats.push_back(by_index[i]);
+                }
+            }
+            std::stable_sort(result.formats.begin(), result.formats.end(), [](const format_stats& a, const format_stats& b) {
+                return a.bytes > b.bytes;
+            });
+            return result;
+        }
+
+    private:
+        per_thread::registry<thread_stats> m_threads;
+        std::atomic<std::uint64_t> m_next_report{0};
+    };
+
+    struct no_timer {
+        // Not trivial, so unused timers don't warn
+        ~no_timer() {}
+    };
+    // Without `Config::use_stats`, compiles to nothing
+    struct empty_recorder {
+        no_timer time_flush() {
+            return {};
+        }
+        no_timer time_rotation() {
+            return {};
+        }
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "format_parser.hpp"
 
 namespace llcpp::detail::string_format {
@@ -19,6 +21,19 @@ namespace llcpp::detail::string_format {
         static constexpr std::size_t args_size() {
             return _args_size;
         }
+        /*
+         * A stable identifier for this format (64bit FNV-1a of the format characters).
+         * Used in place of the format itself when the format dictionary is enabled.
+         * 0 is reserved for dictionary entries.
+         */
+        static constexpr std::uint64_t id() {
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            for (std::size_t i = 0; i < sizeof...(Chars); i++) {
+                hash ^= static_cast<std::uint8_t>(_chars[i]);
+                hash *= 0x100000001b3ULL;
+            }
+            return (hash == 0) ? (1) : (hash);
+        }
 
         static constexpr std::size_t _fmt_size = sizeof...(Chars) + 1;
         static constexpr std::size_t _args_size = format_parser::sum_arguments_size::value;
@@ -1,17 +1,81 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <string_view>
 
+#include "level.hpp"
+#include "objects.hpp"
 #include "utils.hpp"
+#include "varint.hpp"
 
 namespace llcpp::detail::terminators
 {
+    /*
+     * How an argument is encoded, derived from its conversion specification (the characters between the '%' and
+     *  the terminator). Shared by the argument_parsers and the decoder so the two can't disagree.
+     */
+    enum class value_kind
+    {
+        none,
+        percent,
+        signed_integer,
+        unsigned_integer,
+        hex_integer,
+        character,
+        string,
+        timestamp,
+        cycles,
+        level,
+        object,
+        floating,
+        pointer,
+    };
+    enum class value_encoding
+    {
+        fixed,
+        // A LEB128 varint in the record's variable size part (zigzag for signed integers), nothing in the fixed size part
+        varint,
+        // A zigzag varint of the difference from the timestamp base, see compact::t
+        timestamp_delta,
+    };
+
+    struct argument_layout
+    {
+        value_kind kind = value_kind::none;
+        // Bytes in the record's fixed size part
+        std::size_t size = 0;
+        // The fixed size part holds a 4 byte length, the data follows the record's fixed size part
+        //  (varints follow the fixed size part too, but without a length)
+        bool is_variable = false;
+        value_encoding encoding = value_encoding::fixed;
+    };
+
+    // The specification of an escape, as a constexpr string_view
+    template <typename FormatTuple, std::size_t Begin, std::size_t... I>
+    constexpr std::array<char, sizeof...(I) + 1> make_spec_chars(std::index_sequence<I...>)
+    {
+        return {{std::tuple_element<Begin + I, FormatTuple>::type::value..., '\0'}};
+    }
+    template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+    struct tuple_spec
+    {
+        static constexpr auto chars = make_spec_chars<FormatTuple, EscapeIdx + 1>(std::make_index_sequence<TerminatorIdx - EscapeIdx - 1>{});
+        static constexpr std::string_view value{chars.data(), TerminatorIdx - EscapeIdx - 1};
+    };
+
     template <typename CharT, CharT Char, typename ArgumentType = void>
     struct terminator
     {
         using char_type = CharT;
         static constexpr CharT terminator_value = Char;
 
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return {};
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         struct argument_parser
         {
@@ -34,6 +98,11 @@ namespace llcpp::detail::terminators
 
     struct pct_terminator : public terminator<char, '%'>
     {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return {value_kind::percent, 0, false};
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         struct argument_parser : public terminator<char, '%'>::argument_parser<FormatTuple, EscapeIdx, TerminatorIdx>
         {
@@ -55,33 +124,194 @@ namespace llcpp::detail::terminators
         static constexpr std::size_t count = 0;
     };
 
+    /*
+     * Integers are the size of the C type their length modifiers name: "%hhd" is a signed char, "%hd" a short,
+     *  "%d" an int, "%ld" a long (8 bytes on LP64) and "%lld" a long long.
+     * Like printf's arguments, anything up to an int is accepted by "%hhd" and "%hd" (i.e. a literal), and converted
+     *  to their type. Bigger integers must match the conversion's size.
+     */
     struct d : public terminator<char, 'd'>
     {
+        template <std::size_t NumOfL, std::size_t NumOfH>
+        using integer_type = std::conditional_t<
+            NumOfH == 2,
+            signed char,
+            std::conditional_t<
+                NumOfH == 1,
+                short,
+                std::conditional_t<
+                    NumOfL == 0,
+                    int,
+                    std::conditional_t<NumOfL == 1, long, long long>>>>;
+
+        static constexpr argument_layout integer_layout(std::string_view spec, value_kind kind)
+        {
+            std::size_t num_of_l = 0;
+            std::size_t num_of_h = 0;
+            for (auto ch : spec)
+            {
+                num_of_l += (ch == 'l') ? (1) : (0);
+                num_of_h += (ch == 'h') ? (1) : (0);
+            }
+            if (num_of_l > 2 || num_of_h > 2 || (num_of_l > 0 && num_of_h > 0))
+            {
+                return {};
+            }
+            std::size_t size = (num_of_h == 2) ? (sizeof(signed char)) :
+                (num_of_h == 1) ? (sizeof(short)) :
+                (num_of_l == 0) ? (sizeof(int)) :
+                (num_of_l == 1) ? (sizeof(long)) : (sizeof(long long));
+            return {kind, size, false};
+        }
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return integer_layout(spec, value_kind::signed_integer);
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         struct argument_parser
         {
             static constexpr bool is_fixed_size = true;
             static constexpr std::size_t num_of_l = tuple_counter<FormatTuple, char, 'l', EscapeIdx, TerminatorIdx>::count;
-            static_assert(num_of_l < 3, "Invalid conversion specifier");
-            static constexpr std::size_t argument_size = ((num_of_l == 0) ? (sizeof(std::uint32_t)) : (sizeof(std::uint32_t) * num_of_l));
-            using argument_type = typename std::conditional<
-                num_of_l == 0,
-                int,
-                typename std::conditional<
-                    num_of_l == 1,
-                    long,
-                    long long>::type>::type;
+            static constexpr std::size_t num_of_h = tuple_counter<FormatTuple, char, 'h', EscapeIdx, TerminatorIdx>::count;
+            static_assert(d::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).kind != value_kind::none,
+                        "Invalid conversion specifier");
+            static constexpr std::size_t argument_size = d::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).size;
+            using argument_type = integer_type<num_of_l, num_of_h>;
 
             template <typename Logger, typename Arg>
             static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
             {
                 static_assert(std::is_integral<Arg>::value,
                             "Integral argument's apply function called with non-integral value");
-                static_assert(argument_size >= sizeof(Arg),
+                static_assert(argument_size >= sizeof(Arg) || sizeof(Arg) <= sizeof(int),
                             "Discrepency detected between parsed argument_size and size of given arg, "
                             "you may need a specialized argument_parser");
                 argument_type tmp = static_cast<argument_type>(arg);
-                logger.write((std::uint8_t *)&tmp, sizeof(argument_type));
+                std::memcpy(dst, &tmp, argument_size);
+            }
+
+            template <typename Logger>
+            static void apply_variable(Logger& logger, const char *arg) {}
+        };
+    };
+    struct c : public terminator<char, 'c'>
+    {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return {value_kind::character, sizeof(char), false};
+        }
+
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr bool is_fixed_size = true;
+            static constexpr std::size_t argument_size = c::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).size;
+            using argument_type = char;
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
+            {
+                static_assert(std::is_integral<Arg>::value,
+                            "Character argument's apply function called with non-integral value");
+                *dst = static_cast<std::uint8_t>(arg);
+            }
+
+            template <typename Logger>
+            static void apply_variable(Logger& logger, const char *arg) {}
+        };
+    };
+    // "%v" stores a log level in a byte, the decoder shows its name (see log_level_prefix)
+    struct v : public terminator<char, 'v'>
+    {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return {value_kind::level, sizeof(std::uint8_t), false};
+        }
+
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr bool is_fixed_size = true;
+            static constexpr std::size_t argument_size = v::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).size;
+            using argument_type = std::uint8_t;
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
+            {
+                static_assert(std::is_same<Arg, logging::level::level_enum>::value,
+                            "Level argument's apply function called with a value that isn't a level");
+                *dst = static_cast<argument_type>(arg);
+            }
+
+            template <typename Logger>
+            static void apply_variable(Logger& logger, const char *arg) {}
+        };
+    };
+    /*
+     * 8 byte timestamps: "%t" is nanoseconds since the epoch, "%#t" is raw cycle counter (TSC) ticks
+     *  which the parser converts to wall time using the tsc_calibration meta records.
+     * Note that this makes "%td" unusable.
+     */
+    struct t : public terminator<char, 't'>
+    {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            // Not string_view::find, which GCC can't evaluate at compile time under -fsanitize=undefined
+            bool is_cycles = false;
+            for (auto ch : spec)
+            {
+                is_cycles = is_cycles || (ch == '#');
+            }
+            return {(is_cycles) ? (value_kind::cycles) : (value_kind::timestamp), sizeof(std::uint64_t), false};
+        }
+
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr bool is_fixed_size = true;
+            static constexpr std::size_t argument_size = t::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).size;
+            using argument_type = std::uint64_t;
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
+            {
+                static_assert(std::is_integral<Arg>::value,
+                            "Timestamp argument's apply function called with non-integral value");
+                argument_type tmp = static_cast<argument_type>(arg);
+                std::memcpy(dst, &tmp, argument_size);
             }
 
             template <typename Logger>
@@ -90,6 +320,11 @@ namespace llcpp::detail::terminators
     };
     struct u : public terminator<char, 'u'>
     {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return d::integer_layout(spec, value_kind::unsigned_integer);
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         struct argument_parser : public d::argument_parser<FormatTuple, EscapeIdx, TerminatorIdx>
         {
@@ -100,45 +335,147 @@ namespace llcpp::detail::terminators
     };
     struct x : public terminator<char, 'x'>
     {
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return d::integer_layout(spec, value_kind::hex_integer);
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         using argument_parser = d::argument_parser<FormatTuple, EscapeIdx, TerminatorIdx>;
     };
 
-    //HACK: There's probably a better way to do this
-    constexpr std::size_t pow(std::size_t base, std::size_t exp)
+    /*
+     * "%f", "%e" and "%g" (and "%lf", ...) store a double's 8 bytes, like printf which promotes floats, formatted by
+     *  the decoder (honouring the flags, width and precision of their specification).
+     * "%hf", "%he" and "%hg" store a float's 4 bytes instead, passing them a double is a compilation error rather
+     *  than a silent loss of precision.
+     */
+    template <char Conversion>
+    struct floating_point : public terminator<char, Conversion>
     {
-        std::size_t tmp = 1;
-        for (std::size_t i = 0; i < exp; i++)
+        static constexpr argument_layout layout(std::string_view spec)
         {
-            tmp *= base;
+            std::size_t num_of_l = 0;
+            std::size_t num_of_h = 0;
+            for (auto ch : spec)
+            {
+                if (ch == 'L')
+                {
+                    return {};
+                }
+                num_of_l += (ch == 'l') ? (1) : (0);
+                num_of_h += (ch == 'h') ? (1) : (0);
+            }
+            if (num_of_l + num_of_h > 1)
+            {
+                return {};
+            }
+            return {value_kind::floating, (num_of_h == 1) ? (sizeof(float)) : (sizeof(double)), false};
         }
-        return tmp;
-    }
 
-    //HACK: Should probably switch this to a constexpr function, just need to convert the tuple to a char array
-    template <typename FormatTuple, std::size_t Idx, std::size_t EndIdx>
-    struct tuple_atoi
-    {
-        using cur_char = typename std::tuple_element<Idx, FormatTuple>::type;
-        static_assert(cur_char::value >= '0' && cur_char::value <= '9', "tuple_atoi encountered a non-digit character");
-        static constexpr std::size_t exp = EndIdx - Idx;
-        static constexpr std::size_t value = pow(10, exp - 1) * (cur_char::value - '0') + tuple_atoi<FormatTuple, Idx + 1, EndIdx>::value;
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr argument_layout _layout = layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value);
+            static_assert(_layout.kind == value_kind::floating, "Invalid floating point conversion specifier, expected %f or %hf");
+            static constexpr bool is_fixed_size = true;
+            static constexpr std::size_t argument_size = _layout.size;
+            using argument_type = std::conditional_t<argument_size == sizeof(float), float, double>;
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
+            {
+                static_assert(std::is_arithmetic<Arg>::value,
+                            "Floating point argument's apply function called with non-arithmetic value");
+                static_assert(!std::is_floating_point<Arg>::value || sizeof(Arg) <= argument_size,
+                            "Discrepency between the argument and a float conversion, use %f for doubles");
+                argument_type tmp = static_cast<argument_type>(arg);
+                std::memcpy(dst, &tmp, argument_size);
+            }
+
+            template <typename Logger>
+            static void apply_variable(Logger& logger, const char *arg) {}
+        };
     };
-    template <typename FormatTuple, std::size_t EndIdx>
-    struct tuple_atoi<FormatTuple, EndIdx, EndIdx>
+    using f = floating_point<'f'>;
+    using e = floating_point<'e'>;
+    using g = floating_point<'g'>;
+
+    // "%p" stores the pointer's value, shown like printf shows it
+    struct p : public terminator<char, 'p'>
     {
-        static constexpr std::size_t value = 0;
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            return {value_kind::pointer, sizeof(std::uintptr_t), false};
+        }
+
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr bool is_fixed_size = true;
+            static constexpr std::size_t argument_size = p::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).size;
+            using argument_type = const void *;
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store(tmp, arg);
+                logger.write(tmp, argument_size);
+            }
+
+            template <typename Arg>
+            static void store(std::uint8_t *dst, const Arg arg)
+            {
+                static_assert(std::is_pointer<Arg>::value || std::is_null_pointer<Arg>::value,
+                            "Pointer argument's apply function called with non-pointer value");
+                auto tmp = reinterpret_cast<std::uintptr_t>(static_cast<const void *>(arg));
+                std::memcpy(dst, &tmp, argument_size);
+            }
+
+            template <typename Logger>
+            static void apply_variable(Logger& logger, const char *arg) {}
+        };
     };
 
     struct s : public terminator<char, 's'>
     {
         using variable_string_length_type = std::uint32_t;
 
+        // "%s" is a variable size string, "%<N>s" is a fixed size string of N bytes
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            if (spec.empty())
+            {
+                return {value_kind::string, sizeof(variable_string_length_type), true};
+            }
+            std::size_t size = 0;
+            for (auto ch : spec)
+            {
+                if (ch < '0' || ch > '9')
+                {
+                    return {};
+                }
+                size = size * 10 + (ch - '0');
+            }
+            return {value_kind::string, size, false};
+        }
+
         template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
         struct argument_parser
         {
-            static constexpr std::size_t argument_size = ((EscapeIdx + 1 == TerminatorIdx) ? (sizeof(variable_string_length_type)) : (tuple_atoi<FormatTuple, EscapeIdx + 1, TerminatorIdx>::value));
-            static constexpr bool is_fixed_size = (EscapeIdx + 1 != TerminatorIdx);
+            static constexpr argument_layout _layout = s::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value);
+            static_assert(_layout.kind == value_kind::string, "Invalid string conversion specifier, expected %s or %<size>s");
+            static constexpr std::size_t argument_size = _layout.size;
+            static constexpr bool is_fixed_size = !_layout.is_variable;
 
             using argument_type = typename std::conditional<
                 is_fixed_size,
@@ -187,9 +524,242 @@ namespace llcpp::detail::terminators
                         logger.write((std::uint8_t *)arg, std::strlen(arg));
                     }
             }
+
+            static void store(std::uint8_t *dst, const char *arg)
+            {
+                static_assert(is_fixed_size, "Variable size strings are stored with store_variable");
+                auto end = static_cast<const char *>(std::memchr(arg, '\0', argument_size));
+                std::size_t len = (end) ? (end - arg) : (argument_size);
+                std::memcpy(dst, arg, len);
+                std::memset(dst + len, 0, argument_size - len);
+            }
+
+            static std::size_t variable_size(const char *arg)
+            {
+                return std::strlen(arg);
+            }
+            static void store_variable(std::uint8_t *dst, std::uint8_t *variable_dst, const char *arg, std::size_t size)
+            {
+                variable_string_length_type len = static_cast<variable_string_length_type>(size);
+                std::memcpy(dst, &len, sizeof(len));
+                std::memcpy(variable_dst, arg, size);
+            }
+        };
+    };
+
+    /*
+     * "%T" copies a trivially copyable object whole, its type described by an `llcpp::serializer` (see objects.hpp).
+     * The fixed size part holds the object's size and its schema's id, the object follows it like a "%s" string's
+     *  characters. The logger writes the type's schema the first time it's logged (see `prepare`).
+     */
+    struct T : public terminator<char, 'T'>
+    {
+        using object_size_type = s::variable_string_length_type;
+
+        static constexpr argument_layout layout(std::string_view spec)
+        {
+            if (!spec.empty())
+            {
+                return {};
+            }
+            return {value_kind::object, sizeof(object_size_type) + sizeof(std::uint64_t), true};
+        }
+
+        // Any type converts, the argument_parser checks it has a serializer
+        struct any_object
+        {
+            template <typename Arg>
+            any_object(const Arg&) {}
+        };
+
+        template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+        struct argument_parser
+        {
+            static constexpr argument_layout _layout = T::layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value);
+            static_assert(_layout.kind == value_kind::object, "Invalid object conversion specifier, expected %T");
+            static constexpr std::size_t argument_size = _layout.size;
+            static constexpr bool is_fixed_size = false;
+            using argument_type = any_object;
+
+            template <typename Arg>
+            static void check()
+            {
+                static_assert(objects::has_serializer<Arg>::value,
+                            "Objects logged with %T need an llcpp::serializer specialization");
+                static_assert(std::is_trivially_copyable<Arg>::value, "Objects logged with %T must be trivially copyable");
+            }
+
+            // Writes the type's schema, once per logger, before the record
+            template <typename Logger, typename Arg>
+            static auto prepare(Logger& logger, const Arg& arg) -> decltype(logger.template register_schema<Arg>())
+            {
+                check<Arg>();
+                logger.template register_schema<Arg>();
+            }
+
+            template <typename Logger, typename Arg>
+            static void apply(Logger& logger, const Arg& arg)
+            {
+                std::uint8_t tmp[argument_size];
+                store_header<Arg>(tmp);
+                logger.write(tmp, argument_size);
+            }
+            template <typename Logger, typename Arg>
+            static void apply_variable(Logger& logger, const Arg& arg)
+            {
+                logger.write(reinterpret_cast<const std::uint8_t *>(&arg), sizeof(Arg));
+            }
+
+            template <typename Arg>
+            static std::size_t variable_size(const Arg& arg)
+            {
+                return sizeof(Arg);
+            }
+            template <typename Arg>
+            static void store_variable(std::uint8_t *dst, std::uint8_t *variable_dst, const Arg& arg, std::size_t size)
+            {
+                store_header<Arg>(dst);
+                std::memcpy(variable_dst, &arg, sizeof(Arg));
+            }
+
+        private:
+            template <typename Arg>
+            static void store_header(std::uint8_t *dst)
+            {
+                check<Arg>();
+                object_size_type size = sizeof(Arg);
+                std::uint64_t id = objects::schema_of<Arg>().id;
+                std::memcpy(dst, &size, sizeof(size));
+                std::memcpy(dst + sizeof(size), &id, sizeof(id));
+            }
         };
     };
 
+    /*
+     * Compact encodings of the integer and timestamp terminators (see `config_with_compact_encoding`).
+     * Their values are varints written after the record's fixed size part, in argument order along with
+     *  variable size strings, so small values take a byte or two instead of 4 or 8.
+     */
+    namespace compact
+    {
+        template <typename Integer>
+        struct varint_integer : public terminator<char, Integer::terminator_value>
+        {
+            static constexpr argument_layout layout(std::string_view spec)
+            {
+                auto fixed = Integer::layout(spec);
+                if (fixed.kind == value_kind::none)
+                {
+                    return fixed;
+                }
+                return {fixed.kind, 0, true, value_encoding::varint};
+            }
+
+            template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+            struct argument_parser
+            {
+                using fixed_parser = typename Integer::template argument_parser<FormatTuple, EscapeIdx, TerminatorIdx>;
+                using argument_type = typename fixed_parser::argument_type;
+                static constexpr bool is_fixed_size = false;
+                static constexpr std::size_t argument_size = 0;
+                static constexpr bool is_signed =
+                    layout(tuple_spec<FormatTuple, EscapeIdx, TerminatorIdx>::value).kind == value_kind::signed_integer;
+
+                template <typename Arg>
+                static std::uint64_t encoded_value(const Arg arg)
+                {
+                    static_assert(std::is_integral<Arg>::value,
+                                "Integral argument's apply function called with non-integral value");
+                    static_assert(fixed_parser::argument_size >= sizeof(Arg) || sizeof(Arg) <= sizeof(int),
+                                "Discrepency detected between parsed argument_size and size of given arg, "
+                                "you may need a specialized argument_parser");
+                    argument_type value = static_cast<argument_type>(arg);
+                    if constexpr(is_signed)
+                    {
+                        return varint::zigzag(value);
+                    }
+                    else
+                    {
+                        return static_cast<std::make_unsigned_t<argument_type>>(value);
+                    }
+                }
+
+                template <typename Logger, typename Arg>
+                static void apply(Logger& logger, const Arg arg) {}
+                template <typename Logger, typename Arg>
+                static void apply_variable(Logger& logger, const Arg arg)
+                {
+                    std::uint8_t tmp[varint::max_size];
+                    logger.write(tmp, varint::encode(tmp, encoded_value(arg)));
+                }
+
+                template <typename Arg>
+                static std::size_t variable_size(const Arg arg)
+                {
+                    return varint::size(encoded_value(arg));
+                }
+                template <typename Arg>
+                static void store_variable(std::uint8_t *dst, std::uint8_t *variable_dst, const Arg arg, std::size_t size)
+                {
+                    varint::encode(variable_dst, encoded_value(arg));
+                }
+            };
+        };
+        using d = varint_integer<terminators::d>;
+        using u = varint_integer<terminators::u>;
+        using x = varint_integer<terminators::x>;
+
+        /*
+         * Timestamps are written as the difference from the logger's timestamp base (`timestamp_base()`), which is the
+         *  last timestamp of the previous record in the same buffer. The parser keeps the same base while decoding.
+         */
+        struct t : public terminator<char, 't'>
+        {
+            static constexpr argument_layout layout(std::string_view spec)
+            {
+                return {terminators::t::layout(spec).kind, 0, true, value_encoding::timestamp_delta};
+            }
+
+            template <typename FormatTuple, std::size_t EscapeIdx, std::size_t TerminatorIdx>
+            struct argument_parser
+            {
+                using argument_type = std::uint64_t;
+                static constexpr bool is_fixed_size = false;
+                static constexpr std::size_t argument_size = 0;
+
+                template <typename Logger, typename Arg>
+                static std::uint64_t encoded_value(Logger& logger, const Arg arg)
+                {
+                    static_assert(std::is_integral<Arg>::value,
+                                "Timestamp argument's apply function called with non-integral value");
+                    return varint::zigzag(static_cast<std::int64_t>(static_cast<argument_type>(arg) - logger.timestamp_base()));
+                }
+
+                template <typename Logger, typename Arg>
+                static void apply(Logger& logger, const Arg arg) {}
+                template <typename Logger, typename Arg>
+                static void apply_variable(Logger& logger, const Arg arg)
+                {
+                    std::uint8_t tmp[varint::max_size];
+                    logger.write(tmp, varint::encode(tmp, encoded_value(logger, arg)));
+                    logger.set_next_timestamp_base(static_cast<argument_type>(arg));
+                }
+
+                template <typename Logger, typename Arg>
+                static std::size_t variable_size(Logger& logger, const Arg arg)
+                {
+                    return varint::size(encoded_value(logger, arg));
+                }
+                template <typename Logger, typename Arg>
+                static void store_variable(Logger& logger, std::uint8_t *dst, std::uint8_t *variable_dst, const Arg arg, std::size_t size)
+                {
+                    varint::encode(variable_dst, encoded_value(logger, arg));
+                    logger.set_next_timestamp_base(static_cast<argument_type>(arg));
+                }
+            };
+        };
+    }
+
     template <typename TerminatorTuple, typename CharT, CharT Char, std::size_t Idx, std::size_t TerminatorTupleSize>
     struct search_terminators_impl
     {
@@ -227,7 +797,8 @@ namespace llcpp::detail::terminators
         using search_terminators_t = typename search_terminators<TerminatorTuple, CharT, Char>::type;
     };
 
-    using builtin_terminator_tuple = std::tuple<d, u, x, s, pct_terminator>;
+    using builtin_terminator_tuple = std::tuple<d, u, x, s, c, v, t, T, f, e, g, p, pct_terminator>;
+    using compact_terminator_tuple = std::tuple<compact::d, compact::u, compact::x, s, c, v, compact::t, T, f, e, g, p, pct_terminator>;
 
     template<typename Config>
     using terminator_tuple_from_config = utils::tuple_cat_t<typename Config::terminator_tuple, typename Config::additional_terminators>;
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace llcpp::detail::varint {
+    // LEB128: 7 bits per byte, least significant group first, the high bit set on all but the last byte
+    constexpr std::size_t max_size = 10;
+
+    // Maps signed values to unsigned ones so that small magnitudes stay small: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+    constexpr std::uint64_t zigzag(std::int64_t value) {
+        return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    }
+    constexpr std::int64_t unzigzag(std::uint64_t value) {
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+
+    inline std::size_t size(std::uint64_t value) {
+        return 1 + (63 - __builtin_clzll(value | 1)) / 7;
+    }
+    // Writes `size(value)` bytes
+    inline std::size_t encode(std::uint8_t *dst, std::uint64_t value) {
+        std::size_t len = 0;
+        while (value >= 0x80) {
+            dst[len++] = static_cast<std::uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        dst[len++] = static_cast<std::uint8_t>(value);
+        return len;
+    }
+    // Returns the number of bytes read, 0 if the varint is truncated or too long
+    inline std::size_t decode(const std::uint8_t *src, std::size_t len, std::uint64_t& value) {
+        value = 0;
+        for (std::size_t i = 0; i < len && i < max_size; i++) {
+            value |= static_cast<std::uint64_t>(src[i] & 0x7f) << (7 * i);
+            if (!(src[i] & 0x80)) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+}
@@ -3,9 +3,15 @@
 #include "detail/config.hpp"
 #include "detail/prefix.hpp"
 #include "detail/logging.hpp"
+#include "detail/async_logging.hpp"
+#include "detail/mmap_logging.hpp"
+#include "detail/ring_logging.hpp"
+#include "detail/shm_logging.hpp"
+#include "detail/socket_logging.hpp"
 
 namespace llcpp {
     using default_config = detail::config::default_config;
+    using level = detail::logging::level;
 
     template<typename PrefixTuple, typename Derived, typename Config = default_config>
     using logger_base = detail::logging::logger_base<PrefixTuple, Derived, Config>;
@@ -16,6 +22,38 @@ namespace llcpp {
     template<typename PrefixTuple, typename Config = default_config>
     using vector_logger = detail::logging::vector_logger<PrefixTuple, Config>;
 
+    using stdio_writer = detail::file_writer::stdio_writer;
+    template<std::size_t BufferSize = 64 * 1024, std::size_t BufferCount = 8>
+    using writev_writer = detail::file_writer::writev_writer<BufferSize, BufferCount>;
+    template<std::size_t BufferSize = 64 * 1024, std::size_t BufferCount = 8>
+    using uring_writer = detail::file_writer::uring_writer<BufferSize, BufferCount>;
+
+    using rotation_policy = detail::rotation::policy;
+
+    using full_ring_policy = detail::logging::full_ring_policy;
+    template<typename PrefixTuple, typename Config = default_config,
+        full_ring_policy Policy = full_ring_policy::block, std::size_t RingSize = 64 * 1024>
+    using async_file_logger = detail::logging::async_file_logger<PrefixTuple, Config, Policy, RingSize>;
+
+    using mmap_sync_policy = detail::logging::mmap_sync_policy;
+    template<typename PrefixTuple, typename Config = default_config,
+        std::size_t ChunkSize = 64 * 1024 * 1024, mmap_sync_policy SyncPolicy = mmap_sync_policy::none>
+    using mmap_file_logger = detail::logging::mmap_file_logger<PrefixTuple, Config, ChunkSize, SyncPolicy>;
+
+    template<typename PrefixTuple, typename Config = default_config>
+    using ring_logger = detail::logging::ring_logger<PrefixTuple, Config>;
+
+    template<typename PrefixTuple, typename Config = default_config, full_ring_policy Policy = full_ring_policy::drop>
+    using shm_logger = detail::logging::shm_logger<PrefixTuple, Config, Policy>;
+    // Merges the lines of shm_loggers into a single framed log, see tools/llcpp_collect.cpp
+    template<typename Config = default_config>
+    using shm_collector = detail::shm_transport::collector<Config>;
+
+    template<typename PrefixTuple, typename Config = default_config, full_ring_policy Policy = full_ring_policy::drop>
+    using socket_logger = detail::logging::socket_logger<PrefixTuple, Config, Policy>;
+    // Writes what socket_loggers send to a single framed log, see tools/llcpp_receive.cpp
+    using socket_receiver = detail::socket_transport::receiver;
+
     using prefix_base = detail::prefix::prefix_base;
 
     using gmtime_prefix = detail::prefix::time_format_prefix<false>;
@@ -24,10 +62,40 @@ namespace llcpp {
     using time_format_prefix = detail::prefix::time_format_prefix<UseLocalTime>;
     using log_level_prefix = detail::prefix::log_level_prefix;
     using nanosec_time_prefix = detail::prefix::nanosec_time_prefix;
+    using coarse_time_prefix = detail::prefix::coarse_time_prefix;
+    using tsc_time_prefix = detail::prefix::tsc_time_prefix;
 
     using default_logger = file_logger<std::tuple<log_level_prefix, time_format_prefix<true>>>;
 
     using builtin_terminator_tuple = detail::terminators::builtin_terminator_tuple;
+    using compact_terminator_tuple = detail::terminators::compact_terminator_tuple;
+
+    // Codecs for config_with_compression: compression::lz, and compression::zstd<Level> with LLCPP_USE_ZSTD
+    namespace compression = detail::compression;
+
+    // Recovery of the lines a crashed file_logger with config_with_crash_buffer left in its buffers
+    using crash_recovery = detail::crash_buffer::recovery;
+    using detail::crash_buffer::recover;
+
+
+}
 
+/*
+ * Log a line only if `lvl` (trace, debug, info, warn, err or critical) is enabled for `logger`.
+ * Unlike calling `logger.debug(...)` directly, the arguments are not evaluated when the level is disabled:
+ *  LLCPP_DEBUG(logger, "queue depth %d"_log, expensive_depth());
+ */
+#define LLCPP_LOG(logger, lvl, ...)                                                     \
+    do {                                                                                \
+        auto& _llcpp_logger = (logger);                                                 \
+        if (_llcpp_logger.template should_log<::llcpp::level::lvl>()) {                 \
+            _llcpp_logger.template log_unchecked<::llcpp::level::lvl>(__VA_ARGS__);     \
+        }                                                                               \
+    } while (0)
 
-}
\ No newline at end of file
+#define LLCPP_TRACE(logger, ...) LLCPP_LOG(logger, trace, __VA_ARGS__)
+#define LLCPP_DEBUG(logger, ...) LLCPP_LOG(logger, debug, __VA_ARGS__)
+#define LLCPP_INFO(logger, ...) LLCPP_LOG(logger, info, __VA_ARGS__)
+#define LLCPP_WARN(logger, ...) LLCPP_LOG(logger, warn, __VA_ARGS__)
+#define LLCPP_ERR(logger, ...) LLCPP_LOG(logger, err, __VA_ARGS__)
+#define LLCPP_CRITICAL(logger, ...) LLCPP_LOG(logger, critical, __VA_ARGS__)
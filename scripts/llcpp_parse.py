@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 import sys
 import struct
+import datetime
 
 class terminator(object):
     terminator = None
@@ -14,6 +15,8 @@ class terminator(object):
         raise NotImplemented()
     def read_variable_arg(self, fmt, stream):
         raise NotImplemented()
+    def resolve(self, context):
+        pass
 
 class integer_terminator(terminator):
     terminator = None
@@ -59,6 +62,62 @@ class p(d):
     is_unsigned = True
     #TODO: Format as hex
 
+class c(terminator):
+    terminator = "c"
+
+    def read_arg(self, fmt, stream):
+        self.value = stream.read(1)
+
+    def read_variable_arg(self, fmt, stream):
+        pass
+
+    def __repr__(self):
+        return "Character terminator. Escape {}-{}. Value {}".format(
+            self.escape_begin, self.escape_end, self.value)
+
+class v(terminator):
+    terminator = "v"
+    names = ["TRACE", "DEBUG", "INFO", "WARN", "ERR", "CRITICAL"]
+
+    def read_arg(self, fmt, stream):
+        level = struct.unpack("<B", stream.read(1))[0]
+        self.value = self.names[level] if level < len(self.names) else level
+
+    def read_variable_arg(self, fmt, stream):
+        pass
+
+    def __repr__(self):
+        return "Level terminator. Escape {}-{}. Value {}".format(
+            self.escape_begin, self.escape_end, self.value)
+
+def format_timestamp(ns):
+    t = datetime.datetime(1970, 1, 1) + datetime.timedelta(seconds=ns // 10**9)
+    return '{}.{:09d}Z'.format(t.strftime('%Y-%m-%dT%H:%M:%S'), ns % 10**9)
+
+class t(terminator):
+    """
+    %t is nanoseconds since the epoch, %#t is cycles which are converted using the last tsc_calibration.
+    """
+    terminator = "t"
+
+    def read_arg(self, fmt, stream):
+        self.is_cycles = '#' in fmt[self.escape_begin + 1: self.escape_end - 1]
+        self.raw = struct.unpack("<Q", stream.read(8))[0]
+        self.value = self.raw
+
+    def read_variable_arg(self, fmt, stream):
+        pass
+
+    def resolve(self, context):
+        ns = self.raw
+        if self.is_cycles:
+            ns = context.cycles_to_ns(self.raw)
+        self.value = format_timestamp(ns) if ns is not None else '{} cycles'.format(self.raw)
+
+    def __repr__(self):
+        return "Timestamp terminator. Escape {}-{}. Value {}".format(
+            self.escape_begin, self.escape_end, self.value)
+
 class s(terminator):
     terminator = "s"
 
@@ -89,24 +148,80 @@ class s(terminator):
             return 'String terminator. Escape: {}-{}. Fixed size {}. Variable Length {}. Value {}'.format(
                 self.escape_begin, self.escape_end, self.fixed_size, self.variable_len, self.value)
 
-terminators = [d, u, x, s, p]
+terminators = [d, u, x, s, c, v, t, p]
+
+class parser_context(object):
+    """
+    State collected from meta records (records whose format starts with '\\x01').
+    """
+    meta_prefix = '\x01'
+
+    def __init__(self):
+        self.tsc_calibration = None
+
+    def handle_meta(self, fmt, terminator_list):
+        name = fmt[len(self.meta_prefix):].split(' ')[0]
+        values = [term.value for term in terminator_list]
+        if name == 'tsc_calibration':
+            self.tsc_calibration = values
+
+    def cycles_to_ns(self, cycles):
+        if self.tsc_calibration is None or self.tsc_calibration[2] == 0:
+            return None
+        anchor_cycles, anchor_ns, frequency = self.tsc_calibration
+        return anchor_ns + (cycles - anchor_cycles) * 10**9 // frequency
+
+class format_dictionary(object):
+    """
+    Maps format ids to formats for logs written with `config_with_format_dictionary`.
+    Each record starts with an 8 byte format id. An id of 0 marks a dictionary entry:
+    the id it defines followed by the null terminated format.
+    """
+    marker = 0
+
+    def __init__(self):
+        self.formats = {}
+
+    def read_id(self, stream):
+        id_data = stream.read(8)
+        if len(id_data) < 8:
+            raise StopIteration()
+        return struct.unpack("<Q", id_data)[0]
+
+    def read_fmt(self, stream):
+        while True:
+            fmt_id = self.read_id(stream)
+            if fmt_id != self.marker:
+                break
+            fmt_id = self.read_id(stream)
+            self.formats[fmt_id] = read_null_terminated(stream)
+
+        if fmt_id not in self.formats:
+            raise ValueError("Unknown format id: {:#x}".format(fmt_id))
+        return self.formats[fmt_id]
+
+def read_null_terminated(stream):
+    chars = []
+    while True:
+        c = stream.read(1)
+        if not c:
+            raise StopIteration()
+        if c == '\0':
+            break
+        chars.append(c)
+    return ''.join(chars)
 
 class log_line(object):
-    def __init__(self, stream):
+    def __init__(self, stream, context, dictionary=None):
         self.stream = stream
+        self.context = context
+        self.dictionary = dictionary
         self.line = ""
 
     def read_fmt(self):
-        chars = []
-        while True:
-            c = self.stream.read(1)
-            if not c:
-                raise StopIteration()
-            if c == '\0':
-                break
-            chars.append(c)
-        fmt = ''.join(chars)
-        return fmt
+        if self.dictionary is not None:
+            return self.dictionary.read_fmt(self.stream)
+        return read_null_terminated(self.stream)
 
     def parse_fmt(self, fmt):
         terminator_list = []
@@ -146,6 +261,14 @@ class log_line(object):
         
         for term in terminator_list:
             term.read_variable_arg(fmt, self.stream)
+
+        if fmt.startswith(parser_context.meta_prefix):
+            self.context.handle_meta(fmt, terminator_list)
+            self.line = ''
+            return
+
+        for term in terminator_list:
+            term.resolve(self.context)
             
         line_parts = []
         last_escape_end = 0
@@ -170,10 +293,17 @@ class log_line(object):
 class llcpp_parser(object):
     def __init__(self, stream):
         self.stream = stream
+        self.context = parser_context()
+        self.dictionary = None
+        # A log written with a format dictionary always starts with a dictionary entry
+        start = self.stream.tell()
+        if self.stream.read(8) == struct.pack("<Q", format_dictionary.marker):
+            self.dictionary = format_dictionary()
+        self.stream.seek(start)
 
     def lines(self):
         while True:
-            line = log_line(self.stream)
+            line = log_line(self.stream, self.context, self.dictionary)
             line.parse()
             yield str(line)
 
@@ -0,0 +1,1039 @@
+/*
+ * Round trips: each test logs known lines with a logger and checks what comes out of the log, either raw or decoded
+ *  with llcpp::decoder (which must give exactly what printf would have written).
+ * usage: llcpp_round_trip <test>, see `tests` below (CTest runs each of them).
+ */
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "llcpp/llcpp.hpp"
+#include "llcpp/decoder.hpp"
+
+// Logged with "%T": one of each field kind, and a field the decoder isn't told about
+namespace objects {
+    enum class side : std::uint8_t { buy = 1, sell = 2 };
+    struct order {
+        std::uint64_t id;
+        double price;
+        std::int32_t quantity;
+        side direction;
+        bool filled;
+        char venue;
+        char symbol[8];
+        std::uint16_t checksum[2];
+        std::uint32_t unlisted;
+    };
+    struct cancel {
+        std::uint64_t order_id;
+        std::int16_t reason;
+    };
+}
+template<> struct llcpp::serializer<objects::order> {
+    static constexpr const char *name = "order";
+    static constexpr auto fields = std::make_tuple(llcpp::field("id", &objects::order::id),
+        llcpp::field("price", &objects::order::price), llcpp::field("quantity", &objects::order::quantity),
+        llcpp::field("side", &objects::order::direction), llcpp::field("filled", &objects::order::filled),
+        llcpp::field("venue", &objects::order::venue), llcpp::field("symbol", &objects::order::symbol),
+        llcpp::field("checksum", &objects::order::checksum));
+};
+template<> struct llcpp::serializer<objects::cancel> {
+    static constexpr const char *name = "cancel";
+    static constexpr auto fields = std::make_tuple(llcpp::field("order_id", &objects::cancel::order_id),
+        llcpp::field("reason", &objects::cancel::reason));
+};
+
+namespace {
+    bool fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+    bool fail(const char *fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        std::vfprintf(stderr, fmt, args);
+        va_end(args);
+        std::fputc('\n', stderr);
+        return false;
+    }
+
+    std::string read_file(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // Lines logged as "%s" of "<line N>" show up as is in the log: the N of each of them, in the log's order
+    std::vector<int> line_numbers(const std::string& log) {
+        static constexpr char marker[] = "<line ";
+        std::vector<int> numbers;
+        for (auto pos = log.find(marker); pos != std::string::npos; pos = log.find(marker, pos + 1)) {
+            numbers.push_back(std::atoi(log.c_str() + pos + sizeof(marker) - 1));
+        }
+        return numbers;
+    }
+    struct numbered_line {
+        explicit numbered_line(int n) {
+            std::snprintf(text, sizeof(text), "<line %d>", n);
+        }
+        const char *c_str() const {
+            return text;
+        }
+        char text[32];
+    };
+    template<typename Logger>
+    void log_numbered_line(Logger& logger, int n) {
+        logger.info("%s"_log, numbered_line(n).c_str());
+    }
+    bool same_lines(const std::vector<int>& numbers, const std::vector<int>& expected) {
+        if (numbers != expected) {
+            std::string got, want;
+            for (auto n : numbers) {
+                got += " " + std::to_string(n);
+            }
+            for (auto n : expected) {
+                want += " " + std::to_string(n);
+            }
+            return fail("lines:%s, expected:%s", got.c_str(), want.c_str());
+        }
+        return true;
+    }
+
+    std::string printf_string(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+    std::string printf_string(const char *fmt, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        std::vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return buf;
+    }
+
+    // Decodes the whole log, calling `on_record` for each record, false if it didn't decode to its end
+    template<typename DecoderConfig = llcpp::default_config, typename OnRecord>
+    bool decode_records(const std::string& path, OnRecord&& on_record) {
+        llcpp::mapped_file file(path);
+        if (!file.is_open()) {
+            return fail("can't read %s", path.c_str());
+        }
+        llcpp::decoder<DecoderConfig> decoder(file.data(), file.size());
+        llcpp::record rec;
+        while (decoder.next(rec)) {
+            on_record(rec);
+        }
+        if (decoder.error() || decoder.skipped_bytes() > 0) {
+            return fail("%s: %s at offset %llu, %llu bytes skipped", path.c_str(), (decoder.error()) ? (decoder.error()) : ("no error"),
+                static_cast<unsigned long long>(decoder.position()), static_cast<unsigned long long>(decoder.skipped_bytes()));
+        }
+        return true;
+    }
+    std::vector<std::string> split_lines(const std::string& text) {
+        std::vector<std::string> lines;
+        for (std::size_t pos = 0; pos < text.size();) {
+            auto end = text.find('\n', pos);
+            end = (end == std::string::npos) ? (text.size()) : (end);
+            lines.emplace_back(text, pos, end - pos);
+            pos = end + 1;
+        }
+        return lines;
+    }
+    // Appends the log's lines to `lines`. Plain logs are decoded with the logger's config (i.e. compact encoding)
+    template<typename DecoderConfig = llcpp::default_config>
+    bool decode(const std::string& path, std::vector<std::string>& lines) {
+        std::string text;
+        if (!decode_records<DecoderConfig>(path, [&](const llcpp::record& rec) { llcpp::append_text(text, rec); })) {
+            return false;
+        }
+        auto log = split_lines(text);
+        lines.insert(lines.end(), log.begin(), log.end());
+        return true;
+    }
+    // In order unless `sorted`, lines of different threads interleave
+    bool compare(std::vector<std::string> lines, std::vector<std::string> expected, bool sorted = false) {
+        if (sorted) {
+            std::sort(lines.begin(), lines.end());
+            std::sort(expected.begin(), expected.end());
+        }
+        for (std::size_t i = 0; i < std::max(lines.size(), expected.size()); i++) {
+            if (i >= lines.size() || i >= expected.size() || lines[i] != expected[i]) {
+                return fail("line %zu of %zu (expected %zu):\n  got      %s\n  expected %s", i, lines.size(), expected.size(),
+                    (i < lines.size()) ? (lines[i].c_str()) : ("<none>"), (i < expected.size()) ? (expected[i].c_str()) : ("<none>"));
+            }
+        }
+        return true;
+    }
+
+    // Lines using every terminator, with the level prefix
+    template<typename Logger>
+    void log_lines(Logger& logger, int i) {
+        logger.info("int %d unsigned %u hex %x string %s char %c|"_log, -i, i, 255 + i, "abc", 'z');
+        logger.warn("long %lld %lld %llx|"_log, -5000000000LL - i, 1LL << 40, 0xabcdefULL);
+        logger.err("fixed [%8s]"_log, "fixedstring");
+    }
+    std::vector<std::string> expected_lines(int count, int first = 0) {
+        std::vector<std::string> lines;
+        for (int i = first; i < first + count; i++) {
+            lines.push_back(printf_string("[INFO]int %d unsigned %u hex %x string %s char %c|", -i, i, 255 + i, "abc", 'z'));
+            lines.push_back(printf_string("[WARN]long %lld %lld %llx|", -5000000000LL - i, 1LL << 40, 0xabcdefULL));
+            lines.push_back("[ERR]fixed [fixedstr]");
+        }
+        return lines;
+    }
+    using prefix_t = std::tuple<llcpp::log_level_prefix>;
+    template<typename Logger, typename DecoderConfig = llcpp::default_config>
+    bool single_thread_test(const std::string& path) {
+        constexpr int count = 200;
+        {
+            Logger logger(path);
+            for (int i = 0; i < count; i++) {
+                log_lines(logger, i);
+            }
+        }
+        std::vector<std::string> lines;
+        return decode<DecoderConfig>(path, lines) && compare(lines, expected_lines(count));
+    }
+    template<typename Config>
+    bool file_logger_test(const std::string& path) {
+        return single_thread_test<llcpp::file_logger<prefix_t, Config>, Config>(path);
+    }
+    // `threads` threads log `count` iterations each (from `first` on), concurrently
+    template<typename Logger>
+    void log_concurrently(Logger& logger, int threads, int count, int first = 0) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&logger, t, count, first] {
+                for (int i = first + t * count; i < first + (t + 1) * count; i++) {
+                    log_lines(logger, i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Waves of threads that exit while the logger lives on, each flushing its buffer and handing it to the next wave
+    template<typename Config>
+    bool file_logger_threads_test(const std::string& path) {
+        constexpr int waves = 3;
+        constexpr int threads = 4;
+        constexpr int count = 300;
+        {
+            llcpp::file_logger<prefix_t, Config> logger(path);
+            for (int wave = 0; wave < waves; wave++) {
+                log_concurrently(logger, threads, count, wave * threads * count);
+            }
+        }
+        std::vector<std::string> lines;
+        return decode<Config>(path, lines) && compare(lines, expected_lines(waves * threads * count), true);
+    }
+
+    // Small chunks, so that the records cross a few of them
+    using mmap_logger = llcpp::mmap_file_logger<prefix_t, llcpp::default_config, 64 * 1024>;
+    bool mmap_threads_test(const std::string& path) {
+        constexpr int threads = 4;
+        constexpr int count = 500;
+        {
+            mmap_logger logger(path);
+            log_concurrently(logger, threads, count);
+        }
+        std::vector<std::string> lines;
+        return decode(path, lines) && compare(lines, expected_lines(threads * count), true);
+    }
+    // Records past the maximum size are dropped and counted (a shorter one may still fit), the others are all there in order
+    bool mmap_full_test(const std::string& path) {
+        constexpr int count = 2000;
+        std::uint64_t dropped = 0;
+        {
+            mmap_logger logger(path, {}, 64 * 1024);
+            for (int i = 0; i < count; i++) {
+                log_lines(logger, i);
+            }
+            dropped = logger.dropped();
+        }
+        std::vector<std::string> lines;
+        if (!decode(path, lines)) {
+            return false;
+        }
+        if (dropped == 0 || lines.size() + dropped != 3 * count) {
+            return fail("%zu lines written and %llu dropped, out of %d", lines.size(), static_cast<unsigned long long>(dropped), 3 * count);
+        }
+        auto expected = expected_lines(count);
+        auto next = expected.begin();
+        for (auto& line : lines) {
+            next = std::find(next, expected.end(), line);
+            if (next == expected.end()) {
+                return fail("unexpected line: %s", line.c_str());
+            }
+            ++next;
+        }
+        return true;
+    }
+    // A process that dies without destroying the logger leaves a zeroed tail, decoded as the end of the log
+    bool mmap_crash_test(const std::string& path) {
+        constexpr int count = 10;
+        auto pid = ::fork();
+        if (pid == 0) {
+            auto logger = new mmap_logger(path);
+            for (int i = 0; i < count; i++) {
+                log_lines(*logger, i);
+            }
+            std::_Exit(0);
+        }
+        int status = 0;
+        if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+            return fail("the logging process didn't run");
+        }
+        std::vector<std::string> lines;
+        return decode(path, lines) && compare(lines, expected_lines(count));
+    }
+
+    // Lines split into framed blocks (a few dozen lines each) over a few coarse clock ticks, so blocks' first timestamps differ
+    using small_blocks_config = llcpp::default_config::config_with_framing<true, 1024>;
+    void log_in_blocks(const std::string& path, int count) {
+        llcpp::file_logger<prefix_t, small_blocks_config> logger(path);
+        for (int i = 0; i < count; i++) {
+            log_lines(logger, i);
+            if (i % 20 == 19) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+    // Decoding from a block found in the index, by offset and by time, gives the lines from that block on
+    bool framed_seek_test(const std::string& path) {
+        constexpr int count = 200;
+        log_in_blocks(path, count);
+        llcpp::mapped_file file(path);
+        if (!file.is_open()) {
+            return fail("can't read %s", path.c_str());
+        }
+        auto expected = expected_lines(count);
+        auto decode_from = [&](llcpp::decoder<>& decoder, const llcpp::framing::index_entry& block) {
+            // The lines of the data blocks before it are skipped
+            std::size_t skipped = 0;
+            for (auto& entry : decoder.block_index()) {
+                if (entry.offset < block.offset && entry.flags == llcpp::framing::data_block) {
+                    skipped += entry.record_count;
+                }
+            }
+            std::string text;
+            llcpp::record rec;
+            for (bool first = true; decoder.next(rec); first = false) {
+                if (first && decoder.current_block().offset != block.offset) {
+                    return fail("decoding starts at block %llu instead of %llu",
+                        static_cast<unsigned long long>(decoder.current_block().offset), static_cast<unsigned long long>(block.offset));
+                }
+                llcpp::append_text(text, rec);
+            }
+            return !decoder.error() && compare(split_lines(text), std::vector<std::string>(expected.begin() + skipped, expected.end()));
+        };
+
+        llcpp::decoder<> decoder(file.data(), file.size());
+        auto& index = decoder.block_index();
+        if (!decoder.is_framed() || index.size() < 10) {
+            return fail("%zu blocks in the index", index.size());
+        }
+        auto& middle = index[index.size() / 2];
+        if (!decoder.seek(middle.offset) || !decode_from(decoder, middle)) {
+            return fail("seeking to block %llu", static_cast<unsigned long long>(middle.offset));
+        }
+        // The first block of a later tick
+        auto later = std::find_if(index.begin(), index.end(), [&](const llcpp::framing::index_entry& entry) {
+            return entry.first_timestamp > index.front().first_timestamp;
+        });
+        if (later == index.end()) {
+            return fail("all blocks have the same timestamp");
+        }
+        llcpp::decoder<> time_decoder(file.data(), file.size());
+        if (!time_decoder.seek_time(later->first_timestamp) || !decode_from(time_decoder, *later)) {
+            return fail("seeking to %llu", static_cast<unsigned long long>(later->first_timestamp));
+        }
+        return true;
+    }
+
+    /*
+     * Threads write lines of varying sizes straight to a file_writer with small buffers, so that lines cross buffers:
+     *  each line must reach the file whole, and each thread's lines in order.
+     */
+    template<typename Writer>
+    bool file_writer_test(const std::string& path) {
+        constexpr int threads = 4;
+        constexpr int lines = 2000;
+        auto line_text = [](int n) {
+            return std::string(numbered_line(n).c_str()) + std::string(n % 97, 'x') + "\n";
+        };
+        {
+            std::unique_ptr<std::FILE, int(*)(std::FILE*)> fp(std::fopen(path.c_str(), "w"), std::fclose);
+            if (!fp) {
+                return fail("can't open %s", path.c_str());
+            }
+            Writer writer(fp.get());
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&writer, &line_text, t] {
+                    for (int i = t * lines; i < (t + 1) * lines; i++) {
+                        auto text = line_text(i);
+                        writer.write(reinterpret_cast<const std::uint8_t *>(text.data()), text.size());
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+        auto log = split_lines(read_file(path));
+        std::vector<int> last(threads, -1);
+        for (auto& line : log) {
+            auto numbers = line_numbers(line);
+            auto n = (numbers.size() == 1) ? (numbers[0]) : (-1);
+            if (n < 0 || n >= threads * lines || line + "\n" != line_text(n)) {
+                return fail("torn line: %s", line.c_str());
+            }
+            if (n <= last[n / lines]) {
+                return fail("line %d is out of order", n);
+            }
+            last[n / lines] = n;
+        }
+        return log.size() == threads * lines || fail("%zu lines out of %d", log.size(), threads * lines);
+    }
+    // The same through file_logger, decoded
+    template<typename Writer>
+    bool file_logger_writer_test(const std::string& path) {
+        return file_logger_test<llcpp::default_config::config_with_file_writer<Writer>>(path);
+    }
+    using small_uring_writer = llcpp::uring_writer<4 * 1024, 4>;
+    using small_writev_writer = llcpp::writev_writer<4 * 1024, 4>;
+
+    using compressed_config = llcpp::default_config::config_with_format_dictionary<>::config_with_framing<>::
+        config_with_compact_encoding<>::config_with_compression<llcpp::compression::lz>;
+
+    /*
+     * Rotated files each decode on their own (with the dictionary entries and calibration written again), and together
+     *  hold every line in order. With an interval, the lines are spread over a few of them.
+     */
+    template<typename Config>
+    bool rotation_test(const std::string& path, const llcpp::rotation_policy& rotation, int count, std::size_t min_files) {
+        for (std::size_t idx = 1; std::remove((path + "." + std::to_string(idx)).c_str()) == 0; idx++) {}
+        {
+            llcpp::file_logger<prefix_t, Config> logger(path, rotation);
+            for (int i = 0; i < count; i++) {
+                log_lines(logger, i);
+                if (rotation.interval.count() > 0 && i % 100 == 99) {
+                    std::this_thread::sleep_for(rotation.interval / 2);
+                }
+            }
+        }
+        std::vector<std::string> lines;
+        std::size_t files = 0;
+        for (auto name = path; std::ifstream(name).good(); name = path + "." + std::to_string(++files)) {
+            if (!decode<Config>(name, lines)) {
+                return false;
+            }
+        }
+        if (files < min_files) {
+            return fail("%zu files, expected at least %zu", files, min_files);
+        }
+        return compare(lines, expected_lines(count));
+    }
+    llcpp::rotation_policy size_rotation() {
+        llcpp::rotation_policy rotation;
+        rotation.max_size = 32 * 1024;
+        return rotation;
+    }
+    llcpp::rotation_policy interval_rotation() {
+        llcpp::rotation_policy rotation;
+        rotation.interval = std::chrono::milliseconds(20);
+        return rotation;
+    }
+
+    // A dump holds the most recent lines, with the dictionary entries of formats last used before them; dumping doesn't consume the ring
+    bool ring_dump_test(const std::string& path) {
+        constexpr int count = 2000;
+        using dictionary_config = llcpp::default_config::config_with_format_dictionary<>;
+        llcpp::ring_logger<prefix_t, dictionary_config> logger(64 * 1024);
+        for (int i = 0; i < count; i++) {
+            log_lines(logger, i);
+        }
+        std::vector<std::string> first, second;
+        if (!logger.dump(path) || !decode(path, first) || !logger.dump(path) || !decode(path, second)) {
+            return fail("can't dump to %s", path.c_str());
+        }
+        if (first.empty() || first.size() + logger.dropped() != 3 * count) {
+            return fail("%zu lines dumped and %llu dropped, out of %d", first.size(), static_cast<unsigned long long>(logger.dropped()),
+                3 * count);
+        }
+        auto expected = expected_lines(count);
+        return compare(first, std::vector<std::string>(expected.end() - first.size(), expected.end())) && compare(second, first);
+    }
+
+    // Lines left in the buffers of a process that died without flushing are recovered into its log
+    bool crash_recover_test(const std::string& path) {
+        constexpr int count = 10;
+        using crash_config = llcpp::default_config::config_with_framing<>::config_with_crash_buffer<>;
+        auto pid = ::fork();
+        if (pid == 0) {
+            auto logger = new llcpp::file_logger<prefix_t, crash_config>(path);
+            for (int i = 0; i < count; i++) {
+                log_lines(*logger, i);
+            }
+            std::_Exit(0);
+        }
+        int status = 0;
+        if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+            return fail("the logging process didn't run");
+        }
+        auto recovery = llcpp::recover(path);
+        if (recovery.error) {
+            return fail("can't recover %s: %s", path.c_str(), recovery.error);
+        }
+        std::vector<std::string> lines;
+        return decode<crash_config>(path, lines) && compare(lines, expected_lines(count), true);
+    }
+
+    // Lines of many processes collected into one log, each preceded by its process's pid, in order per process
+    template<typename Config = llcpp::default_config>
+    bool collector_test(const std::string& path) {
+        constexpr int processes = 3;
+        constexpr int count = 300;
+        auto name = "/llcpp_round_trip_" + std::to_string(::getpid());
+        std::vector<pid_t> pids;
+        {
+            llcpp::shm_collector<Config> collector(name, path);
+            if (!collector.is_open()) {
+                return fail("can't create %s", name.c_str());
+            }
+            for (int p = 0; p < processes; p++) {
+                auto pid = ::fork();
+                if (pid == 0) {
+                    llcpp::shm_logger<prefix_t, Config, llcpp::full_ring_policy::block> logger(name);
+                    for (int i = 0; i < count; i++) {
+                        log_lines(logger, p * count + i);
+                    }
+                    std::_Exit((logger.is_open()) ? (0) : (1));
+                }
+                pids.push_back(pid);
+            }
+            for (std::size_t exited = 0; exited < pids.size();) {
+                if (collector.poll() == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                int status = 0;
+                auto pid = ::waitpid(-1, &status, WNOHANG);
+                if (pid < 0 || (pid > 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))) {
+                    return fail("a logging process didn't attach or run");
+                }
+                exited += (pid > 0) ? (1) : (0);
+            }
+        }
+        std::vector<std::string> lines;
+        if (!decode<Config>(path, lines)) {
+            return false;
+        }
+        std::vector<std::vector<std::string>> by_process(processes);
+        for (auto& line : lines) {
+            auto end = line.find(']');
+            auto it = std::find(pids.begin(), pids.end(), std::atoi(line.c_str() + 1));
+            if (line[0] != '[' || end == std::string::npos || it == pids.end()) {
+                return fail("no pid before %s", line.c_str());
+            }
+            by_process[it - pids.begin()].push_back(line.substr(end + 1));
+        }
+        for (int p = 0; p < processes; p++) {
+            if (!compare(by_process[p], expected_lines(count, p * count))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A blocked producer stops waiting for a collector that died (leaving its region behind), and drops its lines
+    bool collector_gone_test(const std::string& path) {
+        constexpr int count = 1000;
+        auto name = "/llcpp_round_trip_" + std::to_string(::getpid());
+        auto pid = ::fork();
+        if (pid == 0) {
+            llcpp::shm_collector<>::options opts;
+            opts.ring_size = 4096;
+            new llcpp::shm_collector<>(name, path, opts);
+            std::_Exit(0);
+        }
+        int status = 0;
+        if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+            return fail("the collecting process didn't run");
+        }
+        std::uint64_t dropped = 0;
+        {
+            llcpp::shm_logger<prefix_t, llcpp::default_config, llcpp::full_ring_policy::block> logger(name);
+            if (!logger.is_open()) {
+                ::shm_unlink(name.c_str());
+                return fail("can't attach to %s", name.c_str());
+            }
+            for (int i = 0; i < count; i++) {
+                log_lines(logger, i);
+            }
+            dropped = logger.dropped();
+        }
+        ::shm_unlink(name.c_str());
+        if (dropped == 0) {
+            return fail("no line dropped");
+        }
+        return true;
+    }
+
+    // A line at the flush level reaches the file before the call returns, with the lines before it; lines below it wait
+    template<typename Config = llcpp::default_config>
+    bool flush_level_test(const std::string& path) {
+        llcpp::file_logger<prefix_t, typename Config::template config_with_flush_policy<>> logger(path);
+        log_numbered_line(logger, 0);
+        if (!same_lines(line_numbers(read_file(path)), {})) {
+            return false;
+        }
+        logger.err("%s"_log, numbered_line(1).c_str());
+        log_numbered_line(logger, 2);
+        return same_lines(line_numbers(read_file(path)), {0, 1});
+    }
+    // The line that ends once the buffer's first line is older than the flush interval flushes it
+    bool flush_interval_test(const std::string& path) {
+        llcpp::file_logger<prefix_t, llcpp::default_config::config_with_flush_policy<llcpp::level::off, 20>> logger(path);
+        log_numbered_line(logger, 0);
+        log_numbered_line(logger, 1);
+        if (!same_lines(line_numbers(read_file(path)), {})) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        log_numbered_line(logger, 2);
+        log_numbered_line(logger, 3);
+        return same_lines(line_numbers(read_file(path)), {0, 1, 2});
+    }
+
+    // Every thread's lines are counted under their format, with their bytes and a latency for each call
+    bool stats_test(const std::string& path) {
+        constexpr int threads = 4;
+        constexpr int count = 300;
+        llcpp::file_logger<prefix_t, llcpp::default_config::config_with_stats<>> logger(path);
+        log_concurrently(logger, threads, count);
+        auto snapshot = logger.stats_snapshot();
+        if (snapshot.formats.size() != 3) {
+            return fail("%zu formats counted, expected 3", snapshot.formats.size());
+        }
+        for (std::size_t i = 0; i < snapshot.formats.size(); i++) {
+            auto& format = snapshot.formats[i];
+            if (format.lines != threads * count || format.latency.count != format.lines ||
+                    format.bytes < format.lines * format.format.size() || format.latency.max_ns == 0) {
+                return fail("%s: %llu lines, %llu bytes, %llu calls timed", format.format.data(),
+                    static_cast<unsigned long long>(format.lines), static_cast<unsigned long long>(format.bytes),
+                    static_cast<unsigned long long>(format.latency.count));
+            }
+            if (i > 0 && format.bytes > snapshot.formats[i - 1].bytes) {
+                return fail("formats aren't sorted by bytes");
+            }
+        }
+        // 4KB buffers
+        if (snapshot.flush_stalls.count == 0) {
+            return fail("no flush stall counted");
+        }
+        return true;
+    }
+    // Reports go in the log as info lines, between the logged lines
+    bool stats_report_test(const std::string& path) {
+        constexpr int count = 1000;
+        {
+            llcpp::file_logger<prefix_t, llcpp::default_config::config_with_stats<true, 10>> logger(path);
+            for (int i = 0; i < count; i++) {
+                log_lines(logger, i);
+                if (i % 100 == 99) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(15));
+                }
+            }
+        }
+        std::vector<std::string> lines, logged;
+        if (!decode(path, lines)) {
+            return false;
+        }
+        static constexpr char report[] = "[INFO]llcpp stats: ";
+        std::size_t reports = 0;
+        for (auto& line : lines) {
+            if (line.compare(0, sizeof(report) - 1, report) == 0) {
+                reports++;
+            } else {
+                logged.push_back(line);
+            }
+        }
+        if (reports == 0) {
+            return fail("no stats report in the log");
+        }
+        return compare(logged, expected_lines(count));
+    }
+
+    // Sampled lines are logged as their policy admits them, the first one after skipped calls with their count
+    bool sampling_test(const std::string& path) {
+        {
+            llcpp::file_logger<prefix_t> logger(path);
+            for (int i = 0; i < 10; i++) {
+                logger.log_every_n<llcpp::level::info, 3>("every %d"_log, i);
+                logger.log_first_n<llcpp::level::warn, 2>("first %d"_log, i);
+                logger.log_per_interval<llcpp::level::err, 2, 100>("interval %d"_log, i);
+            }
+            // Past the time a token takes to come back, on the coarse clock
+            std::this_thread::sleep_for(std::chrono::milliseconds(80));
+            logger.log_per_interval<llcpp::level::err, 2, 100>("interval %d"_log, 10);
+        }
+        std::vector<std::string> lines;
+        return decode(path, lines) && compare(lines, {
+            "[INFO]every 0", "[WARN]first 0", "[ERR]interval 0",
+            "[WARN]first 1", "[ERR]interval 1",
+            "[INFO][2 suppressed] every 3",
+            "[INFO][2 suppressed] every 6",
+            "[INFO][2 suppressed] every 9",
+            "[ERR][8 suppressed] interval 10",
+        });
+    }
+
+    // Objects decode to their fields by name, as text and as JSON, each type's schema written once
+    template<typename Config = llcpp::default_config>
+    bool object_test(const std::string& path) {
+        constexpr int count = 3;
+        {
+            llcpp::file_logger<prefix_t, Config> logger(path);
+            for (int i = 0; i < count; i++) {
+                objects::order o{static_cast<std::uint64_t>(42 + i), 101.25, -7 * i, (i % 2) ? (objects::side::sell) : (objects::side::buy),
+                    i == 1, 'X', "AAPL", {0xab, 0x1234}, 0xdeadbeef};
+                logger.info("filled %T"_log, o);
+                logger.warn("cancel %T of %d"_log, objects::cancel{o.id, -1}, i);
+            }
+        }
+        std::vector<std::string> lines;
+        if (!decode<Config>(path, lines) || !compare(lines, {
+                "[INFO]filled order{id=42, price=101.25, quantity=0, side=1, filled=false, venue=X, symbol=AAPL, checksum=ab003412}",
+                "[WARN]cancel cancel{order_id=42, reason=-1} of 0",
+                "[INFO]filled order{id=43, price=101.25, quantity=-7, side=2, filled=true, venue=X, symbol=AAPL, checksum=ab003412}",
+                "[WARN]cancel cancel{order_id=43, reason=-1} of 1",
+                "[INFO]filled order{id=44, price=101.25, quantity=-14, side=1, filled=false, venue=X, symbol=AAPL, checksum=ab003412}",
+                "[WARN]cancel cancel{order_id=44, reason=-1} of 2",
+            })) {
+            return false;
+        }
+        std::string json, scratch;
+        bool decoded = decode_records<Config>(path, [&](const llcpp::record& rec) {
+            if (json.empty()) {
+                llcpp::append_json(json, rec, scratch);
+            }
+        });
+        return decoded && compare(split_lines(json), {
+            "{\"format\":\"[%v]filled %T\\n\",\"args\":[\"INFO\",{\"id\":42,\"price\":101.25,\"quantity\":0,\"side\":1,"
+            "\"filled\":false,\"venue\":\"X\",\"symbol\":\"AAPL\",\"checksum\":\"ab003412\"}],\"text\":\"[INFO]filled "
+            "order{id=42, price=101.25, quantity=0, side=1, filled=false, venue=X, symbol=AAPL, checksum=ab003412}\"}"});
+    }
+
+    // Floating point, pointer and sized integer arguments decode to what printf writes for them
+    template<typename Config = llcpp::default_config>
+    bool types_test(const std::string& path) {
+        constexpr int count = 50;
+        int local = 0;
+        const void *pointers[] = {nullptr, &local, reinterpret_cast<const void *>(std::uintptr_t{0x1000})};
+        std::vector<std::string> expected;
+        {
+            llcpp::file_logger<prefix_t, Config> logger(path);
+            for (int i = 0; i < count; i++) {
+                double d = (i - 25) * 1234.5678;
+                float f = static_cast<float>(i) / 3;
+                logger.info("%f %.3e %10.2g %lf|"_log, d, d / 1e6, d, 1.0 / (i + 1));
+                expected.push_back(printf_string("[INFO]%f %.3e %10.2g %lf|", d, d / 1e6, d, 1.0 / (i + 1)));
+                logger.info("%hf %-8.1he %hg|"_log, f, f * 100, f);
+                expected.push_back(printf_string("[INFO]%f %-8.1e %g|", double{f}, double{f * 100}, double{f}));
+                logger.warn("%ld %lu %lx|"_log, -3000000000L * i, 4000000000UL + i, 0xdeadbeefUL * i);
+                expected.push_back(printf_string("[WARN]%ld %lu %lx|", -3000000000L * i, 4000000000UL + i, 0xdeadbeefUL * i));
+                logger.warn("%hd %hu %hx %hhd %hhu %hhx|"_log, 300 * i - 7000, 600 * i, 1000 * i, i * 7 - 100, i * 9, i * 5);
+                expected.push_back(printf_string("[WARN]%hd %hu %hx %hhd %hhu %hhx|", 300 * i - 7000, 600 * i, 1000 * i, i * 7 - 100, i * 9, i * 5));
+                logger.err("%p|"_log, pointers[i % 3]);
+                expected.push_back(printf_string("[ERR]%p|", pointers[i % 3]));
+            }
+        }
+        std::vector<std::string> lines;
+        return decode<Config>(path, lines) && compare(lines, expected);
+    }
+
+    // Waves of threads send their lines to a receiver (each thread's batch sent as it exits), which writes them to one log
+    template<typename Config = llcpp::default_config>
+    bool socket_test(const std::string& path, const char *kind) {
+        constexpr int waves = 3;
+        constexpr int threads = 4;
+        constexpr int count = 300;
+        constexpr std::uint64_t total = 3 * waves * threads * count;
+        auto spec = std::string(kind) + ":" + path + ".sock";
+        {
+            llcpp::socket_receiver receiver(spec, path);
+            if (!receiver.is_open()) {
+                return fail("can't listen on %s", spec.c_str());
+            }
+            std::thread sender([&spec] {
+                llcpp::socket_logger<prefix_t, Config, llcpp::full_ring_policy::block> logger(spec);
+                for (int wave = 0; wave < waves; wave++) {
+                    log_concurrently(logger, threads, count, wave * threads * count);
+                }
+            });
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (receiver.lines() < total && std::chrono::steady_clock::now() < deadline) {
+                receiver.poll(std::chrono::milliseconds(10));
+            }
+            sender.join();
+        }
+        std::vector<std::string> lines;
+        return decode<Config>(path, lines) && compare(lines, expected_lines(waves * threads * count), true);
+    }
+
+    // Cycle counts decode to wall time: in order, and within the run give or take the calibration's error
+    template<typename Config = llcpp::default_config>
+    bool tsc_test(const std::string& path) {
+        constexpr int lines = 50;
+        constexpr std::uint64_t slack_ns = 5000000;
+        auto now_ns = [] {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        };
+        auto start = now_ns();
+        {
+            using tsc_prefix_t = std::tuple<llcpp::tsc_time_prefix>;
+            llcpp::file_logger<tsc_prefix_t, Config> logger(path, tsc_prefix_t(std::chrono::milliseconds(10)));
+            for (int i = 0; i < lines; i++) {
+                // Spread over a few calibrations
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                log_numbered_line(logger, i);
+            }
+        }
+        auto end = now_ns();
+        std::vector<std::uint64_t> timestamps;
+        bool converted = true;
+        auto decoded = decode_records<Config>(path, [&](const llcpp::record& rec) {
+            std::uint64_t ns;
+            converted = converted && rec.timestamp_value(0, ns);
+            timestamps.push_back(ns);
+        });
+        if (!decoded) {
+            return false;
+        }
+        if (!converted) {
+            return fail("a record precedes the first calibration");
+        }
+        if (timestamps.size() != lines) {
+            return fail("%zu lines out of %d", timestamps.size(), lines);
+        }
+        for (std::size_t i = 0; i < timestamps.size(); i++) {
+            if (timestamps[i] + slack_ns < start || timestamps[i] > end + slack_ns) {
+                return fail("line %zu at %llu, outside of the run [%llu, %llu]", i, static_cast<unsigned long long>(timestamps[i]),
+                    static_cast<unsigned long long>(start), static_cast<unsigned long long>(end));
+            }
+            if (i > 0 && timestamps[i] < timestamps[i - 1]) {
+                return fail("line %zu is %llu ns before the previous one", i,
+                    static_cast<unsigned long long>(timestamps[i - 1] - timestamps[i]));
+            }
+        }
+        return true;
+    }
+
+    /*
+     * `threads` threads log `lines` numbered lines each. Every line is either in the log or counted by `dropped()`,
+     *  each thread's lines are in order, and unless the policy is `block` the ring is small enough for some to be dropped.
+     */
+    template<llcpp::full_ring_policy Policy, std::size_t RingSize>
+    bool async_test(const std::string& path, int threads, int lines, std::chrono::microseconds poll_interval) {
+        std::uint64_t dropped = 0;
+        {
+            llcpp::async_file_logger<std::tuple<>, llcpp::default_config, Policy, RingSize> logger(path, {}, poll_interval);
+            if (!logger.is_open()) {
+                return fail("can't open %s", path.c_str());
+            }
+            // Threads stay alive until all of them are done, so that none takes over the ring of one that exited
+            std::mutex mutex;
+            std::condition_variable cv;
+            int done = 0;
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&, t] {
+                    for (int i = t * lines; i < (t + 1) * lines; i++) {
+                        log_numbered_line(logger, i);
+                    }
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done++;
+                    cv.notify_all();
+                    cv.wait(lock, [&] { return done == threads; });
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            dropped = logger.dropped();
+        }
+        auto numbers = line_numbers(read_file(path));
+        std::vector<int> last(threads, -1);
+        for (auto n : numbers) {
+            if (n < 0 || n >= threads * lines || n <= last[n / lines]) {
+                return fail("line %d is out of order", n);
+            }
+            last[n / lines] = n;
+        }
+        if (numbers.size() + dropped != static_cast<std::size_t>(threads * lines)) {
+            return fail("%zu lines written and %llu dropped, out of %d", numbers.size(), static_cast<unsigned long long>(dropped),
+                threads * lines);
+        }
+        if ((Policy == llcpp::full_ring_policy::block) != (dropped == 0)) {
+            return fail("%llu lines dropped", static_cast<unsigned long long>(dropped));
+        }
+        // Overwriting drops the oldest lines, never a thread's last one
+        if constexpr(Policy == llcpp::full_ring_policy::overwrite) {
+            for (int t = 0; t < threads; t++) {
+                if (last[t] != (t + 1) * lines - 1) {
+                    return fail("thread %d's last line is %d", t, last[t]);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Records serialized into a span reserved in a vector are the bytes file_logger writes
+    bool vector_test(const std::string& path) {
+        constexpr int lines = 1000;
+        std::vector<std::uint8_t> vec;
+        {
+            llcpp::vector_logger<std::tuple<>> vector_logger(vec);
+            llcpp::file_logger<std::tuple<>> file_logger(path);
+            for (int i = 0; i < lines; i++) {
+                log_numbered_line(vector_logger, i);
+                log_numbered_line(file_logger, i);
+            }
+        }
+        auto log = read_file(path);
+        if (log.size() != vec.size() || std::memcmp(log.data(), vec.data(), vec.size()) != 0) {
+            return fail("%zu bytes in the vector, %zu in the file", vec.size(), log.size());
+        }
+        return line_numbers(log).size() == lines || fail("%zu lines out of %d", line_numbers(log).size(), lines);
+    }
+
+    // Lines below the compile time or the runtime level aren't logged, and the macros don't evaluate their arguments then
+    bool level_test(const std::string& path) {
+        const numbered_line lines[] = {numbered_line(0), numbered_line(1), numbered_line(2), numbered_line(3),
+            numbered_line(4), numbered_line(5), numbered_line(6)};
+        int evaluated = 0;
+        auto counted = [&](int n) {
+            evaluated++;
+            return lines[n].c_str();
+        };
+        {
+            llcpp::file_logger<std::tuple<>, llcpp::default_config::config_with_min_level<llcpp::level::debug>> logger(path);
+            logger.trace("%s"_log, lines[0].c_str());
+            logger.debug("%s"_log, lines[1].c_str());
+            logger.set_level(llcpp::level::warn);
+            logger.info("%s"_log, lines[2].c_str());
+            logger.warn("%s"_log, lines[3].c_str());
+            LLCPP_INFO(logger, "%s"_log, counted(4));
+            LLCPP_ERR(logger, "%s"_log, counted(5));
+            LLCPP_TRACE(logger, "%s"_log, counted(6));
+            if (logger.get_level() != llcpp::level::warn || logger.should_log<llcpp::level::info>() ||
+                    !logger.should_log(llcpp::level::err) || logger.should_log(llcpp::level::trace)) {
+                return fail("should_log doesn't match the levels");
+            }
+        }
+        if (evaluated != 1) {
+            return fail("%d disabled lines' arguments were evaluated", evaluated - 1);
+        }
+        return same_lines(line_numbers(read_file(path)), {1, 3, 5});
+    }
+
+    const std::vector<std::pair<const char *, std::function<bool(const std::string&)>>> tests = {
+        {"async_block", [](const std::string& path) {
+            return async_test<llcpp::full_ring_policy::block, 4 * 1024>(path, 4, 5000, std::chrono::microseconds(100));
+        }},
+        // The writer sleeps long enough for the small rings to fill up
+        {"async_drop", [](const std::string& path) {
+            return async_test<llcpp::full_ring_policy::drop, 4 * 1024>(path, 2, 20000, std::chrono::milliseconds(20));
+        }},
+        {"async_overwrite", [](const std::string& path) {
+            return async_test<llcpp::full_ring_policy::overwrite, 4 * 1024>(path, 2, 20000, std::chrono::milliseconds(20));
+        }},
+        {"vector", vector_test},
+        {"level", level_test},
+        {"plain", file_logger_test<llcpp::default_config>},
+        {"dictionary", file_logger_test<llcpp::default_config::config_with_format_dictionary<>>},
+        {"tsc", tsc_test<>},
+        {"framed", file_logger_test<small_blocks_config>},
+        {"framed_seek", framed_seek_test},
+        {"mmap", single_thread_test<mmap_logger>},
+        {"mmap_threads", mmap_threads_test},
+        {"mmap_full", mmap_full_test},
+        {"mmap_crash", mmap_crash_test},
+        {"uring_writer", file_writer_test<small_uring_writer>},
+        {"writev_writer", file_writer_test<small_writev_writer>},
+        {"uring_logger", file_logger_writer_test<small_uring_writer>},
+        {"writev_logger", file_logger_writer_test<small_writev_writer>},
+        {"threads", file_logger_threads_test<llcpp::default_config>},
+        {"framed_threads", file_logger_threads_test<small_blocks_config>},
+        {"per_cpu", file_logger_threads_test<llcpp::default_config::config_with_per_cpu_buffers<>>},
+        {"framed_per_cpu", file_logger_threads_test<small_blocks_config::config_with_per_cpu_buffers<>>},
+        {"compact", file_logger_test<llcpp::default_config::config_with_compact_encoding<>>},
+        {"framed_compact", file_logger_threads_test<small_blocks_config::config_with_compact_encoding<>>},
+        {"compressed", file_logger_test<compressed_config>},
+        {"compressed_threads", file_logger_threads_test<compressed_config>},
+        {"rotation", [](const std::string& path) {
+            return rotation_test<llcpp::default_config>(path, size_rotation(), 4000, 10);
+        }},
+        {"rotation_dictionary", [](const std::string& path) {
+            return rotation_test<compressed_config>(path, size_rotation(), 4000, 2);
+        }},
+        {"rotation_interval", [](const std::string& path) {
+            return rotation_test<llcpp::default_config::config_with_framing<>>(path, interval_rotation(), 1000, 3);
+        }},
+        {"ring_dump", ring_dump_test},
+        {"crash_recover", crash_recover_test},
+        {"collector", collector_test<>},
+        {"collector_dictionary", collector_test<llcpp::default_config::config_with_format_dictionary<>>},
+        {"collector_gone", collector_gone_test},
+        {"socket", [](const std::string& path) {
+            return socket_test(path, "unix");
+        }},
+        {"socket_datagram", [](const std::string& path) {
+            return socket_test<llcpp::default_config::config_with_format_dictionary<>>(path, "unixgram");
+        }},
+        {"flush_level", flush_level_test<>},
+        {"framed_flush_level", flush_level_test<small_blocks_config>},
+        {"flush_interval", flush_interval_test},
+        {"stats", stats_test},
+        {"stats_report", stats_report_test},
+        {"sampling", sampling_test},
+        {"object", object_test<>},
+        {"object_framed", object_test<compressed_config>},
+        {"types", types_test<>},
+        {"types_compact", types_test<llcpp::default_config::config_with_compact_encoding<>>},
+        {"framed_types", types_test<small_blocks_config>},
+        {"tsc_compact", tsc_test<small_blocks_config::config_with_compact_encoding<>>},
+    };
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <test>\n", argv[0]);
+        return 2;
+    }
+    for (auto& [name, test] : tests) {
+        if (std::strcmp(name, argv[1]) == 0) {
+            auto path = std::string("round_trip_") + name + ".log";
+            if (!test(path)) {
+                std::fprintf(stderr, "%s failed\n", name);
+                return 1;
+            }
+            return 0;
+        }
+    }
+    std::fprintf(stderr, "%s: no test named %s\n", argv[0], argv[1]);
+    return 2;
+}
@@ -0,0 +1,74 @@
+/*
+ * Collect the logs of many processes (written with shm_logger) into a single framed log.
+ * usage: llcpp_collect [--producers N] [--ring-size BYTES] [--block-size BYTES] [--poll-us US] <shm name> <log file>
+ * Creates the shared memory region `<shm name>` (i.e. /llcpp) for up to --producers processes at a time, each with a
+ *  ring of --ring-size bytes, and drains the rings every --poll-us microseconds when idle.
+ * Runs until SIGINT or SIGTERM, then collects what's left, writes the log's index and removes the region.
+ * Producers must use default_config's terminators, see llcpp::shm_collector for others.
+ */
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "llcpp/llcpp.hpp"
+
+namespace {
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void on_signal(int) {
+        g_stop = 1;
+    }
+
+    int usage(const char *argv0) {
+        std::fprintf(stderr, "usage: %s [--producers N] [--ring-size BYTES] [--block-size BYTES] [--poll-us US] <shm name> <log file>\n",
+            argv0);
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    llcpp::shm_collector<>::options opts;
+    auto poll_interval = std::chrono::microseconds(1000);
+    const char *name = nullptr;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--producers") == 0 && i + 1 < argc) {
+            opts.producers = static_cast<std::uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--ring-size") == 0 && i + 1 < argc) {
+            opts.ring_size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--block-size") == 0 && i + 1 < argc) {
+            opts.block_size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--poll-us") == 0 && i + 1 < argc) {
+            poll_interval = std::chrono::microseconds(std::strtoull(argv[++i], nullptr, 10));
+        } else if (argv[i][0] != '-' && !name) {
+            name = argv[i];
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!name || !path) {
+        return usage(argv[0]);
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    llcpp::shm_collector<> collector(name, path, opts);
+    if (!collector.is_open()) {
+        std::fprintf(stderr, "%s: can't create %s or %s\n", argv[0], name, path);
+        return 1;
+    }
+    while (!g_stop) {
+        if (collector.poll() == 0) {
+            std::this_thread::sleep_for(poll_interval);
+        }
+    }
+    collector.poll();
+    std::fprintf(stderr, "%s: collected %llu lines, producers dropped %llu\n", argv[0],
+        static_cast<unsigned long long>(collector.lines()), static_cast<unsigned long long>(collector.dropped()));
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Decode an llcpp log to text or JSON lines.
+ * usage: llcpp_decode [--json] [--compact] [--threads N] [--from NS] [--to NS] <log file>
+ * --compact decodes a plain log written with config_with_compact_encoding (framed logs record it in their header).
+ * Compressed blocks are decompressed as they're reached, and freed once their records are written.
+ * --from/--to (nanoseconds since the epoch) apply to framed logs: decoding starts at the first block whose first record
+ *  was written at or after --from, and stops at the first block whose first record was written at or after --to.
+ *
+ * Records are split into batches by a single scanning pass (which is cheap, the layouts are cached),
+ *  and the batches are formatted in parallel and written in order.
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llcpp/decoder.hpp"
+
+namespace {
+    constexpr std::size_t batch_size = 16 * 1024;
+
+    struct batch {
+        std::vector<llcpp::record> records;
+        std::string out;
+        std::string scratch;
+    };
+
+    void format_batch(batch& b, bool json) {
+        b.out.clear();
+        for (auto& rec : b.records) {
+            if (json) {
+                llcpp::append_json(b.out, rec, b.scratch);
+            } else {
+                llcpp::append_text(b.out, rec);
+            }
+        }
+    }
+
+    int usage(const char *argv0) {
+        std::fprintf(stderr, "usage: %s [--json] [--compact] [--threads N] [--from NS] [--to NS] <log file>\n", argv0);
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    bool compact = false;
+    std::size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::uint64_t from_ns = 0;
+    std::uint64_t to_ns = ~0ULL;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from_ns = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_ns = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!path) {
+        return usage(argv[0]);
+    }
+
+    llcpp::mapped_file file(path);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "%s: can't read %s\n", argv[0], path);
+        return 1;
+    }
+    llcpp::decoder<> decoder(file.data(), file.size());
+    if (compact) {
+        decoder.set_compact_encoding(true);
+    }
+    bool in_range = true;
+    if (from_ns > 0 || to_ns != ~0ULL) {
+        if (!decoder.is_framed()) {
+            std::fprintf(stderr, "%s: --from/--to require a framed log\n", argv[0]);
+            return 1;
+        }
+        in_range = (from_ns == 0) || decoder.seek_time(from_ns);
+    }
+
+    std::vector<batch> batches(num_threads);
+    std::vector<std::thread> workers;
+    bool done = !in_range;
+    while (!done) {
+        std::size_t used = 0;
+        for (auto& b : batches) {
+            b.records.clear();
+            llcpp::record rec;
+            while (b.records.size() < batch_size && decoder.next(rec)) {
+                auto& block = decoder.current_block();
+                if (block.flags == llcpp::framing::data_block && block.first_timestamp >= to_ns) {
+                    done = true;
+                    break;
+                }
+                b.records.push_back(rec);
+            }
+            if (!b.records.empty()) {
+                used++;
+            }
+            if (done || b.records.size() < batch_size) {
+                done = true;
+                break;
+            }
+        }
+
+        for (std::size_t i = 1; i < used; i++) {
+            workers.emplace_back(format_batch, std::ref(batches[i]), json);
+        }
+        if (used > 0) {
+            format_batch(batches[0], json);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        for (std::size_t i = 0; i < used; i++) {
+            std::fwrite(batches[i].out.data(), 1, batches[i].out.size(), stdout);
+        }
+        decoder.discard_decompressed();
+    }
+    std::fflush(stdout);
+
+    if (decoder.skipped_bytes() > 0) {
+        std::fprintf(stderr, "%s: skipped %llu corrupted or undecodable bytes\n", argv[0],
+            static_cast<unsigned long long>(decoder.skipped_bytes()));
+    }
+    if (decoder.error()) {
+        std::fprintf(stderr, "%s: %s at offset %llu\n", argv[0], decoder.error(),
+            static_cast<unsigned long long>(decoder.position()));
+        return 1;
+    }
+    return 0;
+}
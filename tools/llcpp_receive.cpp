@@ -0,0 +1,45 @@
+/*
+ * Receive the logs socket_loggers send, into a single framed log.
+ * usage: llcpp_receive <endpoint> <log file>
+ * `<endpoint>` is where to listen: "unix:<path>", "unixgram:<path>", "tcp:<host>:<port>" or "udp:<host>:<port>"
+ *  (an empty host listens on every address, i.e. "udp::5140").
+ * Runs until SIGINT or SIGTERM, then writes the log's index (and removes the unix socket).
+ */
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "llcpp/llcpp.hpp"
+
+namespace {
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void on_signal(int) {
+        g_stop = 1;
+    }
+
+    int usage(const char *argv0) {
+        std::fprintf(stderr, "usage: %s <endpoint> <log file>\n", argv0);
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3 || argv[1][0] == '-') {
+        return usage(argv[0]);
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    llcpp::socket_receiver receiver(argv[1], argv[2]);
+    if (!receiver.is_open()) {
+        std::fprintf(stderr, "%s: can't listen on %s or create %s\n", argv[0], argv[1], argv[2]);
+        return 1;
+    }
+    while (!g_stop) {
+        receiver.poll(std::chrono::milliseconds(100));
+    }
+    std::fprintf(stderr, "%s: received %llu lines, rejected %llu\n", argv[0],
+        static_cast<unsigned long long>(receiver.lines()), static_cast<unsigned long long>(receiver.rejected()));
+    return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Append the lines a crashed file_logger (written with config_with_crash_buffer) left in its crash buffer to its log.
+ * usage: llcpp_recover [--force] <log file>
+ * The crash buffer is `<log file>.crash`, and is removed once recovered. --force recovers it even though the process
+ *  which wrote it still seems to be running (i.e. its pid was reused).
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "llcpp/llcpp.hpp"
+
+namespace {
+    int usage(const char *argv0) {
+        std::fprintf(stderr, "usage: %s [--force] <log file>\n", argv0);
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    bool force = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (argv[i][0] == '-' || path) {
+            return usage(argv[0]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        return usage(argv[0]);
+    }
+
+    auto result = llcpp::recover(path, force);
+    if (result.error) {
+        std::fprintf(stderr, "%s: %s\n", path, result.error);
+        return 1;
+    }
+    std::printf("%s: recovered %zu buffers (%llu bytes)", result.log_path.c_str(), result.buffers,
+        static_cast<unsigned long long>(result.bytes));
+    if (result.truncated > 0) {
+        std::printf(", replacing the %llu bytes of an interrupted write", static_cast<unsigned long long>(result.truncated));
+    }
+    std::printf("\n");
+    return 0;
+}